@@ -125,6 +125,38 @@ extern "C" {
  */
 #define SX_MAX_NUMBER_LENGTH 33
 
+/**\brief Maximum Number of Threads
+ *
+ * The number of threads, including the main thread, that may be running at the
+ * same time; thread_create() fails once this many are running.
+ */
+#define THREAD_MAX 64
+
+/**\brief Inline Message Size
+ *
+ * Messages posted with message_queue_post() that are no longer than this are
+ * copied straight into the queue; longer ones are copied to memory from
+ * get_mem() first. Every queue slot has room for this many bytes, so keep this
+ * small.
+ */
+#define MESSAGE_QUEUE_INLINE 96
+
+/**\brief Long String Hash Threshold
+ *
+ * str_hash() and str_hash_l() use hash_murmur2_pt() for strings shorter than
+ * this, and hash_wyhash_pt() for anything at least this long. The former is
+ * faster on short keys, the latter on long ones; the hash test case prints
+ * the numbers to pick this by.
+ */
+#define STR_HASH_LONG 64
+
+/**\brief Built-in Size of List Builders
+ *
+ * The number of elements that a struct sexpr_list_builder keeps in the struct
+ * itself; kept small, because the reader uses one per level of nesting.
+ */
+#define SX_LIST_BUILDER_SIZE 32
+
 /**\brief Chunk Size for Graph Nodes
  *
  * Space for graph nodes is allocated in chunks of this; needs to be a power of
@@ -90,6 +90,32 @@ sexpr read_directory_sx (sexpr rx);
  */
 sexpr read_directory    (const char *p);
 
+/**\brief Read Directory, streaming Matches to a Callback
+ *
+ * \param[in] p        The Pattern to use.
+ * \param[in] callback Called with the path of every match.
+ * \param[in] aux      Passed to the callback as its second argument.
+ * \return The number of matches.
+ *
+ * Uses the same patterns and produces the same paths as read_directory(), but
+ * instead of creating a list of strings, the paths are passed to the callback
+ * as they're found; the path is only valid during the callback. Where the
+ * operating system allows it, directories are opened relative to their
+ * parents and entries that aren't directories are skipped without being
+ * looked at any further, so this is a lot cheaper for large trees.
+ */
+unsigned long read_directory_glob
+        (const char *p, void (*callback)(const char *, void *), void *aux);
+
+/**\brief Check for Regular Expression Path Component
+ * \internal
+ *
+ * \param[in] c The path component to check.
+ * \return 1 if the component needs to be matched as a regular expression, 0
+ *         if it can be used as a file name as-is.
+ */
+char read_directory_component_rxp (const char *c);
+
 #ifdef __cplusplus
 }
 #endif
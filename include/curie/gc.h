@@ -44,13 +44,38 @@ extern "C" {
 
 #include <curie/sexpr.h>
 
-/**\brief Add Garbage Collector Root
+/**\brief Garbage Collector Root Handle
+ *
+ * Handles are returned by gc_register_root() and identify a root slot, so that
+ * removing the root again doesn't need to search for it.
+ */
+typedef unsigned long gc_root;
+
+/**\brief Register Garbage Collector Root
  *
  * \param[in] sx The root to add.
  *
+ * \returns A handle to pass to gc_unregister_root() later.
+ *
  * The garbage collector uses roots to allow programmers to designate
  * s-expressions that should not get killed by the garbage collector, even if
- * they're not on the stack anywhere.
+ * they're not on the stack anywhere. Slots of unregistered roots are reused,
+ * so both registering and unregistering take constant time.
+ */
+gc_root       gc_register_root   (sexpr *sx);
+
+/**\brief Unregister Garbage Collector Root
+ *
+ * \param[in] root The handle returned by gc_register_root().
+ */
+void          gc_unregister_root (gc_root root);
+
+/**\brief Add Garbage Collector Root
+ *
+ * \param[in] sx The root to add.
+ *
+ * Same as gc_register_root(), but without a handle. Prefer
+ * gc_register_root() for roots that come and go frequently.
  */
 void          gc_add_root    (sexpr *sx);
 
@@ -59,10 +84,85 @@ void          gc_add_root    (sexpr *sx);
  * \param[in] sx The root to remove.
  *
  * Analoguous to gc_add_root(), but instead of adding a new root, it removes
- * an old one.
+ * an old one. This needs to search all the roots for sx.
  */
 void          gc_remove_root (sexpr *sx);
 
+/**\brief Shadow Stack Frame
+ *
+ * A set of local s-expression variables that should be kept alive by the
+ * garbage collector. Frames are kept in a linked list, with the innermost
+ * frame at the start; use gc_push_frame() and gc_pop_frame() to maintain it.
+ *
+ * \code
+ * sexpr locals[2] = { sx_nil, sx_nil };
+ * struct gc_frame frame;
+ *
+ * gc_push_frame (&frame, locals, 2);
+ * locals[0] = cons (...);
+ * ...
+ * gc_pop_frame (&frame);
+ * \endcode
+ */
+struct gc_frame
+{
+    /**\brief Enclosing Frame */
+    struct gc_frame *previous;
+
+    /**\brief Local Variables */
+    sexpr           *locals;
+
+    /**\brief Number of Local Variables */
+    unsigned int     count;
+};
+
+/**\brief Innermost Shadow Stack Frame
+ *
+ * (struct gc_frame *)0 if there are no frames.
+ */
+extern struct gc_frame *gc_frames;
+
+/**\brief Push Shadow Stack Frame
+ *
+ * \param[out] frame  The frame to push; usually a local variable.
+ * \param[in]  locals The variables to keep alive.
+ * \param[in]  count  Number of elements in locals.
+ */
+#define gc_push_frame(frame,l,c)\
+    ((frame)->previous = gc_frames,\
+     (frame)->locals   = (l),\
+     (frame)->count    = (c),\
+     gc_frames         = (frame))
+
+/**\brief Pop Shadow Stack Frame
+ *
+ * \param[in] frame The frame that was last pushed with gc_push_frame().
+ */
+#define gc_pop_frame(frame)\
+    (gc_frames = (frame)->previous)
+
+/**\brief Scan the Stack Conservatively?
+ *
+ * Set to 1 (the default), gc_invoke() considers anything on the stack that
+ * looks like an s-expression to be in use. If all s-expressions that need to
+ * survive a collection are either roots or in a shadow stack frame, set this
+ * to 0: collections are faster that way, and stale words on the stack no
+ * longer keep garbage alive.
+ */
+extern char gc_scan_stack;
+
+/**\brief Number of Threads to mark with
+ *
+ * Set this to more than 1 to have gc_invoke() mark live s-expressions using
+ * that many threads, including the calling one. This only helps with large
+ * heaps that aren't just a single long list. If threads aren't available, or
+ * if they can't be created, the calling thread does all the work.
+ *
+ * Custom types' tag() functions may be called from any of these threads, and
+ * possibly at the same time, so they must not do anything but call gc_tag().
+ */
+extern unsigned int gc_mark_threads;
+
 /**\brief "Tag" an S-Expression
  *
  * \param[in] sx The root to tag.
@@ -86,9 +186,9 @@ void          gc_tag         (sexpr sx);
  * can check if they're in use. This is done automatically for built-in types,
  * and by the call() function of custom types.
  *
- * \note In your custom call() function, do not, ever, call the same
- *       s-expression twice. This will upset the gc gravely and may lead to
- *       data that is in use to be freed.
+ * \note In your custom call() function, try not to call the same
+ *       s-expression twice. The gc will ignore the duplicate, but it still
+ *       costs a hash table lookup.
  *
  * \note This function is only meaningful if called in the context of a gc run,
  *       which means you shouldn't call this function outside of a call()
@@ -101,10 +201,65 @@ void          gc_call        (sexpr sx);
  * As has been mentioned in the global notes for this header file, the garbage
  * collector needs to be called manually. Calling this function will do so.
  *
- * \returns The number of items that have been free'd.
+ * \returns The number of items that have been free'd, or that will be free'd
+ *          by gc_sweep() if gc_lazy_sweep is set.
  */
 unsigned long gc_invoke      ();
 
+/**\brief Sweep lazily?
+ *
+ * Normally, gc_invoke() destroys everything it found to be unused before it
+ * returns. Set this to 1 and gc_invoke() only marks, leaving the destruction
+ * of unused s-expressions to gc_sweep(), which the s-expression constructors
+ * call for a few at a time; see also multiplex_gc(). The time spent in
+ * gc_invoke() is then mostly the time it takes to mark.
+ */
+extern char gc_lazy_sweep;
+
+/**\brief Sweep in Progress
+ *
+ * Nonzero while a lazy sweep hasn't finished yet.
+ */
+extern char gc_sweeping;
+
+/**\brief Destroy unused S-Expressions
+ * \param[in] slots How many candidates to look at, or 0 for all of them.
+ *
+ * \returns The number of items that have been free'd.
+ *
+ * Continues a lazy sweep, if there is one. Once all candidates have been
+ * looked at with slots set to 0, the memory pools are optimised; otherwise
+ * that is left to gc_tidy().
+ */
+unsigned long gc_sweep       (unsigned long slots);
+
+/**\brief Finish up after a lazy Sweep
+ *
+ * \returns 1 if there was anything to do, 0 otherwise.
+ *
+ * A lazy sweep that was finished a few candidates at a time leaves the
+ * candidate table and the optimisation of the memory pools for later, so that
+ * an unlucky constructor doesn't have to do it all. multiplex_gc() calls this
+ * function between events, and gc_invoke() before it starts marking.
+ */
+char          gc_tidy        ();
+
+/**\brief Keep an S-Expression alive
+ * \param[in] sx The s-expression to keep.
+ *
+ * During a lazy sweep, s-expressions that have been found to be unused may
+ * still be around for a while. Code that hands out existing s-expressions,
+ * e.g. after looking them up in a tree, needs to call this function on them
+ * so that they don't get destroyed after all. Built-in types already do so.
+ */
+void          gc_keep        (sexpr sx);
+
+/**\brief Sweep lazily in the Multiplexer
+ *
+ * Continues lazy sweeps a bit on every multiplexer tick.
+ */
+void          multiplex_gc   ( void );
+
 /**\brief Garbage Collector Item Count Hint
  *
  * To make the garbage collector a bit more efficient, this variable is used to
@@ -93,6 +93,78 @@ int_64      hash_murmur2_64 ( const void * key, int len, unsigned int seed );
  */
 int_pointer hash_murmur2_pt ( const void * key, int len, unsigned int seed );
 
+/**\brief wyhash, 64-Bit
+ * \param[in] key  The data to hash.
+ * \param[in] len  Length (in bytes) of key.
+ * \param[in] seed Start value for the hash.
+ * This is a hash in the style of Wang Yi's wyhash (final version), which
+ * mixes 16 bytes at a time with a 64x64->128-bit multiplication. It's much
+ * faster than the MurmurHash2 on long keys if the compiler can do that
+ * multiplication natively, i.e. with unsigned __int128; elsewhere, the
+ * multiplication is put together from 32-bit halves, which works but isn't as
+ * fast. The result is the same either way.
+ * \returns The hash over the provided input, as described.
+ */
+int_64      hash_wyhash_64 ( const void * key, unsigned long len, int_64 seed );
+
+/**\brief wyhash, Pointer-Sized
+ * \param[in] key  The data to hash.
+ * \param[in] len  Length (in bytes) of key.
+ * \param[in] seed Start value for the hash.
+ * This is hash_wyhash_64(), cut down to the pointer size of the target
+ * architecture.
+ * \returns The hash over the provided input, as described.
+ */
+int_pointer hash_wyhash_pt ( const void * key, unsigned long len, int_64 seed );
+
+/**\brief Streaming Hash State
+ * Used by hash_wyhash_begin(), hash_wyhash_update() and
+ * hash_wyhash_finish() to hash data that comes in chunks, such as data read
+ * from an io structure. Allocate these wherever you like; the contents are
+ * private to the implementation.
+ */
+struct hash_state
+{
+    /**\brief Internal State */
+    int_64 seed[3];
+
+    /**\brief Bytes hashed so far */
+    unsigned long length;
+
+    /**\brief Bytes in buffer that haven't been mixed in yet */
+    unsigned int used;
+
+    /**\brief Pending Data
+     *
+     * The last 16 bytes that were mixed in, followed by up to 48 bytes that
+     * haven't been.
+     */
+    unsigned char buffer[64];
+};
+
+/**\brief Start a Streaming Hash
+ * \param[out] state The state to initialise.
+ * \param[in]  seed  Start value for the hash.
+ */
+void        hash_wyhash_begin ( struct hash_state *state, int_64 seed );
+
+/**\brief Add Data to a Streaming Hash
+ * \param[in,out] state The state to update.
+ * \param[in]     key   The data to add.
+ * \param[in]     len   Length (in bytes) of key.
+ */
+void        hash_wyhash_update
+                ( struct hash_state *state, const void * key,
+                  unsigned long len );
+
+/**\brief Finish a Streaming Hash
+ * \param[in] state The state to finish.
+ * \returns The same hash that hash_wyhash_64() would have returned for all
+ *          the data that was passed to hash_wyhash_update(), regardless of
+ *          how it was split up.
+ */
+int_64      hash_wyhash_finish ( const struct hash_state *state );
+
 #ifdef __cplusplus
 }
 #endif
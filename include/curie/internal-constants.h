@@ -51,12 +51,108 @@ extern "C" {
  */
 #define LIBCURIE_DIRENT_BUFFER_SIZE 0x1000
 
+/**\brief Directory glob buffer size
+ *
+ * Size of the buffers that read_directory_glob() reads directory entities
+ * into; it uses one of these per path component, for the whole scan.
+ */
+#define LIBCURIE_GLOB_BUFFER_SIZE 0x8000
+
+/**\brief Directory glob path size
+ *
+ * Maximum length of the paths that read_directory_glob() passes to its
+ * callback; longer paths are skipped.
+ */
+#define LIBCURIE_GLOB_PATH_SIZE 0x1000
+
+/**\brief Default number of directory walk threads
+ *
+ * Used by multiplex_add_directory_walk() when it isn't told how many threads
+ * to use.
+ */
+#define DIRECTORY_WALK_THREADS 4
+
+/**\brief Directory walk result chunk size
+ *
+ * Directory walk threads collect their results in chunks of this size before
+ * handing them to the thread that runs multiplex().
+ */
+#define DIRECTORY_WALK_CHUNK_SIZE 0x10000
+
 /**\brief Number of static pools
  *
  * The number of static memory pools as kept by the memory allocator.
  */
 #define POOLCOUNT (LIBCURIE_PAGE_SIZE / ENTITY_ALIGNMENT)
 
+/**\brief Number of pool frames to search
+ *
+ * get_pool_mem() only looks at this many frames for a free entity before it
+ * allocates a new frame. Frames further down that have entities free are moved
+ * back to the front by optimise_memory_pool().
+ */
+#define POOL_FRAME_PROBES 8
+
+/**\brief Lazy sweep step
+ *
+ * The number of gc candidates to look at whenever a new s-expression is
+ * created while a lazy sweep is in progress.
+ */
+#define GC_SWEEP_STEP 16
+
+/**\brief Lazy sweep tick
+ *
+ * The number of gc candidates to look at on every multiplexer tick while a
+ * lazy sweep is in progress.
+ */
+#define GC_SWEEP_TICK 0x1000
+
+/**\brief Short string table size
+ *
+ * Strings and symbols of up to 7 characters are kept in a table of this many
+ * entries instead of being hash-consed; only three quarters of it are used.
+ * Must be a power of two.
+ */
+#define SX_SHORT_STRINGS 0x400
+
+/**\brief Short string table size, as a power of two
+ *
+ * log2 (SX_SHORT_STRINGS), used to spread the table keys.
+ */
+#define SX_SHORT_STRINGS_BITS 10
+
+/**\brief Binary encoding symbol table size
+ *
+ * The number of symbols that each direction of a struct sexpr_io that uses the
+ * binary encoding will remember and send as indices. Further symbols are sent
+ * spelled out each time.
+ */
+#define SX_BINARY_SYMBOLS 0x400
+
+/**\brief Binary encoding nesting limit
+ *
+ * The deepest list nesting that the binary decoder will follow; frames that
+ * nest any deeper are treated as broken, so the decoder's recursion is bounded
+ * no matter what a peer sends.
+ */
+#define SX_BINARY_DEPTH 0x100
+
+/**\brief Maximum number of heap images
+ *
+ * sx_image_load() refuses to load any more images than this.
+ */
+#define SX_MAX_IMAGES 8
+
+/**\brief Preferred heap image address
+ *
+ * Heap images are laid out to be mapped at this address, which is well out of
+ * the way of the heap on both 32 and 64 bit systems. The first image that is
+ * loaded usually ends up there and can be used as-is, others need to be
+ * relocated after they're mapped.
+ */
+#define SX_IMAGE_BASE\
+    (((int_pointer)0x5c000000) << ((sizeof (int_pointer) - 4) * 3))
+
 #ifdef __cplusplus
 }
 #endif
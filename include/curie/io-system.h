@@ -52,6 +52,10 @@ extern "C" {
 
   int a_make_nonblocking (int fd);
 
+  /* wake-up descriptors for message queues: result[0] becomes readable once
+     something was written to result[1]; both may be the same descriptor. */
+  enum io_result a_open_event (int result[]);
+
   int a_unlink (const char *path);
 
   int a_stat(const char *path, void *buffer);
@@ -59,6 +63,26 @@ extern "C" {
 
   extern char last_error_recoverable_p;
 
+  /* batched requests: queued with a_batch_read() and a_batch_write(), carried
+     out by a_batch_submit(), which calls on_complete with each request's tag
+     and the result a_read() or a_write() would have returned. */
+  void a_batch_read  (int fd, void *buf, unsigned int count, void *tag);
+  void a_batch_write (int fd, const void *buf, unsigned int count, void *tag);
+  void a_batch_submit (void (*on_complete)(void *tag, int result));
+
+  /* whether a_batch_submit() hands a whole batch to the kernel at once, and
+     the number of syscalls it has made so far to carry out requests. */
+  char a_batch_ringp ( void );
+  unsigned long a_batch_syscalls ( void );
+
+  /* io_read_queue() sets size to the most that the queued read may return,
+     or to what was read right away if the read couldn't be queued; the
+     latter is the case unless it returns io_incomplete. io_queue_submit()
+     returns the number of bytes that the queued reads actually got. */
+  enum io_result io_read_queue (struct io *io, unsigned int *size);
+  enum io_result io_commit_queue (struct io *io);
+  unsigned long io_queue_submit ( void );
+
   struct io *io_create ();
   void io_destroy (struct io *io);
 #ifdef __cplusplus
@@ -172,6 +172,87 @@ enum io_result {
     io_finalising = 7
 };
 
+/**\brief Read Scheduling Policy
+ *
+ * Determines how much io_read_scheduled() will read from an iot_read structure
+ * in one go. The multiplexer uses that function whenever a structure is ready
+ * to be read from, so this is effectively the amount of data a single
+ * structure may consume per multiplexer tick.
+ */
+enum io_read_policy {
+    /**\brief Single Read
+     *
+     * Perform one read request per call, of at most IO_CHUNKSIZE bytes, or of
+     * the read budget if that is smaller. This is the default.
+     */
+    iorp_single = 0,
+
+    /**\brief Drain
+     *
+     * Keep reading until the source has no further data for the moment or
+     * until the read budget has been used up, whichever happens first. This
+     * saves multiplexer ticks with sources that produce data faster than it
+     * is being read.
+     */
+    iorp_drain = 1
+};
+
+/**\brief Buffer Mode
+ *
+ * Determines how the buffer of a struct io is managed; see io_ring().
+ */
+enum io_buffer_mode {
+    /**\brief Linear Buffer
+     *
+     * The buffer grows as needed, and processed data is discarded by moving
+     * the remaining data to the start of the buffer. This is the default.
+     */
+    iobm_linear = 0,
+
+    /**\brief Fixed Buffer
+     *
+     * Like iobm_linear, except that the buffer is never resized. Reads and
+     * writes that won't fit are rejected with io_no_change.
+     */
+    iobm_fixed = 1,
+
+    /**\brief Ring Buffer
+     *
+     * The buffer is a fixed-size ring that is mapped twice in a row, so that
+     * the data between the position and length fields is always contiguous.
+     * Discarding processed data never needs to move anything. The length and
+     * position fields may exceed the buffer size, but never twice the buffer
+     * size. Reads and writes that won't fit are rejected with io_no_change.
+     */
+    iobm_ring = 2
+};
+
+/**\brief I/O Statistics
+ *
+ * Counters that are kept for each struct io. They're never reset by the
+ * library itself, so feel free to do that yourself if need be.
+ */
+struct io_statistics {
+    /**\brief Bytes transferred
+     *
+     * Number of bytes that were read from or written to the underlying file.
+     */
+    unsigned long bytes;
+
+    /**\brief System Calls
+     *
+     * Number of read or write requests that were passed to the OS.
+     */
+    unsigned long syscalls;
+
+    /**\brief Ticks starved
+     *
+     * Number of multiplexer ticks in which the structure was ready to be read
+     * from, but wasn't serviced because the tick's budget had been used up.
+     */
+    unsigned long starved;
+};
+
 /**\brief I/O Structure
  *
  * This structure keeps track of the state of any kind of I/O connection. Think
@@ -225,6 +306,31 @@ struct io {
      * the field, in that it describes the allocated size of the buffer.
      */
     unsigned int buffersize;
+
+    /**\brief Buffer Mode
+     *
+     * How the buffer is managed. Use io_ring() to change this.
+     */
+    enum io_buffer_mode buffer_mode;
+
+    /**\brief Read Policy
+     *
+     * How io_read_scheduled() should read from the structure.
+     */
+    enum io_read_policy read_policy;
+
+    /**\brief Read Budget
+     *
+     * The maximum number of bytes that io_read_scheduled() will read in one
+     * call. 0 means no limit beyond what the read policy implies.
+     */
+    unsigned int read_budget;
+
+    /**\brief Statistics
+     *
+     * Usage counters for this structure.
+     */
+    struct io_statistics statistics;
 };
 
 
@@ -341,7 +447,9 @@ struct io *io_open_buffer ( void *buffer, unsigned int size );
  * \return Result code of the implicit io_commit().
  *
  * This function is the same as calling io_collect() and then immediately
- * calling io_commit().
+ * calling io_commit(). If the structure uses a fixed-capacity buffer (see
+ * io_ring()) that doesn't have room for all of the data, nothing is written
+ * and the return value is io_no_change.
  */
 enum io_result io_write
         (struct io * io,
@@ -353,7 +461,8 @@ enum io_result io_write
  * \param[in] length The length of the data buffer.
  * \return io_unrecoverable_error for errors, io_incomplete when the data has
  *         been appended, io_end_of_file or io_finalising if the given io
- *         struct has that as its current status.
+ *         struct has that as its current status, io_no_change if the buffer
+ *         has a fixed size and the data doesn't fit.
  *
  * The data is appended to the write buffer of the io structure. The type of
  * the io structure is set to iot_write; if the type was different before the
@@ -371,11 +480,49 @@ enum io_result io_collect
  *         io_finalising if the struct is in that state.
  *
  * This function will read data from the io structure's source and append the
- * data to the buffer.
+ * data to the buffer. Fixed-size buffers that are full report io_no_change
+ * without trying to read anything.
  */
 enum io_result io_read
         (struct io * io);
 
+/**\brief Read Data according to the Read Policy
+ * \param[in] io The I/O structure to read from.
+ * \return io_changes if anything has been read, otherwise the same codes as
+ *         io_read().
+ *
+ * This is the same as io_read() for structures with the default policy and no
+ * read budget. With the iorp_drain policy, this function keeps reading until
+ * there is no more data available right now, until the end of the file or
+ * until the read budget has been exhausted.
+ */
+enum io_result io_read_scheduled
+        (struct io * io);
+
+/**\brief Use fixed-capacity Buffer
+ * \param[in] io       The I/O structure to modify.
+ * \param[in] capacity The number of bytes the buffer should hold.
+ * \return The new buffer mode of the structure.
+ *
+ * Replaces the structure's buffer with a ring buffer that holds capacity
+ * bytes, rounded up to the next multiple of LIBCURIE_PAGE_SIZE. If the OS
+ * can't provide ring buffer memory, a fixed-size linear buffer is used instead.
+ * Either way, the buffer will never be resized afterwards: io_read() will not
+ * read anything and io_collect() will reject data with io_no_change if there
+ * isn't enough space left, so the other end will eventually be throttled
+ * until the buffer contents have been processed.
+ *
+ * Data that is already in the buffer is kept; the capacity is raised if
+ * needed to hold it.
+ *
+ * \note On a structure used for writing, io_write() returns io_no_change and
+ *       keeps none of the data if it doesn't fit. sx_write() ignores that, so
+ *       s-expressions written to a full ring are lost; make the capacity large
+ *       enough, or check buffer space before writing.
+ */
+enum io_buffer_mode io_ring
+        (struct io * io, unsigned int capacity);
+
 /**\brief Reclaim I/O Memory
  * \param[in] io The I/O structure to flush.
  *
@@ -79,6 +79,17 @@ struct memory_pool_frame_header
      */
     unsigned short maxentities;
 
+    /**\brief Owning Thread
+     *
+     * The thread_index() of the thread whose pools the frame belongs to; only
+     * that thread allocates from the frame or marks its entities as free when
+     * memory_thread_safe is set. Frames of pools from create_memory_pool()
+     * don't belong to any thread and have all bits set here; with
+     * memory_thread_safe set, their entities are always freed through the
+     * first frame's remote list.
+     */
+    unsigned short owner;
+
     /**\brief Next Frame
      *
      * This is a pointer to the next pool frame, or (struct memory_pool *)0 if
@@ -86,6 +97,40 @@ struct memory_pool_frame_header
      */
     struct memory_pool_frame_header *next;
 
+    /**\brief First Frame
+     *
+     * The first frame of the pool that this frame is part of.
+     */
+    struct memory_pool_frame_header *pool;
+
+    /**\brief Frames with free Entities
+     *
+     * Only used in the first frame of a pool: frames that had entities freed
+     * while they were further down the list than get_pool_mem() looks, so
+     * that it can get back to them before it adds yet another frame.
+     */
+    struct memory_pool_frame_header *rooms;
+
+    /**\brief Next Frame with free Entities
+     *
+     * The next frame on the first frame's rooms list.
+     */
+    struct memory_pool_frame_header *room;
+
+    /**\brief On the rooms List
+     *
+     * Set while the frame is on the first frame's rooms list.
+     */
+    char queued;
+
+    /**\brief Remotely freed Entities
+     *
+     * Only used in the first frame of a pool from create_memory_pool(): a
+     * list of entities that were freed while memory_thread_safe was set,
+     * which the next get_pool_mem() on the pool marks as free.
+     */
+    void * volatile remote;
+
     /**\brief Allocation Bitmap
      *
      * This bitmap is used to keep track of which entities are still available.
@@ -96,6 +141,22 @@ struct memory_pool_frame_header
     pool_bitmap map;
 };
 
+/**\brief Allocation Counters active
+ * \internal
+ *
+ * Set by memory_statistics_start().
+ */
+extern char memory_statistics_active;
+
+/**\brief Count large Allocation
+ * \internal
+ * \param[in] size The size of the allocation; negative for deallocations.
+ *
+ * Used by aalloc() and afree() to update the counters for allocations that
+ * are not served by the pools.
+ */
+void memory_statistics_large (long size);
+
 #ifdef __cplusplus
 }
 #endif
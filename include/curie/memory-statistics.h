@@ -0,0 +1,80 @@
+/**\file
+ * \brief Memory Statistics as S-Expressions
+ *
+ * Turns the allocation counters of the memory pools into an s-expression, and
+ * optionally writes them out whenever a signal comes in. This is intended for
+ * tuning the pool sizes of long-running programmes: start the programme with
+ * the statistics enabled, send it the signal every now and then and look at
+ * the numbers.
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+ */
+
+#ifndef LIBCURIE_MEMORY_STATISTICS_H
+#define LIBCURIE_MEMORY_STATISTICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <curie/sexpr.h>
+#include <curie/signal.h>
+
+/**\brief Get Memory Statistics
+ * \return The current statistics.
+ *
+ * The statistics look like this:
+ * \code
+ * (memory-statistics (seconds 60)
+ *   (size-class (size 16) (allocations 200) (frees 100)
+ *               (allocations-per-second 3) (frames 1) (live 100)
+ *               (fragmentation 153))
+ *   (large (allocations 2) (frees 1) (allocations-per-second 0)
+ *          (bytes 8192)))
+ * \endcode
+ *
+ * Seconds is the time since the counters were started, and there is one
+ * size-class entry for each entity size that has seen any use. See struct
+ * memory_statistics for what the numbers mean. The counters are started if
+ * that hasn't happened yet.
+ */
+sexpr sx_memory_statistics ( void );
+
+/**\brief Write Memory Statistics on a Signal
+ * \param[in] signal The signal to watch for, e.g. sig_usr1.
+ * \param[in] io     Where to write the statistics to.
+ *
+ * Starts the allocation counters and arranges for sx_memory_statistics() to be
+ * written to io whenever the given signal comes in. You need to initialise the
+ * signal multiplexer with multiplex_signal() for this to work.
+ */
+void multiplex_memory_statistics
+        (enum signal signal, struct sexpr_io *io);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
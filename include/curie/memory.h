@@ -183,6 +183,26 @@ void mark_mem_rw (unsigned long int size, void *block);
  */
 void mark_mem_rx (unsigned long int size, void *block);
 
+/**\brief Allocate Ring Buffer Memory
+ * \param[in] size The size of the ring; a multiple of LIBCURIE_PAGE_SIZE.
+ * \return Pointer to the ring, or (void *)0 if this isn't supported.
+ *
+ * This allocates size bytes of memory, but maps them twice in a row, so that
+ * the returned block is 2*size bytes long and the second half mirrors the
+ * first. Data that wraps around the end of the ring can thus still be accessed
+ * as one contiguous block.
+ *
+ * \note Not all operating systems allow this, so be prepared to handle the
+ *       (void *)0 return value.
+ */
+void *get_mem_ring (unsigned long int size);
+
+/**\brief Free Ring Buffer Memory
+ * \param[in] size  The size of the ring, as passed to get_mem_ring().
+ * \param[in] block The ring to deallocate.
+ */
+void free_mem_ring (unsigned long int size, void *block);
+
 /**\brief Allocate a Chunk of Memory
  * \return Pointer to the newly allocated chunk of memory.
  *
@@ -310,6 +330,24 @@ void *get_pool_mem
  */
 void free_pool_mem(void *entity);
 
+/**\brief Thread-safe Allocations
+ *
+ * Set this to 1 before creating any threads that allocate memory. Each thread
+ * then gets its own set of the pools that MEMORY_POOL_INITIALISER() and
+ * aalloc() use, so threads don't need to synchronise to allocate. Entities
+ * freed by any thread but the one that allocated them are queued up for that
+ * thread without taking any locks, and the owning thread reuses them on its
+ * next allocation.
+ *
+ * Pools from create_memory_pool() still need to be allocated from by one
+ * thread at a time, though not necessarily the one that created them, and
+ * their entities may be freed by any thread.
+ *
+ * \note This only covers the memory allocator; s-expressions and most other
+ *       curie data structures are still for one thread at a time.
+ */
+extern char memory_thread_safe;
+
 /**\brief Optimise Memory Pool
  * \param[in] pool The pool to clean up.
  *
@@ -322,7 +360,8 @@ void optimise_memory_pool (struct memory_pool *pool);
 /**\brief Optimise Static Memory Pools
  *
  * This function calls optimise_memory_pool() on all the memory pools created
- * using the MEMORY_POOL_INITIALISER() macro.
+ * using the MEMORY_POOL_INITIALISER() macro; with memory_thread_safe set, that
+ * is the calling thread's set of these pools.
  */
 void optimise_static_memory_pools();
 
@@ -383,6 +422,80 @@ void afree (unsigned long size, void *block);
 
 /*! @} */
 
+/**\defgroup memoryStatistics Memory Statistics
+ * \ingroup memory
+ * \brief Allocation Counters for the Memory Pools
+ *
+ * Counting allocations is disabled by default, as it costs a little bit of
+ * time for every allocation. Once enabled with memory_statistics_start(), the
+ * counters can be read at any time; see also curie/memory-statistics.h for a
+ * way to get them as an s-expression.
+ *
+ * @{
+ */
+
+/**\brief Allocation Counters
+ *
+ * The numbers for a single size class, i.e. for all entities of the same
+ * size, or for all the aalloc() allocations that are too big for the pools.
+ */
+struct memory_statistics {
+    /**\brief Allocations
+     *
+     * Number of allocations since memory_statistics_start().
+     */
+    unsigned long allocations;
+
+    /**\brief Deallocations
+     *
+     * Number of deallocations since memory_statistics_start().
+     */
+    unsigned long frees;
+
+    /**\brief Frames
+     *
+     * Number of frames the static pool for this size currently uses.
+     */
+    unsigned long frames;
+
+    /**\brief Live Entities
+     *
+     * Number of entities currently allocated from the static pool for this
+     * size. For large allocations, this is the number of bytes allocated with
+     * aalloc() and not yet deallocated since memory_statistics_start().
+     */
+    unsigned long live;
+
+    /**\brief Fragmentation
+     *
+     * Number of free entities in frames of the static pool that are partially
+     * used. Completely unused frames don't count, as optimise_memory_pool()
+     * would get rid of them.
+     */
+    unsigned long fragmentation;
+};
+
+/**\brief Start counting Allocations
+ *
+ * Enables the allocation counters and resets them to zero.
+ */
+void memory_statistics_start ( void );
+
+/**\brief Read Allocation Counters
+ * \param[in]  size       The entity size to get the numbers for, or 0 for
+ *                        aalloc() allocations that don't use the pools.
+ * \param[out] statistics Where to put the numbers.
+ *
+ * The allocation counters count all pools with entities of the given size,
+ * including pools created with create_memory_pool(). The frames, live and
+ * fragmentation fields only look at the static pool for the size, i.e. the one
+ * used for MEMORY_POOL_INITIALISER() and aalloc().
+ */
+void memory_statistics
+        (unsigned long size, struct memory_statistics *statistics);
+
+/*! @} */
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,111 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#ifndef LIBCURIE_MESSAGE_QUEUE_H
+#define LIBCURIE_MESSAGE_QUEUE_H
+
+#include <curie/io.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**\defgroup messageQueue Cross-Thread Message Queues
+ * \ingroup io
+ * \brief Hand data from other threads to the multiplex() loop
+ *
+ * A message queue is a bounded ring of messages that any number of threads may
+ * post to without locking, while exactly one thread - the one that runs
+ * multiplex() - reads from it. Posting a message to an empty queue wakes up
+ * the multiplexer through a file descriptor (an eventfd on Linux, a socket
+ * pair elsewhere), and the messages are then appended to a special io
+ * structure, so that they arrive in the same on_read callbacks as any other
+ * data. Wrap that io structure with sx_open_io() to have threads send
+ * serialised s-expressions.
+ *
+ * Messages from the same thread arrive in the order they were posted, and
+ * messages are never split up or interleaved with each other.
+ *
+ * @{
+ */
+
+/**\brief Message Queue
+ * The contents of this struct are private to the implementation.
+ */
+struct message_queue;
+
+/**\brief Initialise the Message Queue Multiplexer
+ * Call this before using io_open_message_queue(). This also initialises the
+ * I/O multiplexer.
+ */
+void multiplex_message_queue ( void );
+
+/**\brief Create a Message Queue
+ * \param[in]  slots The number of messages that may be pending at the same
+ *                   time; rounded up to a power of two.
+ * \param[out] queue Receives the queue to pass to message_queue_post().
+ * \return The special io structure that posted messages are appended to, or
+ *         (struct io *)0 if the wake-up descriptor could not be created.
+ * Register the result with multiplex_add_io(), or wrap it with sx_open_io()
+ * and use multiplex_add_sexpr(). Only the thread that runs multiplex() may
+ * use the io structure, and its buffer must be left in iobm_linear mode so
+ * that there's always room for new messages.
+ */
+struct io *io_open_message_queue
+        (unsigned int slots, struct message_queue **queue);
+
+/**\brief Post a Message
+ * \param[in] queue  The queue to post to.
+ * \param[in] data   The message contents; these are copied.
+ * \param[in] length The number of bytes in data.
+ * \return io_complete if the message was queued, or io_no_change if the
+ *         queue is full.
+ * This may be called from any thread, including the one that runs
+ * multiplex(). Messages of up to MESSAGE_QUEUE_INLINE bytes don't allocate
+ * memory; longer ones use get_mem(). Producers that get io_no_change are
+ * expected to retry after a thread_yield().
+ */
+enum io_result message_queue_post
+        (struct message_queue *queue, const char *data, unsigned int length);
+
+/**\brief Close a Message Queue
+ * \param[in] queue The queue to close.
+ * Messages that are still pending are appended to the queue's io structure,
+ * then the wake-up descriptor is closed and the queue is deallocated. The io
+ * structure itself stays around until it is closed with multiplex_del_io().
+ * Only call this from the thread that runs multiplex(), and only after all the
+ * threads that post to the queue are done with it.
+ */
+void message_queue_close (struct message_queue *queue);
+
+/*! @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -87,6 +87,19 @@ enum multiplex_result multiplex ( void );
  */
 void multiplex_io ( void );
 
+/**\brief Set I/O Multiplexer Tick Budget
+ * \param[in] bytes The number of bytes to read per tick, or 0 for no limit.
+ *
+ * Limits how much the I/O multiplexer reads in total per call to multiplex().
+ * Structures that are ready but don't get serviced because of this limit will
+ * have their statistics.starved counter incremented, and they will be the
+ * first to be serviced in the next tick, as ready structures are always
+ * serviced in a round-robin fashion. Use the read_policy and read_budget
+ * fields of the individual io structures to control how much each of them may
+ * use up.
+ */
+void multiplex_io_budget (unsigned long bytes);
+
 /**\brief Initialise Process Multiplexer
  *
  * Use this function before using the process multiplexer, i.e. before calling
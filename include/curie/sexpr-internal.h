@@ -33,6 +33,7 @@
 #define LIBCURIE_SEXPR_INTERNAL_H
 
 #include <curie/io.h>
+#include <curie/sexpr.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -47,8 +48,49 @@ extern "C" {
 struct sexpr_io {
     struct io *in;  /**< Input Structure */
     struct io *out; /**< Output Structure */
+    unsigned int flags; /**< SX_IO_* Flags */
+
+    /**\brief Binary Encoding State
+     *
+     * The symbol tables for both directions; allocated when the first binary
+     * frame is read or written.
+     */
+    struct sexpr_binary *binary;
 };
 
+/**\brief Binary Encoding Offered
+ *
+ * Set once sx_offer_binary() has been called on a struct sexpr_io.
+ */
+#define SX_IO_BINARY_OFFERED 0x1
+
+/**\brief Binary Encoding Offered by Peer
+ *
+ * Set once the peer's offer has been read.
+ */
+#define SX_IO_BINARY_PEER    0x2
+
+/**\brief Binary Encoding Negotiated
+ *
+ * Writes use the binary encoding when both of these flags are set.
+ */
+#define SX_IO_BINARY         (SX_IO_BINARY_OFFERED | SX_IO_BINARY_PEER)
+
+/**\brief Binary Encoding Offer
+ *
+ * A stray closing parenthesis followed by a NUL byte; text readers skip both
+ * of these, so it's safe to send to peers that don't know about the binary
+ * encoding.
+ */
+#define SX_BINARY_OFFER      ")\0"
+
+/**\brief Binary Frame Marker
+ *
+ * Starts each binary s-expression. This byte never occurs in UTF-8, so it
+ * can't be the start of a textual s-expression.
+ */
+#define SX_BINARY_FRAME      0xfe
+
 /**\brief Custom type descriptor
  *
  * Contains function pointers to handle a custom type and a unicode code point
@@ -149,6 +191,202 @@ void sx_call_custom ( void );
  */
 struct sexpr_type_descriptor *sx_get_descriptor (unsigned int type);
 
+/**\brief Get the Hash of a String or Symbol
+ *
+ * \param[in] s The string or symbol.
+ *
+ * \returns The hash that s is hash-consed with.
+ *
+ * This is the stored hash for strings and symbols created at runtime. Static
+ * ones don't have that, so it's calculated on the spot for those.
+ */
+int_pointer sx_string_or_symbol_hash (struct sexpr_string_or_symbol *s);
+
+/**\defgroup sexprScan Structural Scanner
+ * \ingroup sexpr
+ * \internal
+ *
+ * The reader uses these to get from one token to the next without looking at
+ * every byte on its own. On CPUs that have vector units, the scanner
+ * classifies a whole block of input at a time into a bitmap of the requested
+ * character classes and then jumps straight to the first hit.
+ *
+ * @{
+ */
+
+/**\brief Whitespace
+ * Includes NUL bytes, which the reader skips the same way as blanks.
+ */
+#define SX_CLASS_SPACE   0x01
+
+/**\brief Comment Start (;) */
+#define SX_CLASS_COMMENT 0x02
+
+/**\brief Parentheses */
+#define SX_CLASS_PAREN   0x04
+
+/**\brief String Quotes and Escapes (" and \\) */
+#define SX_CLASS_STRING  0x08
+
+/**\brief Line Feed
+ * Used to find the end of a comment.
+ */
+#define SX_CLASS_NEWLINE 0x10
+
+/**\brief Symbol Delimiters
+ * Anything that ends a symbol or a number.
+ */
+#define SX_CLASS_DELIMITER (SX_CLASS_SPACE | SX_CLASS_COMMENT | SX_CLASS_PAREN)
+
+/**\brief Character Classes
+ * SX_CLASS_* bits for each byte value.
+ */
+extern const unsigned char sx_character_classes[256];
+
+/**\brief Find the next Byte in a Set of Classes
+ * \param[in] buf     The buffer to scan.
+ * \param[in] i       Where to start.
+ * \param[in] length  The length of the buffer.
+ * \param[in] classes The SX_CLASS_* bits to look for.
+ *
+ * \returns The position of the first byte at or after i that is in any of the
+ *          given classes, or length if there is none.
+ */
+unsigned int sx_scan
+    (const char *buf, unsigned int i, unsigned int length,
+     unsigned char classes);
+
+/**\brief Skip Bytes in a Set of Classes
+ * \param[in] buf     The buffer to scan.
+ * \param[in] i       Where to start.
+ * \param[in] length  The length of the buffer.
+ * \param[in] classes The SX_CLASS_* bits to skip.
+ *
+ * \returns The position of the first byte at or after i that is not in any of
+ *          the given classes, or length if there is none.
+ */
+unsigned int sx_skip
+    (const char *buf, unsigned int i, unsigned int length,
+     unsigned char classes);
+
+/*! @} */
+
+/**\brief Append Characters to String Builder
+ * \param[in] b      The builder to append to.
+ * \param[in] s      The characters to append.
+ * \param[in] length The number of characters to append.
+ */
+void sx_builder_append_l
+    (struct sexpr_string_builder *b, const char *s, unsigned long length);
+
+/**\brief Release String Builder
+ * \param[in] b The builder to release.
+ *
+ * Frees any memory the builder allocated, without creating a string; the
+ * builder needs to be initialised again before it can be reused.
+ */
+void sx_builder_release (struct sexpr_string_builder *b);
+
+/**\brief Unserialise Custom Type
+ * \param[in] sx A list that was read in.
+ *
+ * \returns An instance of the custom type if the list starts with the code
+ *          point of a registered custom type, or sx itself otherwise.
+ */
+sexpr sx_unserialise (sexpr sx);
+
+/**\brief Write Binary Frame
+ * \param[in] io The context to write to.
+ * \param[in] sx The s-expression to write.
+ */
+void sx_write_binary (struct sexpr_io *io, sexpr sx);
+
+/**\brief Read Binary Frame
+ * \param[in]     io     The context that is being read from.
+ * \param[in,out] i      Position of the frame marker in buf; updated to point
+ *                       past the frame if the frame is complete.
+ * \param[in]     buf    The input buffer.
+ * \param[in]     length The length of the input buffer.
+ *
+ * \returns The s-expression in the frame, or sx_nonexistent if the frame is
+ *          incomplete or broken. Broken frames are skipped.
+ */
+sexpr sx_read_binary
+    (struct sexpr_io *io, unsigned int *i, const char *buf,
+     unsigned int length);
+
+/**\brief Release Binary Encoding State
+ * \param[in] io The context whose symbol tables to release.
+ */
+void sx_release_binary (struct sexpr_io *io);
+
+/**\defgroup sexprImage Heap Images
+ * \ingroup sexpr
+ * \internal
+ *
+ * The constructors in sexpr.c check these before their own hash trees, so
+ * that they hand out the objects from heap images wherever possible.
+ *
+ * @{
+ */
+
+/**\brief Number of Loaded Heap Images
+ *
+ * The lookups below only need to be called if this is nonzero.
+ */
+extern unsigned int sx_images;
+
+/**\brief Find Cons in Heap Images
+ * \param[in] sx_car The car to look for.
+ * \param[in] sx_cdr The cdr to look for.
+ * \param[in] hash   The hash that cons() uses for this pair.
+ *
+ * \returns The cons from an image, or sx_nonexistent.
+ */
+sexpr sx_image_cons (sexpr sx_car, sexpr sx_cdr, int_pointer hash);
+
+/**\brief Find String or Symbol in Heap Images
+ * \param[in] type   Either sxt_string or sxt_symbol.
+ * \param[in] string The characters to look for.
+ * \param[in] length The number of characters.
+ * \param[in] hash   The hash of the characters.
+ *
+ * \returns The string or symbol from an image, or sx_nonexistent.
+ */
+sexpr sx_image_string_or_symbol
+    (enum sx_type type, const char *string, unsigned long length,
+     int_pointer hash);
+
+/**\brief Find Rational in Heap Images
+ * \param[in] p    The numerator to look for.
+ * \param[in] q    The denominator to look for.
+ * \param[in] hash The hash that make_rational() uses for this fraction.
+ *
+ * \returns The rational from an image, or sx_nonexistent.
+ */
+sexpr sx_image_rational (int_pointer p, int_pointer_s q, int_pointer hash);
+
+/**\brief Map Heap Image File
+ * \param[in] path    The image file.
+ * \param[in] address Where the image would like to be mapped.
+ * \param[in] length  The length of the image.
+ *
+ * \returns Where the image was mapped, or (void *)0 if it couldn't be. The
+ *          mapping is read-only if it ended up at address; otherwise it is a
+ *          private, writable copy that can be relocated.
+ */
+void *a_map_image (const char *path, void *address, unsigned long length);
+
+/**\brief Unmap Heap Image File
+ * \param[in] image  What a_map_image() returned.
+ * \param[in] length The length that was passed to a_map_image().
+ *
+ * Used to get rid of images that turned out to be broken.
+ */
+void a_unmap_image (void *image, unsigned long length);
+
+/*! @} */
+
 #ifdef __cplusplus
 }
 #endif
@@ -42,6 +42,7 @@
 
 #include <curie/attributes.h>
 #include <curie/io.h>
+#include <curie/constants.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -120,6 +121,20 @@ struct sexpr_string_or_symbol {
      */
     enum sx_type type;
 
+    /**\brief String Length
+     *
+     * The number of characters in character_data, without the terminating 0.
+     */
+    unsigned int length;
+
+    /**\brief String Hash
+     *
+     * The hash of character_data, as used to hash-cons strings and symbols.
+     * This is 0 for strings and symbols defined with define_string() and
+     * define_symbol(), since those can't be hashed at compile time.
+     */
+    int_pointer hash;
+
     /**\brief String
      *
      * The contained string itself. It's 0-terminated, too.
@@ -280,6 +295,60 @@ sexpr sx_read
 void sx_write
         (struct sexpr_io *io, sexpr sx);
 
+/**\brief Offer Binary Encoding
+ * \param[in] io The context to offer the binary encoding on.
+ *
+ * Tells the peer that we can read the compact binary encoding. Once both sides
+ * have made the offer, and each has read the other's, sx_write() switches to
+ * binary frames: integers become varints, strings are length-prefixed and
+ * symbols that were sent before are sent as small indices. Custom types are
+ * sent in their serialised form, same as with the text syntax.
+ *
+ * sx_read() always accepts both encodings, and the offer itself is skipped as
+ * whitespace by readers that don't know about the binary encoding, so it's
+ * always safe to make the offer.
+ */
+void sx_offer_binary
+        (struct sexpr_io *io);
+
+/**\brief Query Binary Encoding
+ * \param[in] io The context to query.
+ * \return 1 if sx_write() uses the binary encoding on io, 0 otherwise.
+ */
+char sx_binary_negotiated
+        (struct sexpr_io *io);
+
+/**\brief Save Heap Image
+ * \param[in] path  The file to write the image to.
+ * \param[in] roots The s-expression to save.
+ * \return 1 if the image was written, 0 if not.
+ *
+ * Writes roots and everything it refers to, in their in-memory layout, to a
+ * file that sx_image_load() can map straight back into memory. This only works
+ * for the core types; the image isn't written if roots contains anything of a
+ * custom type.
+ */
+char sx_image_save
+        (const char *path, sexpr roots);
+
+/**\brief Load Heap Image
+ * \param[in] path The image file to load.
+ * \return The roots that the image was saved with, or sx_nonexistent if the
+ *         image couldn't be loaded.
+ *
+ * The image is mapped read-only where possible, so loading it takes neither
+ * parsing nor hashing nor allocations. Images stay loaded until the programme
+ * exits, and the garbage collector leaves their contents alone.
+ *
+ * Once an image is loaded, make_string(), make_symbol(), cons() and friends
+ * return the image's objects for values that are in the image, so these
+ * compare as identical to ones created later on. Objects that were created
+ * before the image was loaded aren't replaced, so it's best to load images
+ * right at startup; equalp() treats both copies as equal either way.
+ */
+sexpr sx_image_load
+        (const char *path);
+
 /*! @} */
 
 /**\defgroup sexprConstructors Constructors
@@ -310,6 +379,39 @@ sexpr cons
 #define make_integer(integer)\
         ((sexpr)((((int_pointer_s)(integer)) << 3) | 0x3))
 
+/**\brief Immediate Rational Numerator Bits
+ *
+ * Rational numbers whose numerator and denominator are small enough are kept
+ * in the s-expression itself, much like integers: the numerator in this many
+ * bits, right above the tag, and the denominator in the remaining bits above
+ * that. Both are signed. That's 30 and 31 bits with 64-bit pointers.
+ */
+#define sx_rational_bits ((int)(sizeof (int_pointer) * 4) - 2)
+
+/**\brief Check if a Rational Number fits in an S-Expression
+ * \param[in] p The numerator.
+ * \param[in] q The denominator.
+ * \return 1 if make_rational() would encode p/q without allocating memory.
+ */
+#define sx_rational_fitsp(p,q)\
+        (((int_pointer)((((int_pointer_s)(p)) >> (sx_rational_bits - 1)) + 1)\
+           <= 1) &&\
+         ((int_pointer)((((int_pointer_s)(q)) >> ((int)(sizeof (int_pointer) * 8)\
+                                    - sx_rational_bits - 4)) + 1) <= 1))
+
+/**\brief Encode a small Rational Number
+ * \param[in] p The numerator.
+ * \param[in] q The denominator.
+ * \return The s-expression.
+ *
+ * Used by make_rational() when sx_rational_fitsp() says that it's fine to do
+ * so; the fraction needs to be reduced already, and q must not be 1.
+ */
+#define make_immediate_rational(p,q)\
+        ((sexpr)((((int_pointer)(q)) << (sx_rational_bits + 3)) |\
+                 ((((int_pointer)(p)) &\
+                   ((((int_pointer)1) << sx_rational_bits) - 1)) << 3) | 0x7))
+
 /**\brief Encode a Special S-Expression
  * \param[in] code The value of the new s-expression.
  * \return The s-expression.
@@ -333,7 +435,8 @@ sexpr cons
  */
 #define define_sosi(t,n,s) \
     EXTENSION\
-    static const struct sexpr_string_or_symbol sexpr_payload_ ## n = { t, s };\
+    static const struct sexpr_string_or_symbol sexpr_payload_ ## n\
+        = { t, sizeof (s) - 1, 0, s };\
     static const sexpr n = ((const sexpr)&(sexpr_payload_ ## n))
 
 /**\brief Define String statically
@@ -804,7 +907,17 @@ sexpr equalp
  * This macro determines the type of the given s-expression, and the result is
  * usable as a C boolean.
  */
-#define rationalp(sx) (pointerp(sx) && (((struct sexpr_rational *)sx_pointer(sx))->type == sxt_rational))
+#define rationalp(sx) (immediate_rationalp(sx) || (pointerp(sx) && (((struct sexpr_rational *)sx_pointer(sx))->type == sxt_rational)))
+
+/**\brief Check if the S-Expression is a small Rational Number
+ * \param[in] sx The s-expression to check.
+ * \return 1 if it is a rational number kept in the s-expression itself, 0
+ *         otherwise.
+ *
+ * Such rationals are also rationalp(); there's rarely any need to tell them
+ * apart, except for code that deals with their memory.
+ */
+#define immediate_rationalp(sx) ((((int_pointer)(sx)) & 0x7) == 0x7)
 
 /**\brief Check if the S-Expression is a String
  * \param[in] sx The s-expression to check.
@@ -893,7 +1006,11 @@ sexpr equalp
  * sx_integer() fallback makes sense since regular integers are just rationals
  * with "1" as their denominator.
  */
-#define sx_numerator(sx) ((rationalp(sx)) ?\
+#define sx_numerator(sx) (immediate_rationalp(sx) ?\
+    ((int_pointer)(((int_pointer_s)((int_pointer)(sx) <<\
+        ((int)(sizeof (int_pointer) * 8) - 3 - sx_rational_bits)))\
+      >> ((int)(sizeof (int_pointer) * 8) - sx_rational_bits))) :\
+    (rationalp(sx)) ?\
     ((struct sexpr_rational *)sx)->numerator : sx_integer(sx))
 
 /**\brief Access the Denominator Portion of a Rational Number
@@ -903,7 +1020,9 @@ sexpr equalp
  * Since 0 is not a valid denominator, you could also use this as a type test.
  * Sort of. The other code might still work with 0 denominators.
  */
-#define sx_denominator(sx) ((rationalp(sx)) ?\
+#define sx_denominator(sx) (immediate_rationalp(sx) ?\
+    (((int_pointer_s)(sx)) >> (sx_rational_bits + 3)) :\
+    (rationalp(sx)) ?\
     ((struct sexpr_rational *)sx)->denominator : 0)
 
 /**\brief Access the String Value of a String
@@ -930,6 +1049,25 @@ sexpr equalp
         (((struct sexpr_string_or_symbol *)sx_pointer(sx))->character_data)\
       : "#nonexistent")
 
+/**\brief Access the Length of a String
+ * \param[in] sx The string.
+ * \return The number of characters in the string, or 0 if sx is not a string.
+ *
+ * The length is stored with the string, so this doesn't need to look at the
+ * characters at all.
+ */
+#define sx_string_length(sx) (stringp(sx) ?\
+        (((struct sexpr_string_or_symbol *)sx_pointer(sx))->length) : 0)
+
+/**\brief Access the Length of a Symbol
+ * \param[in] sx The symbol.
+ * \return The number of characters in the symbol, or 0 if sx is not a symbol.
+ *
+ * Analoguous to sx_string_length().
+ */
+#define sx_symbol_length(sx) (symbolp(sx) ?\
+        (((struct sexpr_string_or_symbol *)sx_pointer(sx))->length) : 0)
+
 /**\brief Access the Type Value of a Custom S-Expression
  * \param[in] sx The s-expression.
  * \return The type identifier, or 0 for non-custom s-expressions.
@@ -967,6 +1105,158 @@ sexpr sx_join (sexpr a, sexpr b, sexpr c);
  */
 sexpr sx_to_string (sexpr a);
 
+/**\brief String Builder
+ *
+ * Collects the pieces of a string or symbol without creating any intermediate
+ * sexprs; only the final result is hash-consed. Short strings are built in the
+ * struct itself, longer ones spill over into memory from get_mem(), which is
+ * released again by sx_builder_string() and sx_builder_symbol().
+ *
+ * \note This struct is rather large because of the built-in buffer, so be
+ *       careful when using it in deeply recursive functions.
+ */
+struct sexpr_string_builder
+{
+    /**\brief Buffer
+     *
+     * Points to either stack or a block from get_mem().
+     */
+    char *buffer;
+
+    /**\brief Current Length
+     *
+     * Number of characters in the buffer, excluding the terminating 0.
+     */
+    unsigned long length;
+
+    /**\brief Buffer Size
+     *
+     * Number of bytes available in the buffer.
+     */
+    unsigned long size;
+
+    /**\brief Built-in Buffer
+     *
+     * Used for all strings shorter than STACK_BUFFER_SIZE.
+     */
+    char stack[STACK_BUFFER_SIZE];
+};
+
+/**\brief Initialise String Builder
+ * \param[out] b The builder to initialise.
+ */
+void sx_builder_initialise (struct sexpr_string_builder *b);
+
+/**\brief Append C String to String Builder
+ * \param[in] b The builder to append to.
+ * \param[in] s The 0-terminated string to append.
+ */
+void sx_builder_append_c (struct sexpr_string_builder *b, const char *s);
+
+/**\brief Append sexpr to String Builder
+ * \param[in] b  The builder to append to.
+ * \param[in] sx The string, symbol or integer to append.
+ *
+ * Integers are formatted in decimal right in the builder's buffer, so unlike
+ * with sx_to_string(), no string is created for them. Other types are ignored.
+ */
+void sx_builder_append (struct sexpr_string_builder *b, sexpr sx);
+
+/**\brief Finish String Builder with a String
+ * \param[in] b The builder to finish.
+ * \return A string with the builder's contents.
+ *
+ * This releases any memory the builder allocated; the builder needs to be
+ * initialised again before it can be reused.
+ */
+sexpr sx_builder_string (struct sexpr_string_builder *b);
+
+/**\brief Finish String Builder with a Symbol
+ * \param[in] b The builder to finish.
+ * \return A symbol with the builder's contents.
+ *
+ * Analoguous to sx_builder_string(), but this one creates a symbol.
+ */
+sexpr sx_builder_symbol (struct sexpr_string_builder *b);
+
+/**\brief Join a List of Strings/Symbols
+ * \param[in] list The strings, symbols or integers to join.
+ * \return Concatenation of the list elements, or sx_nil for errors.
+ *
+ * Like sx_join(), but for any number of arguments. The result is a symbol if
+ * the first element is a symbol, and a string otherwise; elements of any other
+ * type are omitted.
+ */
+sexpr sx_join_list (sexpr list);
+
+/**\brief List Builder
+ *
+ * Collects the elements of a list in order, without creating any conses until
+ * the list is finished; the list is then consed together back to front in one
+ * go, so there's no need to build it in reverse and then reverse it again. The
+ * first SX_LIST_BUILDER_SIZE elements are kept in the struct itself, more
+ * spill over into memory from get_mem(), which is released again by
+ * sx_list_builder_finish() and sx_list_builder_release().
+ *
+ * \note The elements are not garbage collector roots.
+ */
+struct sexpr_list_builder
+{
+    /**\brief Elements
+     *
+     * Points to either stack or a block from get_mem().
+     */
+    sexpr *elements;
+
+    /**\brief Current Length
+     *
+     * Number of elements collected so far.
+     */
+    unsigned long length;
+
+    /**\brief Buffer Size
+     *
+     * Number of elements that fit in the buffer.
+     */
+    unsigned long size;
+
+    /**\brief Built-in Buffer
+     *
+     * Used for lists of up to SX_LIST_BUILDER_SIZE elements.
+     */
+    sexpr stack[SX_LIST_BUILDER_SIZE];
+};
+
+/**\brief Initialise List Builder
+ * \param[out] b The builder to initialise.
+ */
+void sx_list_builder_initialise (struct sexpr_list_builder *b);
+
+/**\brief Append to List Builder
+ * \param[in] b  The builder to append to.
+ * \param[in] sx The new last element.
+ */
+void sx_list_builder_append (struct sexpr_list_builder *b, sexpr sx);
+
+/**\brief Finish List Builder
+ * \param[in] b    The builder to finish.
+ * \param[in] tail What to put after the last element; usually
+ *                 sx_end_of_list.
+ * \return The list of all elements that were appended, in order.
+ *
+ * This releases any memory the builder allocated; the builder needs to be
+ * initialised again before it can be reused.
+ */
+sexpr sx_list_builder_finish (struct sexpr_list_builder *b, sexpr tail);
+
+/**\brief Release List Builder
+ * \param[in] b The builder to release.
+ *
+ * Frees any memory the builder allocated without creating a list, e.g. when
+ * bailing out halfway through.
+ */
+void sx_list_builder_release (struct sexpr_list_builder *b);
+
 /**\brief Reverse a List
  * \param[in] sx The list to reverse.
  * \return The reverse of sx.
@@ -31,8 +31,8 @@
  * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
 */
 
-#ifndef LIBCURIE_MULTIPLEX_SYSTEM_H
-#define LIBCURIE_MULTIPLEX_SYSTEM_H
+#ifndef LIBCURIE_SIGNAL_SYSTEM_H
+#define LIBCURIE_SIGNAL_SYSTEM_H
 
 #define HAVE_SIGACTION 1
 #define HAVE_KILL 1
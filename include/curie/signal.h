@@ -122,16 +122,19 @@ void multiplex_signal ();
 /**\brief Catch Signals
  *
  * This function is very similar to multiplex_signal(). The normal method of
- * handling signals uses a memory buffer to store the incoming signals. This
- * works very well with the multiplexer in regular programmes, i.e. those that
- * also wait for incoming data on stdio or some other socket or pipe. However,
- * this method fails to work properly on systems where the multiplexer uses
- * select() when no data is intended to come in through any of the other
- * multiplexers. This method uses the old self-pipe trick to check for
- * triggered signals, which works in this case and is generally more reliable,
- * but it also wastes precious file descriptors which might even be inherited
- * to child processes, which would then possibly also introduce security
- * issues.
+ * handling signals only sets a flag for the incoming signal, and relies on the
+ * signal interrupting the multiplexer's select() call. This works very well
+ * with the multiplexer in regular programmes, i.e. those that also wait for
+ * incoming data on stdio or some other socket or pipe. However, a signal that
+ * comes in right before the select() call won't interrupt it, and if there is
+ * nothing else to wait for then multiplex() doesn't block at all. This method
+ * also makes a wake-up descriptor readable when a signal comes in - an eventfd
+ * on Linux, the old self-pipe trick elsewhere - which works in these cases and
+ * is generally more reliable, but it also uses up a file descriptor which
+ * might even be inherited to child processes.
+ *
+ * With either method, a signal that comes in again before the handlers for
+ * the first one have been run will only have the handlers run once.
  */
 void multiplex_signal_primary ();
 
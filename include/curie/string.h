@@ -48,6 +48,16 @@ extern "C" {
  */
 int_pointer str_hash(const char *data, unsigned long *len);
 
+/**\brief Hash a String with a known Length
+ * \param[in] data The string.
+ * \param[in] len  The length of the string.
+ * \return pointer-sized hash of the string.
+ *
+ * Same as str_hash(), but for strings whose length is already known, or that
+ * aren't terminated with a 0.
+ */
+int_pointer str_hash_l(const char *data, unsigned long len);
+
 #ifdef __cplusplus
 }
 #endif
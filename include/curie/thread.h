@@ -0,0 +1,91 @@
+/**\file
+ * \brief Threads
+ *
+ * Very basic support for running a function in a separate thread that shares
+ * the address space with its creator. None of curie's data structures are
+ * safe to use from more than one thread at a time, so the functions run this
+ * way need to be very careful about what they touch; in particular, they must
+ * not allocate memory.
+ *
+ * Threads are not available on all platforms, in which case thread_create()
+ * always fails; code using threads should fall back to doing the work itself.
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+ */
+
+#ifndef LIBCURIE_THREAD_H
+#define LIBCURIE_THREAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**\brief Thread Handle
+ *
+ * The contents of this struct depend on the platform.
+ */
+struct thread;
+
+/**\brief Start a Thread
+ * \param[in] function The function to run in the new thread.
+ * \param[in] aux      Passed to function.
+ *
+ * \return The new thread, or (struct thread *)0 if the thread could not be
+ *         created or if threads are not supported at all.
+ *
+ * The thread ends when function returns. Every thread that was created
+ * successfully must be passed to thread_join() eventually.
+ */
+struct thread *thread_create (void (*function)(void *), void *aux);
+
+/**\brief Wait for a Thread to end
+ * \param[in] thread The thread to wait for.
+ *
+ * Blocks until the thread has ended, then releases its resources.
+ */
+void thread_join (struct thread *thread);
+
+/**\brief Index of the current Thread
+ *
+ * \return A number below THREAD_MAX that no other running thread has; 0 for
+ *         the programme's main thread, or on platforms without threads.
+ *
+ * Indices are handed out by thread_create() and are reused once a thread has
+ * been passed to thread_join(), so they're good for indexing per-thread data.
+ */
+unsigned int thread_index (void);
+
+/**\brief Let other Threads run
+ *
+ * Gives up the processor, so that other threads get to run. Meant for use in
+ * spin loops.
+ */
+void thread_yield (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
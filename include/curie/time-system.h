@@ -38,8 +38,19 @@
 extern "C" {
 #endif
 
+#include <curie/time.h>
+
 long long __a_time();
 
+/**\brief Read a System Clock
+ * \param[in]  clock       The clock to read.
+ * \param[out] seconds     Seconds; since the unix epoch for dtc_realtime.
+ * \param[out] nanoseconds Nanoseconds since the start of the second.
+ * \return 1 on success, 0 if the clock couldn't be read.
+ */
+char a_clock
+    (enum dt_clock clock, int_64_s *seconds, unsigned long *nanoseconds);
+
 #ifdef __cplusplus
 }
 #endif
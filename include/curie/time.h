@@ -81,6 +81,20 @@ struct datetime
 {
     int_date      date;      /*!< Days since the epoch */
     unsigned int  time;      /*!< Seconds since the start of the day */
+    unsigned int  nanoseconds; /*!< Nanoseconds since the start of the second;
+                                    0 where the OS doesn't say */
+};
+
+/**\brief Clocks
+ * The different clocks that dt_get_nanoseconds() can read.
+ */
+enum dt_clock
+{
+    dtc_realtime,  /*!< Wall clock time, since the unix epoch; may jump */
+    dtc_monotonic, /*!< Since an arbitrary point; never jumps, but doesn't
+                        advance while the system is suspended */
+    dtc_boot_time  /*!< Like dtc_monotonic, but including time spent in
+                        suspend */
 };
 
 /**\brief Get the current Date
@@ -121,6 +135,17 @@ unsigned int    dt_get_time  (void);
  */
 struct datetime dt_get       (void);
 
+/**\brief Read a Clock
+ * \param[in] clock The clock to read.
+ * \return The clock's current value, in nanoseconds.
+ * Where possible, this doesn't need to enter the kernel at all; on Linux, the
+ * clocks are read through the vDSO. For dtc_realtime, the value is relative to
+ * the unix epoch; for the other clocks, only differences between values are
+ * meaningful. The actual resolution depends on the OS, and may be as coarse as
+ * a second.
+ */
+int_64          dt_get_nanoseconds (enum dt_clock clock);
+
 #ifdef __cplusplus
 }
 #endif
@@ -63,6 +63,53 @@ unsigned int utf8_get_character (const int_8 *b, unsigned int p, int_32 *c);
  */
 unsigned int utf8_encode (int_8 *b, unsigned int c);
 
+/**\brief Validate a UTF-8 encoded Buffer
+ * \param[in] b      The buffer to validate.
+ * \param[in] length The number of bytes in b.
+ * \return The length of the longest prefix of b that is valid UTF-8; this is
+ *         length if all of b is valid.
+ * Validation is strict, as per RFC 3629: overlong encodings, surrogates and
+ * code points above 0x10ffff are rejected, and so is a sequence that is cut
+ * off by the end of the buffer. Runs of ASCII characters are skipped with
+ * utf8_skip_ascii().
+ */
+unsigned long utf8_validate (const int_8 *b, unsigned long length);
+
+/**\brief Skip ASCII Characters in a UTF-8 encoded Buffer
+ * \param[in] b      The buffer to examine.
+ * \param[in] p      The position to start at.
+ * \param[in] length The number of bytes in b.
+ * \return The position of the first byte at or after p that isn't ASCII, or
+ *         length if there isn't one.
+ * This is what utf8_validate() and utf8_decode() use to get through runs of
+ * ASCII; the generic version looks at a couple of machine words at a time,
+ * while some platforms have a vectorised version.
+ */
+unsigned long utf8_skip_ascii
+        (const int_8 *b, unsigned long p, unsigned long length);
+
+/**\brief Count Characters in a UTF-8 encoded Buffer
+ * \param[in] b      The buffer to examine.
+ * \param[in] length The number of bytes in b.
+ * \return The number of code points in b.
+ * This simply counts the bytes that aren't continuation bytes, so the result
+ * is only meaningful for valid input; use utf8_validate() first if in doubt.
+ */
+unsigned long utf8_count (const int_8 *b, unsigned long length);
+
+/**\brief Decode a UTF-8 encoded Buffer
+ * \param[in]  b      The buffer to decode.
+ * \param[in]  length The number of bytes in b.
+ * \param[out] c      Receives the code points; needs room for utf8_count()
+ *                    elements, or for length elements to be on the safe side.
+ * \param[out] n      Receives the number of code points written to c.
+ * \return The number of bytes that were decoded; this is less than length if
+ *         b contains a sequence that utf8_validate() would reject, in which
+ *         case decoding stops right in front of that sequence.
+ */
+unsigned long utf8_decode
+        (const int_8 *b, unsigned long length, int_32 *c, unsigned long *n);
+
 /**\brief Is the given byte an UTF-8 multibyte sequence start character?
  * \param[in] c Character to test
  * \return Something that evaluates to true if the condition holds, and false
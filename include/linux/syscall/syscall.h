@@ -1158,6 +1158,10 @@ define_syscall2 (__NR_ioprio_get, ioprio_get, sys_ioprio_get, long, int, int)
 #define have_sys_inotify_init
 define_syscall0 (__NR_inotify_init, inotify_init, sys_inotify_init, long)
 #endif
+#ifdef __NR_inotify_init1
+#define have_sys_inotify_init1
+define_syscall1 (__NR_inotify_init1, inotify_init1, sys_inotify_init1, long, int)
+#endif
 #ifdef __NR_inotify_add_watch
 #define have_sys_inotify_add_watch
 define_syscall3 (__NR_inotify_add_watch, inotify_add_watch, sys_inotify_add_watch, long, int, const char *, int)
@@ -1300,6 +1304,18 @@ define_syscall1 (__NR_eventfd, eventfd, sys_eventfd, long, unsigned int)
 #define have_sys_fallocate
 define_syscall4 (__NR_fallocate, fallocate, sys_fallocate, long, int, int, int, int)
 #endif
+#ifdef __NR_memfd_create
+#define have_sys_memfd_create
+define_syscall2 (__NR_memfd_create, memfd_create, sys_memfd_create, long, const char *, unsigned int)
+#endif
+#ifdef __NR_io_uring_setup
+#define have_sys_io_uring_setup
+define_syscall2 (__NR_io_uring_setup, io_uring_setup, sys_io_uring_setup, long, unsigned int, void *)
+#endif
+#ifdef __NR_io_uring_enter
+#define have_sys_io_uring_enter
+define_syscall6 (__NR_io_uring_enter, io_uring_enter, sys_io_uring_enter, long, unsigned int, unsigned int, unsigned int, unsigned int, void *, unsigned long)
+#endif
 
 #ifdef __NR_socketcall
 #define have_sys_socketcall
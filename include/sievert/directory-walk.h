@@ -0,0 +1,82 @@
+/**\file
+ * \brief Directory Walks
+ *
+ * Recursively walks directory trees in the background, with a small pool of
+ * threads, and reports everything it finds through the multiplexer. The
+ * threads never touch any sexprs; all of those are created in the thread
+ * that runs multiplex().
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#ifndef LIBSIEVERT_DIRECTORY_WALK_H
+#define LIBSIEVERT_DIRECTORY_WALK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <curie/sexpr.h>
+#include <sievert/metadata.h>
+
+/**\brief Initialise Directory Walk Multiplexer
+ *
+ * Call this before using multiplex_add_directory_walk(). This also initialises
+ * the I/O multiplexer, which is used to find out when there are results.
+ */
+void multiplex_directory_walk ( void );
+
+/**\brief Walk a Directory Tree
+ * \param[in] root     The directory to start in.
+ * \param[in] threads  The number of threads to use; 0 picks a default.
+ * \param[in] metadata Whether to gather metadata for each entry.
+ * \param[in] on_entry Called for each entry with its path and, if requested,
+ *                     its metadata; (struct metadata *)0 otherwise.
+ * \param[in] on_done  Called once after on_entry was called for every entry;
+ *                     may be 0.
+ * \param[in] aux      Passed to the callbacks.
+ *
+ * Every file and directory below root is reported exactly once, in no
+ * particular order; the paths start with root. Symbolic links are reported,
+ * but not followed. The metadata describes the entry itself, not what a
+ * symbolic link points to.
+ *
+ * The callbacks are only ever called from multiplex(). The struct metadata is
+ * only valid during the on_entry callback.
+ *
+ * \note On systems without threads, the walk happens right away and the
+ *       callbacks are called before this function returns. Symbolic links to
+ *       directories may be followed there.
+ */
+void multiplex_add_directory_walk
+        (const char *root, unsigned int threads, char metadata,
+         void (*on_entry)(sexpr, struct metadata *, void *),
+         void (*on_done)(void *), void *aux);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
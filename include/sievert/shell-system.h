@@ -0,0 +1,87 @@
+/**\file
+ * \brief Shell Helpers (System Specific)
+ * \internal
+ *
+ * Watching directories for changes, so that ewhich() can cache its results
+ * for as long as none of the PATH directories have changed. How this is done
+ * depends on the operating system; where there's no way at all to do this,
+ * directory_watch_create() fails and ewhich() doesn't cache anything.
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+ */
+
+#ifndef LIBSIEVERT_SHELL_SYSTEM_H
+#define LIBSIEVERT_SHELL_SYSTEM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**\brief Directory Watch
+ * \internal
+ *
+ * The contents of this struct depend on the operating system.
+ */
+struct directory_watch;
+
+/**\brief Create Directory Watch
+ * \internal
+ *
+ * \return A new directory watch without any directories, or
+ *         (struct directory_watch *)0 if directories can't be watched.
+ */
+struct directory_watch *directory_watch_create ( void );
+
+/**\brief Watch Directory
+ * \internal
+ * \param[in] watch     The watch to add the directory to.
+ * \param[in] directory The directory to watch.
+ *
+ * \return 1 if the directory is being watched, 0 if it isn't, e.g. because it
+ *         doesn't exist.
+ */
+char directory_watch_add
+        (struct directory_watch *watch, const char *directory);
+
+/**\brief Check Directory Watch
+ * \internal
+ * \param[in] watch The watch to check.
+ *
+ * \return 1 if any of the watched directories have changed since the last
+ *         call, or since they were added; 0 otherwise.
+ */
+char directory_watch_changed (struct directory_watch *watch);
+
+/**\brief Destroy Directory Watch
+ * \internal
+ * \param[in] watch The watch to destroy.
+ */
+void directory_watch_destroy (struct directory_watch *watch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
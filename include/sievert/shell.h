@@ -57,6 +57,26 @@ sexpr ewhich (char **environment, sexpr programme);
  */
 #define which(programme) ewhich (curie_environment, programme)
 
+/**\brief Look up several Programme Files in the PATH
+ * \param[in] environment The environment to look up PATH in.
+ * \param[in] programmes  A list of programmes to search for.
+ * \return A list with one element per programme, in the same order; each
+ *         element is what ewhich() would have returned for that programme.
+ *
+ * Where the operating system allows watching directories for changes, results
+ * are cached until PATH or one of its directories changes, so looking up the
+ * same programmes over and over again is cheap.
+ */
+sexpr ewhich_batch (char **environment, sexpr programmes);
+
+/**\brief Look up several Programme Files in the PATH
+ * \param[in] programmes  A list of programmes to search for.
+ * \return A list with the results of which() for each of the programmes.
+ *
+ * Analoguous to ewhich_batch(), but it defaults to curie's environment.
+ */
+#define which_batch(programmes) ewhich_batch (curie_environment, programmes)
+
 #ifdef __cplusplus
 }
 #endif
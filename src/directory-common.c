@@ -48,6 +48,37 @@ sexpr read_directory_sx (sexpr rx)
     return r;
 }
 
+char read_directory_component_rxp (const char *t)
+{
+    unsigned int cx;
+
+    if ((t[0] == '.') && ((t[1] == 0) || ((t[1] == '.') && (t[2] == 0))))
+    {
+        return 0;
+    }
+
+    for (cx = 0; t[cx]; cx++)
+    {
+        switch (t[cx])
+        {
+            case '\\':
+            case '?':
+            case '*':
+            case '+':
+            case '(':
+            case ')':
+            case '|':
+            case '[':
+            case '.':
+                return 1;
+            default:
+                break;
+        }
+    }
+
+    return 0;
+}
+
 sexpr read_directory_w  (const char *p, char **map, char *mapd)
 {
     sexpr r = sx_end_of_list;
@@ -90,31 +121,7 @@ sexpr read_directory_w  (const char *p, char **map, char *mapd)
 
         if (map[c][0] == 0) continue;
 
-        if (!((t[0] == '.') &&
-               ((t[1] == 0) || ((t[1] == '.') && (t[2] == 0)))))
-        {
-            unsigned int cx;
-
-            for (cx = 0; (regex == 0) && t[cx]; cx++)
-            {
-                switch (t[cx])
-                {
-                    case '\\':
-                    case '?':
-                    case '*':
-                    case '+':
-                    case '(':
-                    case ')':
-                    case '|':
-                    case '[':
-                    case '.':
-                        regex = 1;
-                        break;
-                    default:
-                        break;
-                }
-            }
-        }
+        regex = read_directory_component_rxp (t);
 
         if (regex)
         {
@@ -0,0 +1,97 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/directory.h>
+#include <sievert/directory-walk.h>
+
+/* no threads here, so the whole walk happens right away */
+
+struct walk
+{
+    void (*on_entry)(sexpr, struct metadata *, void *);
+    sexpr path;
+    void *aux;
+};
+
+static void with_metadata (struct metadata *metadata, void *aux)
+{
+    struct walk *w = (struct walk *)aux;
+
+    w->on_entry (w->path, metadata, w->aux);
+}
+
+static void walk (sexpr base, char metadata,
+                  void (*on_entry)(sexpr, struct metadata *, void *),
+                  void *aux)
+{
+    define_string (str_slash, "/");
+    sexpr rx = rx_compile (".*"), e, path, name;
+    const char *s;
+
+    for (e = read_directory_rx (sx_string (base), rx); consp (e); e = cdr (e))
+    {
+        name = car (e);
+        s = sx_string (name);
+
+        if ((s[0] == '.') && ((s[1] == 0) || ((s[1] == '.') && (s[2] == 0))))
+        {
+            continue;
+        }
+
+        path = sx_join (base, str_slash, name);
+
+        if (metadata)
+        {
+            struct walk w = { on_entry, path, aux };
+
+            metadata_from_path (sx_string (path), with_metadata, (void *)&w);
+        }
+        else
+        {
+            on_entry (path, (struct metadata *)0, aux);
+        }
+
+        walk (path, metadata, on_entry, aux);
+    }
+}
+
+void multiplex_directory_walk ( void )
+{
+}
+
+void multiplex_add_directory_walk
+        (const char *root, unsigned int threads, char metadata,
+         void (*on_entry)(sexpr, struct metadata *, void *),
+         void (*on_done)(void *), void *aux)
+{
+    walk (make_string (root), metadata, on_entry, aux);
+
+    if (on_done != (void (*)(void *))0)
+    {
+        on_done (aux);
+    }
+}
@@ -31,244 +31,631 @@
 #include <curie/sexpr-internal.h>
 #include <curie/memory.h>
 #include <curie/internal-constants.h>
+#include <curie/thread.h>
 
-static sexpr *gc_calls, **gc_roots, *gc_pointer;
-static unsigned long gc_call_size, gc_roots_size = 0;
+#define GC_NO_ROOT ((gc_root)~0)
+
+struct gc_root_slot
+{
+    sexpr   *root;
+    gc_root  next_free;
+};
+
+static sexpr *gc_calls = (sexpr *)0;
+static struct gc_root_slot *gc_roots;
+static unsigned long gc_call_size, gc_call_count, gc_roots_size = 0,
+                     gc_roots_used = 0;
+static int_pointer gc_call_mask;
+static gc_root gc_roots_free = GC_NO_ROOT;
 static char cancel = 0;
 
-void gc_add_root (sexpr *sx)
+struct gc_frame *gc_frames       = (struct gc_frame *)0;
+char             gc_scan_stack   = (char)1;
+unsigned int     gc_mark_threads = 1;
+
+char             gc_lazy_sweep   = (char)0;
+char             gc_sweeping     = (char)0;
+
+/* set while worker threads are marking, in which case marks need to be set
+   atomically */
+static char gc_parallel = (char)0;
+
+/* position of the lazy sweep in the candidate table, and whether it's being
+   worked on right now; custom destroy() functions may well allocate */
+static unsigned long gc_sweep_cursor;
+static char gc_sweep_busy = (char)0;
+
+/* set when a lazy sweep has finished, but the candidate table hasn't been
+   freed and the pools haven't been optimised yet; see gc_tidy() */
+static char gc_untidy = (char)0;
+
+gc_root gc_register_root (sexpr *sx)
 {
-    sexpr **rootp, **roote;
+    gc_root r;
 
-    if (gc_roots_size == 0)
+    if (gc_roots_free != GC_NO_ROOT)
     {
-        gc_roots_size = LIBCURIE_PAGE_SIZE;
-        gc_roots      = get_mem (LIBCURIE_PAGE_SIZE);
+        r             = gc_roots_free;
+        gc_roots_free = gc_roots[r].next_free;
     }
-
-  retry:
-    for (rootp = gc_roots, roote = (sexpr**)((char *)rootp + gc_roots_size);
-         rootp < roote; rootp++)
+    else
     {
-        if ((*rootp) == (sexpr *)0)
+        if (gc_roots_size == 0)
         {
-            *rootp = sx;
-            return;
+            gc_roots_size = LIBCURIE_PAGE_SIZE;
+            gc_roots      = get_mem (LIBCURIE_PAGE_SIZE);
         }
+        else if (((gc_roots_used + 1) * sizeof (struct gc_root_slot))
+                 > gc_roots_size)
+        {
+            gc_roots = resize_mem (gc_roots_size, gc_roots,
+                                   gc_roots_size + LIBCURIE_PAGE_SIZE);
+            gc_roots_size += LIBCURIE_PAGE_SIZE;
+        }
+
+        r = gc_roots_used;
+        gc_roots_used++;
     }
 
-    gc_roots = resize_mem (gc_roots_size, gc_roots,
-                           gc_roots_size + LIBCURIE_PAGE_SIZE);
-    gc_roots_size += LIBCURIE_PAGE_SIZE;
+    gc_roots[r].root      = sx;
+    gc_roots[r].next_free = GC_NO_ROOT;
+
+    return r;
+}
+
+void gc_unregister_root (gc_root r)
+{
+    if ((r < gc_roots_used) && (gc_roots[r].root != (sexpr *)0))
+    {
+        gc_roots[r].root      = (sexpr *)0;
+        gc_roots[r].next_free = gc_roots_free;
+        gc_roots_free         = r;
+    }
+}
 
-    goto retry;
+void gc_add_root (sexpr *sx)
+{
+    (void)gc_register_root (sx);
 }
 
 void gc_remove_root (sexpr *sx)
 {
-    sexpr **rootp, **roote;
+    gc_root r;
 
-    for (rootp = gc_roots, roote = (sexpr**)((char *)rootp + gc_roots_size);
-         rootp < roote; rootp++)
+    for (r = 0; r < gc_roots_used; r++)
     {
-        if ((*rootp) == sx)
+        if (gc_roots[r].root == sx)
         {
-            *rootp = (sexpr*)0;
+            gc_unregister_root (r);
             return;
         }
     }
 }
 
-static void gc_tag_sub (sexpr sx, sexpr *left, sexpr *right)
+/* the candidates for collection live in an open addressing hash table, keyed
+   by their address; marking an entry sets its lowest bit, which is always
+   clear for pointers. */
+#define gc_mark ((int_pointer)0x1)
+
+#define gc_hash(sx)\
+    (((((int_pointer)(sx)) >> 3) * (int_pointer)2654435761UL) ^\
+     ((((int_pointer)(sx)) >> 3) >> 15))
+
+static sexpr *gc_find (sexpr sx)
 {
-    sexpr l, r, *p1, *p2;
-    int d = 0;
+    int_pointer h = gc_hash (sx);
+    sexpr e;
 
-    do
+    for (h &= gc_call_mask; (e = gc_calls[h]) != (sexpr)0;
+         h = (h + 1) & gc_call_mask)
     {
-        while ((r = *right) == 0)
+        if (e == sx)
         {
-            right--;
-
-            if (right < left) return;
+            return gc_calls + h;
         }
-
-        while ((l = *left) == 0)
+        else if (e == (sexpr)((int_pointer)sx | gc_mark))
         {
-            left++;
-
-            if (left > right) return;
+            break;
         }
+    }
 
-        if ((l > sx) || (r < sx))
+    return (sexpr *)0;
+}
+
+static void gc_insert (sexpr *table, int_pointer mask, sexpr sx)
+{
+    int_pointer h;
+
+    for (h = gc_hash (sx) & mask; table[h] != (sexpr)0; h = (h + 1) & mask)
+    {
+        if (table[h] == sx)
         {
             return;
         }
+    }
+
+    table[h] = sx;
+    gc_call_count++;
+}
+
+#if defined(__GNUC__)
+#define gc_claim_atomic(slot,sx)\
+    __sync_bool_compare_and_swap\
+        ((slot), (sx), (sexpr)((int_pointer)(sx) | gc_mark))
+#else
+#define gc_claim_atomic(slot,sx)\
+    ((*(slot) = (sexpr)((int_pointer)(sx) | gc_mark)), 1)
+#endif
+
+/* mark sx if it's a candidate that isn't marked yet; returns nonzero if the
+   caller is responsible for tagging whatever sx refers to */
+static int gc_claim (sexpr sx)
+{
+    sexpr *slot;
 
-        if ((l == sx) || (r == sx))
+    if (!pointerp (sx) || ((slot = gc_find (sx)) == (sexpr *)0))
+    {
+        return 0;
+    }
+
+    if (gc_parallel)
+    {
+        return gc_claim_atomic (slot, sx);
+    }
+
+    *slot = (sexpr)((int_pointer)sx | gc_mark);
+
+    return 1;
+}
+
+static void gc_tag_custom (sexpr sx)
+{
+    int type = sx_type (sx);
+
+    struct sexpr_type_descriptor *d = sx_get_descriptor (type);
+
+    if ((d != (struct sexpr_type_descriptor *)0) &&
+        (d->tag != (void *)0))
+    {
+        d->tag (sx);
+    }
+}
+
+/* the parallel mark phase: every thread has a deque of marked objects that
+   still need to be scanned. threads work from the bottom of their own deque
+   and steal from the top of the others' deques once theirs runs dry. */
+
+#define GC_DEQUE_SIZE 0x1000
+
+struct gc_worker
+{
+    volatile int     lock;
+    volatile int_pointer top;
+    volatile int_pointer bottom;
+    struct thread   *thread;
+    int_pointer      size;
+    sexpr           *entries;
+};
+
+static struct gc_worker *gc_workers;
+static struct gc_worker *gc_worker_by_thread[THREAD_MAX];
+static unsigned int gc_worker_count, gc_worker_next;
+static volatile unsigned int gc_workers_active;
+
+#if defined(__GNUC__)
+#define gc_lock(w)\
+    while (__sync_lock_test_and_set (&((w)->lock), 1)) thread_yield ()
+#define gc_unlock(w)\
+    __sync_lock_release (&((w)->lock))
+#define gc_active_add(n)\
+    (void)__sync_fetch_and_add (&gc_workers_active, (n))
+#else
+#define gc_lock(w)
+#define gc_unlock(w)
+#define gc_active_add(n)\
+    (gc_workers_active += (n))
+#endif
+
+static void gc_scan (struct gc_worker *w, sexpr sx);
+
+/* called with the deque locked; scanning things right away instead would
+   recurse, and the mark threads don't have a lot of stack */
+static void gc_grow (struct gc_worker *w)
+{
+    int_pointer size = w->size * 2, i;
+    sexpr *entries = get_mem (size * sizeof (sexpr));
+
+    if (entries == (sexpr *)0)
+    {
+        return;
+    }
+
+    for (i = w->top; i != w->bottom; i++)
+    {
+        entries[i % size] = w->entries[i % w->size];
+    }
+
+    free_mem (w->size * sizeof (sexpr), w->entries);
+
+    w->entries = entries;
+    w->size    = size;
+}
+
+static void gc_push (struct gc_worker *w, sexpr sx)
+{
+    gc_lock (w);
+
+    if ((w->bottom - w->top) == w->size)
+    {
+        gc_grow (w);
+    }
+
+    if ((w->bottom - w->top) < w->size)
+    {
+        w->entries[w->bottom % w->size] = sx;
+        w->bottom++;
+
+        gc_unlock (w);
+    }
+    else
+    {
+        /* no more memory, so scan it right away */
+        gc_unlock (w);
+        gc_scan (w, sx);
+    }
+}
+
+static int gc_pop (struct gc_worker *w, sexpr *sx)
+{
+    int rv = 0;
+
+    gc_lock (w);
+
+    if (w->bottom != w->top)
+    {
+        w->bottom--;
+        *sx = w->entries[w->bottom % w->size];
+        rv  = 1;
+    }
+
+    gc_unlock (w);
+
+    return rv;
+}
+
+static int gc_steal (struct gc_worker *w, sexpr *sx)
+{
+    unsigned int i;
+
+    for (i = 0; i < gc_worker_count; i++)
+    {
+        struct gc_worker *v = gc_workers + i;
+
+        if ((v != w) && (v->bottom != v->top))
         {
-            if (l == sx)
-            {
-                *left = (sexpr)0;
-            }
-            else
+            int rv = 0;
+
+            gc_lock (v);
+
+            if (v->bottom != v->top)
             {
-                *right = (sexpr)0;
+                *sx = v->entries[v->top % v->size];
+                v->top++;
+                rv  = 1;
             }
 
-            if (consp (sx))
+            gc_unlock (v);
+
+            if (rv)
             {
-                l = car (sx);
-                r = cdr (sx);
-
-                if (pointerp (l))
-                {
-                    if (pointerp (r))
-                    {
-                        gc_tag (r);
-                    }
-
-                    sx = l;
-                    left = gc_calls;
-                    right = gc_pointer;
-                }
-                else if (pointerp (r))
-                {
-                    sx = r;
-                    left = gc_calls;
-                    right = gc_pointer;
-                }
+                return 1;
             }
-            else if (customp (sx))
-            {
-                int type = sx_type (sx);
+        }
+    }
 
-                struct sexpr_type_descriptor *d = sx_get_descriptor (type);
+    return 0;
+}
 
-                if ((d != (struct sexpr_type_descriptor *)0) &&
-                    (d->tag != (void *)0))
-                {
-                    d->tag (sx);
-                }
+static int gc_work_left (void)
+{
+    unsigned int i;
 
-                return;
-            }
-            else
-            {
-                return;
-            }
+    for (i = 0; i < gc_worker_count; i++)
+    {
+        if (gc_workers[i].bottom != gc_workers[i].top)
+        {
+            return 1;
         }
+    }
+
+    return 0;
+}
 
-        if ((d = (right - left)) > 1)
+/* sx has already been claimed; the cars of conses go on the deque so other
+   threads can pick them up, the cdrs are followed right away. */
+static void gc_scan (struct gc_worker *w, sexpr sx)
+{
+    while (consp (sx))
+    {
+        sexpr a = car (sx);
+
+        if (gc_claim (a))
         {
-            p1 = left + (d / 2);
-            p2 = p1;
+            gc_push (w, a);
+        }
 
-            while ((r = *p1) == 0)
-            {
-                p1--;
+        sx = cdr (sx);
 
-                if (p1 < left) return;
-            }
+        if (!gc_claim (sx))
+        {
+            return;
+        }
+    }
 
-            while ((l = *p2) == 0)
-            {
-                p2++;
+    if (customp (sx))
+    {
+        gc_tag_custom (sx);
+    }
+}
 
-                if (p2 > right) return;
-            }
+void gc_tag (sexpr sx)
+{
+    /* the mark threads have small stacks, so whatever custom types tag goes
+       on the deque instead of being followed right here */
+    if (gc_parallel)
+    {
+        if (gc_claim (sx))
+        {
+            gc_push (gc_worker_by_thread[thread_index ()], sx);
+        }
 
-            if (sx >= l)
-            {
-                left = p2;
-            }
-            else if (sx <= r)
+        return;
+    }
+
+    /* conses are followed along the cdr iteratively, so that long lists don't
+       eat up the stack */
+    while (gc_claim (sx))
+    {
+        if (consp (sx))
+        {
+            sexpr a = car (sx);
+
+            if (pointerp (a))
             {
-                right = p1;
+                gc_tag (a);
             }
-            else
+
+            sx = cdr (sx);
+        }
+        else if (customp (sx))
+        {
+            gc_tag_custom (sx);
+            return;
+        }
+        else
+        {
+            return;
+        }
+    }
+}
+
+static void gc_mark_worker (void *aux)
+{
+    struct gc_worker *w = (struct gc_worker *)aux;
+    sexpr sx;
+
+    gc_worker_by_thread[thread_index ()] = w;
+
+    for (;;)
+    {
+        while (gc_pop (w, &sx) || gc_steal (w, &sx))
+        {
+            gc_scan (w, sx);
+        }
+
+        /* only threads that are still active can add to the deques, and they
+           empty their own deque before going idle, so once nobody's active
+           we're done */
+        gc_active_add (-1);
+
+        while (!gc_work_left ())
+        {
+            if (gc_workers_active == 0)
             {
                 return;
             }
+
+            thread_yield ();
         }
-    } while (d > 1);
+
+        gc_active_add (1);
+    }
 }
 
-void gc_tag (sexpr sx)
+static void gc_grey_serial (sexpr sx, void *aux)
 {
-    gc_tag_sub (sx, gc_calls, gc_pointer);
+    gc_tag (sx);
 }
 
-void gc_call (sexpr sx)
+static void gc_grey_parallel (sexpr sx, void *aux)
+{
+    if (gc_claim (sx))
+    {
+        gc_push (gc_workers + gc_worker_next, sx);
+        gc_worker_next = (gc_worker_next + 1) % gc_worker_count;
+    }
+}
+
+static void gc_mark_roots
+    (void (*grey)(sexpr, void *), void *aux, sexpr *l, int step)
 {
-    sexpr *map;
-    if (cancel) return;
+    struct gc_frame *f;
+    gc_root r;
+    unsigned int i;
+    sexpr *t;
 
-    if (gc_pointer < (sexpr*)((int_pointer)gc_calls + gc_call_size))
+    for (r = 0; r < gc_roots_used; r++)
     {
-      add:
-        *gc_pointer = sx;
-        gc_pointer++;
-        return;
+        if (gc_roots[r].root != (sexpr *)0)
+        {
+            grey (*(gc_roots[r].root), aux);
+        }
     }
 
-    map = resize_mem (gc_call_size, gc_calls, gc_call_size + LIBCURIE_PAGE_SIZE);
+    for (f = gc_frames; f != (struct gc_frame *)0; f = f->previous)
+    {
+        for (i = 0; i < f->count; i++)
+        {
+            if (pointerp (f->locals[i]))
+            {
+                grey (f->locals[i], aux);
+            }
+        }
+    }
 
-    gc_pointer = (sexpr *)((int_pointer)map +
-                   ((int_pointer)gc_pointer - (int_pointer)gc_calls));
-    gc_calls = map;
-    gc_call_size += LIBCURIE_PAGE_SIZE;
+    if (gc_scan_stack)
+    {
+        for (t = stack_start_address; t != l; t += step)
+        {
+            sexpr e = *t;
 
-    goto add;
+            if (pointerp (e) && (e != (sexpr)0))
+            {
+                grey (e, aux);
+            }
+        }
+    }
 }
 
-static int partition (int left, int right, int pivot)
+static void gc_free_workers (unsigned int n)
 {
-    int index, i;
-    sexpr value = gc_calls[pivot], t;
+    unsigned int i;
+
+    for (i = 0; i < n; i++)
+    {
+        free_mem (gc_workers[i].size * sizeof (sexpr), gc_workers[i].entries);
+    }
 
-    gc_calls[pivot] = gc_calls[right];
-    gc_calls[right] = value;
+    free_mem (sizeof (struct gc_worker) * gc_mark_threads, gc_workers);
+}
 
-    index = left;
+static int gc_mark_parallel (sexpr *l, int step)
+{
+    unsigned int i;
+    unsigned long size = sizeof (struct gc_worker) * gc_mark_threads;
 
-    for (i = left; i < right; i++)
+    gc_workers = get_mem (size);
+
+    if (gc_workers == (struct gc_worker *)0)
     {
-        if (gc_calls[i] <= value)
+        return 0;
+    }
+
+    gc_worker_count = gc_mark_threads;
+    gc_worker_next  = 0;
+
+    for (i = 0; i < gc_worker_count; i++)
+    {
+        gc_workers[i].lock    = 0;
+        gc_workers[i].top     = 0;
+        gc_workers[i].bottom  = 0;
+        gc_workers[i].thread  = (struct thread *)0;
+        gc_workers[i].size    = GC_DEQUE_SIZE;
+        gc_workers[i].entries = get_mem (GC_DEQUE_SIZE * sizeof (sexpr));
+
+        if (gc_workers[i].entries == (sexpr *)0)
         {
-            t = gc_calls[i];
-            gc_calls[i] = gc_calls[index];
-            gc_calls[index] = t;
+            gc_free_workers (i);
+            return 0;
+        }
+    }
+
+    gc_parallel = (char)1;
+
+    gc_mark_roots (gc_grey_parallel, (void *)0, l, step);
+
+    /* we're the first worker ourselves; workers that can't be started are
+       simply not counted, their deques get emptied by the others */
+    gc_workers_active = gc_worker_count;
 
-            index++;
+    for (i = 1; i < gc_worker_count; i++)
+    {
+        gc_workers[i].thread
+            = thread_create (gc_mark_worker, (void *)(gc_workers + i));
+
+        if (gc_workers[i].thread == (struct thread *)0)
+        {
+            gc_active_add (-1);
+        }
+    }
+
+    gc_mark_worker ((void *)gc_workers);
+
+    for (i = 1; i < gc_worker_count; i++)
+    {
+        if (gc_workers[i].thread != (struct thread *)0)
+        {
+            thread_join (gc_workers[i].thread);
         }
     }
 
-    t = gc_calls[index];
-    gc_calls[index] = gc_calls[right];
-    gc_calls[right] = t;
+    gc_parallel = (char)0;
 
-    return index;
+    gc_free_workers (gc_worker_count);
+
+    return 1;
 }
 
-static void sort_calls (int left, int right)
+void gc_call (sexpr sx)
 {
-    int pivot;
+    if (cancel || !pointerp (sx) || (sx == (sexpr)0)) return;
 
-    while (right > left)
+    if (((gc_call_count + 1) * 2) > (gc_call_mask + 1))
     {
-        pivot = partition (left, right, left);
-        sort_calls (left, pivot - 1);
-        left = pivot + 1;
+        unsigned long size = gc_call_size * 2;
+        sexpr *map = get_mem (size), *p, *e;
+
+        if (map == (sexpr *)0)
+        {
+            cancel = 1;
+            return;
+        }
+
+        gc_call_count = 0;
+
+        for (p = gc_calls, e = gc_calls + gc_call_mask + 1; p < e; p++)
+        {
+            if (*p != (sexpr)0)
+            {
+                gc_insert (map, (size / sizeof (sexpr)) - 1, *p);
+            }
+        }
+
+        free_mem (gc_call_size, gc_calls);
+
+        gc_calls     = map;
+        gc_call_size = size;
+        gc_call_mask = (size / sizeof (sexpr)) - 1;
     }
+
+    gc_insert (gc_calls, gc_call_mask, sx);
 }
 
 static int gc_initialise_memory ()
 {
-    gc_call_size  = (gc_base_items & (~(LIBCURIE_PAGE_SIZE - 1)))
-                  + LIBCURIE_PAGE_SIZE;
-    gc_calls     = get_mem (gc_call_size);
-    gc_pointer   = gc_calls;
+    /* keep the load factor of the table below one half */
+    for (gc_call_size = LIBCURIE_PAGE_SIZE;
+         gc_call_size < ((gc_base_items + 1) * 2 * sizeof (sexpr));
+         gc_call_size *= 2);
+
+    gc_calls      = get_mem (gc_call_size);
+    gc_call_mask  = (gc_call_size / sizeof (sexpr)) - 1;
+    gc_call_count = 0;
+
+    if (gc_calls == (sexpr *)0)
+    {
+        return 0;
+    }
 
     sx_call_all();
     sx_call_custom();
@@ -276,36 +663,89 @@ static int gc_initialise_memory ()
     if (cancel)
     {
         free_mem (gc_call_size, gc_calls);
+        gc_calls = (sexpr *)0;
+        cancel   = 0;
         return 0;
     }
 
-    sort_calls (0, gc_pointer - gc_calls - 1);
+    return 1;
+}
 
-    if (gc_roots_size != 0)
+static void gc_deinitialise_memory ()
+{
+    if (gc_calls != (sexpr *)0)
     {
-        sexpr **rootp, **roote;
+        free_mem (gc_call_size, gc_calls);
+        gc_calls = (sexpr *)0;
+    }
+}
+
+unsigned long gc_sweep (unsigned long slots)
+{
+    unsigned long rv = 0, k;
+    char slots_all = (slots == 0);
+
+    if (!gc_sweeping || gc_sweep_busy) return 0;
+
+    gc_sweep_busy = (char)1;
+
+    k = gc_call_mask + 1;
+
+    if ((slots == 0) || (slots > (k - gc_sweep_cursor)))
+    {
+        slots = k - gc_sweep_cursor;
+    }
+
+    for (; slots > 0; slots--, gc_sweep_cursor++)
+    {
+        sexpr sx = gc_calls[gc_sweep_cursor];
 
-        for (rootp = gc_roots,
-             roote = (sexpr**)((int_pointer)rootp + gc_roots_size);
-             rootp < roote; rootp++)
+        if ((sx != (sexpr)0) && !((int_pointer)sx & gc_mark))
         {
-            if ((*rootp) != (sexpr *)0)
-            {
-                gc_tag (**rootp);
-            }
+            /* the entry stays in the table, marked, so that lookups still
+               work and gc_keep() leaves it alone */
+            gc_calls[gc_sweep_cursor] = (sexpr)((int_pointer)sx | gc_mark);
+
+            sx_destroy (sx);
+            rv++;
         }
     }
 
-    cancel = 0;
+    if (gc_sweep_cursor == k)
+    {
+        gc_sweeping = (char)0;
+        gc_untidy   = (char)1;
+    }
+
+    gc_sweep_busy = (char)0;
 
-    return 1;
+    /* the constructors sweep a few slots at a time, and they shouldn't end
+       up optimising all the pools; that's left to whoever calls gc_tidy() */
+    if (slots_all)
+    {
+        (void)gc_tidy ();
+    }
+
+    return rv;
 }
 
-static void gc_deinitialise_memory ()
+char gc_tidy ()
 {
-    if (gc_calls != (sexpr *)0)
+    if (!gc_untidy || gc_sweep_busy) return (char)0;
+
+    gc_untidy = (char)0;
+
+    gc_deinitialise_memory ();
+    optimise_static_memory_pools ();
+
+    return (char)1;
+}
+
+void gc_keep (sexpr sx)
+{
+    if (gc_sweeping)
     {
-        free_mem (gc_call_size, gc_calls);
+        gc_tag (sx);
     }
 }
 
@@ -313,45 +753,61 @@ unsigned long gc_invoke ()
 {
     int step = (stack_growth == sg_down) ? -1 : 1;
     sexpr end = sx_end_of_list;
-    sexpr *t, *l = &end;
-    unsigned int i, k;
+    sexpr *l = &end;
+    unsigned long i, k;
     unsigned long rv = 0;
 
-    /* sanity check, if either of these tests fail then either your stack is
-       fucked, or your toolchain is useless. */
-    if (((stack_growth == sg_down) && (stack_start_address < (void *)l)) ||
-        ((stack_growth == sg_up)   && (stack_start_address > (void *)l)))
+    /* finish up after the last run before starting a new one */
+    if (gc_sweeping)
     {
-        return 0;
+        if (gc_sweep_busy) return 0;
+
+        (void)gc_sweep (0);
     }
-    /* detect simple alignment errors: */
-    if (((int_pointer)l & (~ (sizeof(sexpr) - 1))) != (int_pointer)l) return 0;
 
-    if (!gc_initialise_memory ()) return 0;
+    (void)gc_tidy ();
 
-    for (t = stack_start_address; t != l; t += step)
+    if (gc_scan_stack)
     {
-        sexpr e = *t;
-
-        if (pointerp (e) && (e != (sexpr)0))
+        /* sanity check, if either of these tests fail then either your stack
+           is fucked, or your toolchain is useless. */
+        if (((stack_growth == sg_down) && (stack_start_address < (void *)l)) ||
+            ((stack_growth == sg_up)   && (stack_start_address > (void *)l)))
+        {
+            return 0;
+        }
+        /* detect simple alignment errors: */
+        if (((int_pointer)l & (~ (sizeof(sexpr) - 1))) != (int_pointer)l)
         {
-            gc_tag (e);
+            return 0;
         }
     }
 
-    for (i = 0, k = (gc_pointer - gc_calls); i < k; i++)
+    if (!gc_initialise_memory ()) return 0;
+
+    if ((gc_mark_threads <= 1) || !gc_mark_parallel (l, step))
+    {
+        gc_mark_roots (gc_grey_serial, (void *)0, l, step);
+    }
+
+    gc_sweep_cursor = 0;
+    gc_sweeping     = (char)1;
+
+    if (!gc_lazy_sweep)
+    {
+        return gc_sweep (0);
+    }
+
+    /* everything else happens in gc_sweep(), bit by bit */
+    for (i = 0, k = gc_call_mask + 1; i < k; i++)
     {
         sexpr sx = gc_calls[i];
 
-        if (sx != (sexpr)0)
+        if ((sx != (sexpr)0) && !((int_pointer)sx & gc_mark))
         {
-            sx_destroy (sx);
             rv++;
         }
     }
 
-    gc_deinitialise_memory ();
-    optimise_static_memory_pools ();
-
     return rv;
 }
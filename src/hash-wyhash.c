@@ -0,0 +1,290 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+
+#include <curie/hash.h>
+
+/* --- wyhash --------------------------------------------------------------- */
+
+/* this one isn't duplicated in the per-architecture directories like the
+   MurmurHash2: the only part that really depends on the architecture is the
+   128-bit multiplication, and that's up to the compiler. there's no x86-64
+   vector version either; SSE2 and AVX2 don't have a 64x64->128-bit multiply,
+   and building one out of 32-bit products is about three times slower than a
+   plain mul. an AES-NI block function would be faster on long input, but it
+   is a different hash; the values would then depend on the build flags, and
+   they're stored in heap images. */
+
+static const int_64 wy_secret[4] =
+{
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+#if defined(__SIZEOF_INT128__)
+
+__extension__ typedef unsigned __int128 wy_int_128;
+
+static void wy_mum (int_64 *a, int_64 *b)
+{
+    wy_int_128 r = *a;
+
+    r *= *b;
+
+    *a = (int_64)r;
+    *b = (int_64)(r >> 64);
+}
+
+#else
+
+static void wy_mum (int_64 *a, int_64 *b)
+{
+    int_64 ha = *a >> 32, hb = *b >> 32,
+           la = (int_32)*a, lb = (int_32)*b,
+           rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb,
+           t = rl + (rm0 << 32), c = (t < rl), lo, hi;
+
+    lo = t + (rm1 << 32);
+    c += (lo < t);
+    hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+
+    *a = lo;
+    *b = hi;
+}
+
+#endif
+
+static int_64 wy_mix (int_64 a, int_64 b)
+{
+    wy_mum (&a, &b);
+
+    return a ^ b;
+}
+
+/* little-endian reads, so that the hash is the same everywhere */
+static int_64 wy_r4 (const unsigned char *p)
+{
+    return ((int_64)p[0])         | (((int_64)p[1]) << 8) |
+           (((int_64)p[2]) << 16) | (((int_64)p[3]) << 24);
+}
+
+/* the copy keeps this within the aliasing rules; it's a single load anyway */
+static int_64 wy_r8 (const unsigned char *p)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    int_64 r;
+
+    __builtin_memcpy (&r, p, sizeof (r));
+
+    return r;
+#else
+    return wy_r4 (p) | (wy_r4 (p + 4) << 32);
+#endif
+}
+
+static int_64 wy_r3 (const unsigned char *p, unsigned long k)
+{
+    return (((int_64)p[0]) << 16) | (((int_64)p[k >> 1]) << 8) | p[k - 1];
+}
+
+static int_64 wy_seed (int_64 seed)
+{
+    return seed ^ wy_mix (seed ^ wy_secret[0], wy_secret[1]);
+}
+
+/* mixes in 48 bytes; seed is an array of three independent lanes */
+static void wy_block (int_64 *seed, const unsigned char *p)
+{
+    seed[0] = wy_mix (wy_r8 (p)      ^ wy_secret[1], wy_r8 (p + 8)  ^ seed[0]);
+    seed[1] = wy_mix (wy_r8 (p + 16) ^ wy_secret[2], wy_r8 (p + 24) ^ seed[1]);
+    seed[2] = wy_mix (wy_r8 (p + 32) ^ wy_secret[3], wy_r8 (p + 40) ^ seed[2]);
+}
+
+/* everything after the 48-byte blocks: p points to the last i bytes of the
+   len bytes of input, and the 16 bytes in front of p must be readable if len
+   is larger than 16. */
+static int_64 wy_finish
+    (const unsigned char *p, unsigned long i, unsigned long len, int_64 seed)
+{
+    int_64 a, b;
+
+    if (len <= 16)
+    {
+        if (len >= 4)
+        {
+            a = (wy_r4 (p) << 32) | wy_r4 (p + ((len >> 3) << 2));
+            b = (wy_r4 (p + len - 4) << 32) |
+                 wy_r4 (p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (len > 0)
+        {
+            a = wy_r3 (p, len);
+            b = 0;
+        }
+        else
+        {
+            a = 0;
+            b = 0;
+        }
+    }
+    else
+    {
+        while (i > 16)
+        {
+            seed = wy_mix (wy_r8 (p) ^ wy_secret[1], wy_r8 (p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+
+        a = wy_r8 (p + i - 16);
+        b = wy_r8 (p + i - 8);
+    }
+
+    a ^= wy_secret[1];
+    b ^= seed;
+
+    wy_mum (&a, &b);
+
+    return wy_mix (a ^ wy_secret[0] ^ len, b ^ wy_secret[1]);
+}
+
+int_64 hash_wyhash_64 ( const void * key, unsigned long len, int_64 seed )
+{
+    const unsigned char *p = (const unsigned char *)key;
+    unsigned long i = len;
+    int_64 s[3];
+
+    s[0] = wy_seed (seed);
+
+    if (i > 48)
+    {
+        s[1] = s[0];
+        s[2] = s[0];
+
+        do
+        {
+            wy_block (s, p);
+            p += 48;
+            i -= 48;
+        }
+        while (i > 48);
+
+        s[0] ^= s[1] ^ s[2];
+    }
+
+    return wy_finish (p, i, len, s[0]);
+}
+
+int_pointer hash_wyhash_pt ( const void * key, unsigned long len, int_64 seed )
+{
+    return (int_pointer)hash_wyhash_64 (key, len, seed);
+}
+
+/* the streaming version keeps up to 48 bytes around, and only mixes them in
+   once it's clear that there's more data, since the last up-to-48 bytes are
+   treated differently. the 16 bytes in front of those are kept as well. */
+
+void hash_wyhash_begin ( struct hash_state *state, int_64 seed )
+{
+    state->seed[0] = wy_seed (seed);
+    state->seed[1] = state->seed[0];
+    state->seed[2] = state->seed[0];
+    state->length  = 0;
+    state->used    = 0;
+}
+
+void hash_wyhash_update
+    ( struct hash_state *state, const void * key, unsigned long len )
+{
+    const unsigned char *p = (const unsigned char *)key;
+    unsigned long n, i;
+
+    state->length += len;
+
+    while (len > 0)
+    {
+        if (state->used == 48)
+        {
+            wy_block (state->seed, state->buffer + 16);
+
+            for (i = 0; i < 16; i++)
+            {
+                state->buffer[i] = state->buffer[i + 48];
+            }
+
+            state->used = 0;
+        }
+
+        if ((state->used == 0) && (len > 48))
+        {
+            /* whole blocks straight from the input */
+            do
+            {
+                wy_block (state->seed, p);
+                p   += 48;
+                len -= 48;
+            }
+            while (len > 48);
+
+            for (i = 0; i < 16; i++)
+            {
+                state->buffer[i] = p[i - 16];
+            }
+        }
+
+        n = 48 - state->used;
+
+        if (n > len)
+        {
+            n = len;
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            state->buffer[16 + state->used + i] = p[i];
+        }
+
+        state->used += n;
+        p           += n;
+        len         -= n;
+    }
+}
+
+int_64 hash_wyhash_finish ( const struct hash_state *state )
+{
+    int_64 seed = state->seed[0];
+
+    if (state->length > 48)
+    {
+        seed ^= state->seed[1] ^ state->seed[2];
+    }
+
+    return wy_finish
+        (state->buffer + 16, state->used, state->length, seed);
+}
+
+/* --- END --- wyhash ------------------------------------------------------- */
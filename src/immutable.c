@@ -29,6 +29,7 @@
 #include <curie/memory.h>
 #include <curie/tree.h>
 #include <curie/hash.h>
+#include <curie/string.h>
 #include <curie/int.h>
 
 #define IMMUTABLE_CHUNKSIZE (4096*2)
@@ -69,7 +70,7 @@ const void *immutable (const void * data, unsigned long length)
         return data;
     }
 
-    hash = hash_murmur2_pt (data, length, 0);
+    hash = str_hash_l (data_char, length);
 
     if ((n = tree_get_node (&immutable_hashes, hash))
         != (struct tree_node *)0)
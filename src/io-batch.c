@@ -0,0 +1,107 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/io-system.h>
+#include <curie/memory.h>
+
+/* without any way to hand the kernel more than one request at a time, the
+   requests are simply carried out one after the other when they're submitted.
+   this is exactly what io_read() and io_commit() would have done anyway. */
+
+struct batch_request
+{
+    int fd;
+    char write;
+    void *buffer;
+    unsigned int count;
+    void *tag;
+};
+
+static struct batch_request *requests = (struct batch_request *)0;
+static unsigned int requests_count = 0;
+static unsigned long requests_size = 0;
+static unsigned long syscalls = 0;
+
+static void queue (int fd, char write, void *buf, unsigned int count,
+                   void *tag)
+{
+    unsigned long need = (requests_count + 1) * sizeof (struct batch_request);
+
+    if (need > requests_size)
+    {
+        unsigned long newsize = requests_size + LIBCURIE_PAGE_SIZE;
+
+        requests = (requests_size == 0)
+                 ? get_mem (newsize)
+                 : resize_mem (requests_size, requests, newsize);
+        requests_size = newsize;
+    }
+
+    requests[requests_count].fd     = fd;
+    requests[requests_count].write  = write;
+    requests[requests_count].buffer = buf;
+    requests[requests_count].count  = count;
+    requests[requests_count].tag    = tag;
+
+    requests_count++;
+}
+
+void a_batch_read (int fd, void *buf, unsigned int count, void *tag)
+{
+    queue (fd, (char)0, buf, count, tag);
+}
+
+void a_batch_write (int fd, const void *buf, unsigned int count, void *tag)
+{
+    queue (fd, (char)1, (void *)buf, count, tag);
+}
+
+void a_batch_submit (void (*on_complete)(void *tag, int result))
+{
+    unsigned int i;
+
+    for (i = 0; i < requests_count; i++)
+    {
+        struct batch_request *r = &(requests[i]);
+
+        syscalls++;
+        on_complete (r->tag, r->write ? a_write (r->fd, r->buffer, r->count)
+                                      : a_read  (r->fd, r->buffer, r->count));
+    }
+
+    requests_count = 0;
+}
+
+char a_batch_ringp ( void )
+{
+    return (char)0;
+}
+
+unsigned long a_batch_syscalls ( void )
+{
+    return syscalls;
+}
@@ -34,7 +34,16 @@ static struct io *(*get_io_struct)();
 
 static struct io *get_io_struct_real ()
 {
-    return get_pool_mem (io_struct_pool);
+    struct io *io = get_pool_mem (io_struct_pool);
+
+    io->buffer_mode         = iobm_linear;
+    io->read_policy         = iorp_single;
+    io->read_budget         = 0;
+    io->statistics.bytes    = 0;
+    io->statistics.syscalls = 0;
+    io->statistics.starved  = 0;
+
+    return io;
 }
 
 static struct io *get_io_struct_init ()
@@ -93,6 +93,13 @@ static void relocate_buffer_contents (struct io *io)
     if (io->position >= io->length) {
         io->length = 0;
         io->position = 0;
+    } else if (io->buffer_mode == iobm_ring) {
+        /* the second half of the ring mirrors the first one, so all that
+           needs to be done is to make sure that we stay in the first half */
+        if (io->position >= io->buffersize) {
+            io->position -= io->buffersize;
+            io->length   -= io->buffersize;
+        }
     } else {
         unsigned int i;
         io->length -= io->position;
@@ -105,6 +112,72 @@ static void relocate_buffer_contents (struct io *io)
 
 #define relocate_buffer(io) if (io->position != 0) relocate_buffer_contents(io)
 
+/* the number of bytes that can still be added to a fixed-size buffer */
+#define buffer_space(io)\
+    ((io)->buffersize - ((io)->length - (io)->position))
+
+static void free_buffer (struct io *io)
+{
+    if ((io->buffersize > 0) && (io->buffer != (char *)0)) {
+        if (io->buffer_mode == iobm_ring) {
+            free_mem_ring (io->buffersize, io->buffer);
+        } else {
+            free_mem (io->buffersize, io->buffer);
+        }
+        io->buffer = (char *)0;
+        io->buffersize = 0;
+    }
+}
+
+enum io_buffer_mode io_ring (struct io *io, unsigned int capacity)
+{
+    unsigned int used, i;
+    char *ring;
+
+    if ((io->type == iot_buffer) || (io->buffer_mode == iobm_ring)) {
+        return io->buffer_mode;
+    }
+
+    relocate_buffer(io);
+
+    used = io->length - io->position;
+    if (capacity < used) {
+        capacity = used;
+    }
+
+    /* get_mem_ring() maps the same pages twice, so it needs whole pages */
+    if ((capacity % LIBCURIE_PAGE_SIZE) != 0) {
+        capacity = ((capacity / LIBCURIE_PAGE_SIZE) + 1) * LIBCURIE_PAGE_SIZE;
+    } else if (capacity == 0) {
+        capacity = LIBCURIE_PAGE_SIZE;
+    }
+
+    ring = get_mem_ring (capacity);
+
+    if (ring != (char *)0) {
+        for (i = 0; i < used; i++) {
+            ring[i] = io->buffer[i];
+        }
+
+        free_buffer (io);
+
+        io->buffer = ring;
+        io->buffersize = capacity;
+        io->buffer_mode = iobm_ring;
+    } else {
+        if (capacity != io->buffersize) {
+            io->buffer = (io->buffersize == 0)
+                       ? get_mem (capacity)
+                       : resize_mem (io->buffersize, io->buffer, capacity);
+            io->buffersize = capacity;
+        }
+
+        io->buffer_mode = iobm_fixed;
+    }
+
+    return io->buffer_mode;
+}
+
 enum io_result io_collect(struct io *io, const char *data, unsigned int length)
 {
     unsigned int i, pos;
@@ -133,7 +206,11 @@ enum io_result io_collect(struct io *io, const char *data, unsigned int length)
         io->status = io_undefined;
     }
 
-    if ((io->length + length) > io->buffersize) {
+    if (io->buffer_mode != iobm_linear) {
+        if (length > buffer_space(io)) {
+            return io_no_change;
+        }
+    } else if ((io->length + length) > io->buffersize) {
         unsigned int newsize = (io->length + length);
         if ((newsize % IO_CHUNKSIZE) != 0) {
             newsize = ((newsize / IO_CHUNKSIZE) + 1) * IO_CHUNKSIZE;
@@ -174,6 +251,9 @@ void io_flush (struct io *io)
 
     relocate_buffer(io);
 
+    if (io->buffer_mode != iobm_linear)
+        return;
+
     unsigned int newsize = (io->length + IO_CHUNKSIZE);
     if ((newsize % IO_CHUNKSIZE) != 0) {
         newsize = ((newsize / IO_CHUNKSIZE) + 1) * IO_CHUNKSIZE;
@@ -188,10 +268,11 @@ void io_flush (struct io *io)
     return;
 }
 
-enum io_result io_read(struct io *io)
+/* everything io_read() does before actually reading: returns io_incomplete
+   if the caller should go ahead and read up to *max bytes to the end of the
+   buffer, or the result code to return otherwise */
+static enum io_result read_prepare (struct io *io, unsigned int *max)
 {
-    int readrv;
-
     if ((io->status == io_finalising) ||
         (io->status == io_end_of_file) ||
         (io->status == io_unrecoverable_error))
@@ -229,8 +310,15 @@ enum io_result io_read(struct io *io)
         io->status = io_undefined;
     }
 
-    if ((io->length + IO_CHUNKSIZE) > io->buffersize) {
-        unsigned int newsize = (io->length + IO_CHUNKSIZE);
+    if (io->buffer_mode != iobm_linear) {
+        if (buffer_space(io) == 0) {
+            return io_no_change;
+        }
+        if (*max > buffer_space(io)) {
+            *max = buffer_space(io);
+        }
+    } else if ((io->length + *max) > io->buffersize) {
+        unsigned int newsize = (io->length + *max);
         if ((newsize % IO_CHUNKSIZE) != 0) {
             newsize = ((newsize / IO_CHUNKSIZE) + 1) * IO_CHUNKSIZE;
         }
@@ -240,7 +328,12 @@ enum io_result io_read(struct io *io)
         io->buffersize = newsize;
     }
 
-    readrv = a_read(io->fd, (io->buffer + io->length), IO_CHUNKSIZE);
+    return io_incomplete;
+}
+
+static enum io_result read_finish (struct io *io, int readrv)
+{
+    io->statistics.syscalls++;
 
     if (readrv < 0) /* potential error */
     {
@@ -264,38 +357,77 @@ enum io_result io_read(struct io *io)
     }
 
     io->length += readrv;
+    io->statistics.bytes += readrv;
 
     return io_changes;
 }
 
-enum io_result io_commit (struct io *io)
+static enum io_result io_read_n (struct io *io, unsigned int max)
 {
-    int rv = -1, pos;
-    unsigned int i;
+    enum io_result r = read_prepare (io, &max);
 
-    switch (io->type) {
-        case iot_undefined:
-            return io_undefined;
-        case iot_buffer:
-            return io_end_of_file;
-        case iot_special_read:
-        case iot_read:
-            return io_read(io);
-        case iot_special_write:
-            return io_incomplete;
-        case iot_write:
-            if (io->length == 0) return io_complete;
-            if (io->buffer != (char *)0)
-            {
-                rv = a_write(io->fd, io->buffer, io->length);
-            }
+    if (r != io_incomplete)
+    {
+        return r;
     }
 
-    if (io->buffer == (char *)0)
+    return read_finish (io, a_read(io->fd, (io->buffer + io->length), max));
+}
+
+enum io_result io_read(struct io *io)
+{
+    return io_read_n (io, IO_CHUNKSIZE);
+}
+
+enum io_result io_read_scheduled (struct io *io)
+{
+    unsigned int total = 0, max;
+    enum io_result r, rv = io_no_change;
+
+    if (io->type != iot_read)
     {
-        io->length = 0;
-        return io_unrecoverable_error;
+        return io_read (io);
+    }
+
+    do
+    {
+        unsigned long before = io->statistics.bytes;
+
+        max = IO_CHUNKSIZE;
+        if ((io->read_budget != 0) && ((io->read_budget - total) < max))
+        {
+            max = io->read_budget - total;
+        }
+
+        r = io_read_n (io, max);
+
+        if (r != io_changes)
+        {
+            return (rv == io_changes) ? io_changes : r;
+        }
+
+        rv = io_changes;
+        total += (unsigned int)(io->statistics.bytes - before);
+
+        /* a short read means the source is out of data for now, so don't
+           waste a syscall on getting told so explicitly */
+        if ((io->statistics.bytes - before) < max)
+        {
+            break;
+        }
     }
+    while ((io->read_policy == iorp_drain) &&
+           ((io->read_budget == 0) || (total < io->read_budget)));
+
+    return rv;
+}
+
+static enum io_result write_finish (struct io *io, int rv)
+{
+    int pos;
+    unsigned int i;
+
+    io->statistics.syscalls++;
 
     if (rv < 0) /* potential error */
     {
@@ -318,6 +450,24 @@ enum io_result io_commit (struct io *io)
         return io_end_of_file;
     }
 
+    io->statistics.bytes += rv;
+
+    if (io->buffer_mode == iobm_ring)
+    {
+        io->position += rv;
+
+        if (io->position >= io->length)
+        {
+            io->length = 0;
+            io->position = 0;
+            return io_complete;
+        }
+
+        relocate_buffer(io);
+
+        return io_incomplete;
+    }
+
     if (rv == (int)io->length)
     {
         io->length = 0;
@@ -333,6 +483,130 @@ enum io_result io_commit (struct io *io)
     return io_incomplete;
 }
 
+/* the part of the buffer that io_commit() would write */
+#define write_start(io)\
+    (((io)->buffer_mode == iobm_ring) ? ((io)->buffer + (io)->position)\
+                                      : (io)->buffer)
+#define write_length(io)\
+    (((io)->buffer_mode == iobm_ring) ? ((io)->length - (io)->position)\
+                                      : (io)->length)
+
+enum io_result io_commit (struct io *io)
+{
+    switch (io->type) {
+        case iot_undefined:
+            return io_undefined;
+        case iot_buffer:
+            return io_end_of_file;
+        case iot_special_read:
+        case iot_read:
+            return io_read(io);
+        case iot_special_write:
+            return io_incomplete;
+        case iot_write:
+            break;
+    }
+
+    if (io->length == 0) return io_complete;
+
+    if (io->buffer == (char *)0)
+    {
+        io->length = 0;
+        return io_unrecoverable_error;
+    }
+
+    return write_finish
+        (io, a_write(io->fd, write_start(io), write_length(io)));
+}
+
+/* batched reads and writes: the requests are carried out by a_batch_submit(),
+   and the results are then processed exactly like io_read() and io_commit()
+   would. the buffers must not be touched in between. */
+
+static unsigned long batch_bytes = 0;
+
+static void on_batch_complete (void *tag, int result)
+{
+    struct io *io = (struct io *)tag;
+
+    if (io->type == iot_write)
+    {
+        (void)write_finish (io, result);
+    }
+    else
+    {
+        if (result > 0)
+        {
+            batch_bytes += (unsigned long)result;
+        }
+
+        (void)read_finish (io, result);
+    }
+}
+
+enum io_result io_read_queue (struct io *io, unsigned int *size)
+{
+    enum io_result r;
+
+    *size = IO_CHUNKSIZE;
+
+    if (io->type != iot_read)
+    {
+        *size = 0;
+        return io_read (io);
+    }
+
+    if (io->read_policy == iorp_drain)
+    {
+        /* draining needs to look at the result of each read before deciding
+           whether to read again, so it can't be queued */
+        unsigned long before = io->statistics.bytes;
+
+        r = io_read_scheduled (io);
+        *size = (unsigned int)(io->statistics.bytes - before);
+        return r;
+    }
+
+    if ((io->read_budget != 0) && (io->read_budget < *size))
+    {
+        *size = io->read_budget;
+    }
+
+    r = read_prepare (io, size);
+
+    if (r != io_incomplete)
+    {
+        *size = 0;
+        return r;
+    }
+
+    a_batch_read (io->fd, (io->buffer + io->length), *size, (void *)io);
+
+    return io_incomplete;
+}
+
+enum io_result io_commit_queue (struct io *io)
+{
+    if ((io->type != iot_write) || (io->length == 0) ||
+        (io->buffer == (char *)0))
+    {
+        return io_commit (io);
+    }
+
+    a_batch_write (io->fd, write_start(io), write_length(io), (void *)io);
+
+    return io_incomplete;
+}
+
+unsigned long io_queue_submit ( void )
+{
+    batch_bytes = 0;
+
+    a_batch_submit (on_batch_complete);
+
+    return batch_bytes;
+}
+
 enum io_result io_finish (struct io *io)
 {
     io->status = io_finalising;
@@ -357,11 +631,7 @@ void io_close (struct io *io)
         io->fd = -1;
     }
 
-    if ((io->buffersize > 0) && (io->buffer != (char *)0)) {
-        free_mem(io->buffersize, io->buffer);
-        io->buffer = (char *)0;
-        io->buffersize = 0;
-    }
+    free_buffer (io);
 
     io_destroy (io);
 }
@@ -0,0 +1,502 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <syscall/syscall.h>
+#include <curie/memory.h>
+#include <curie/multiplex.h>
+#include <curie/thread.h>
+#include <curie/internal-constants.h>
+#include <sievert/directory-walk.h>
+
+#include <asm/stat.h>
+
+/* getdents64 records and d_type values; see src/linux/directory.c */
+struct dirent64 {
+    int_64          d_ino;
+    int_64_s        d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[];
+};
+
+#define DT_UNKNOWN 0
+#define DT_DIR     4
+
+/* O_RDONLY | O_NONBLOCK | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC */
+#define WALK_OPEN_FLAGS 0xb0800
+
+/* AT_SYMLINK_NOFOLLOW */
+#define WALK_STAT_FLAGS 0x100
+
+#if defined(have_sys_newfstatat)
+#define have_walk_stat
+#endif
+
+/* a directory that still needs to be read; these are exactly one page, so
+   that the worker threads can use get_mem() for them */
+struct walk_task
+{
+    struct walk_task *next;
+    int fd;
+    unsigned int length;
+    char path[LIBCURIE_PAGE_SIZE - (2 * sizeof (void *))];
+};
+
+/* worker threads collect results in these, then hand them to the main thread
+   all at once */
+struct walk_chunk
+{
+    struct walk_chunk *next;
+    unsigned long used;
+    char data[];
+};
+
+struct walk_record
+{
+    unsigned int size;
+    char have_stat;
+#if defined(have_walk_stat)
+    struct stat st;
+#endif
+    char path[];
+};
+
+struct walk
+{
+    volatile int lock;
+    struct walk_task *tasks;
+    volatile long outstanding;
+    struct walk_chunk *volatile results;
+    volatile unsigned int finished;
+
+    int event;
+    char metadata;
+    unsigned int threads;
+    struct thread *thread[DIRECTORY_WALK_THREADS * 4];
+
+    void (*on_entry)(sexpr, struct metadata *, void *);
+    void (*on_done)(void *);
+    void *aux;
+};
+
+static void walk_signal (struct walk *w)
+{
+    int_64 one = 1;
+
+    (void)sys_write (w->event, (void *)&one, sizeof (one));
+}
+
+static void walk_push_task (struct walk *w, struct walk_task *t)
+{
+    (void)__sync_add_and_fetch (&(w->outstanding), 1);
+
+    while (__sync_lock_test_and_set (&(w->lock), 1)) thread_yield ();
+
+    t->next  = w->tasks;
+    w->tasks = t;
+
+    __sync_lock_release (&(w->lock));
+}
+
+static struct walk_task *walk_pop_task (struct walk *w)
+{
+    struct walk_task *t;
+
+    while (__sync_lock_test_and_set (&(w->lock), 1)) thread_yield ();
+
+    if ((t = w->tasks) != (struct walk_task *)0)
+    {
+        w->tasks = t->next;
+    }
+
+    __sync_lock_release (&(w->lock));
+
+    return t;
+}
+
+static void walk_flush (struct walk *w, struct walk_chunk **chunk)
+{
+    struct walk_chunk *c = *chunk;
+
+    if (c == (struct walk_chunk *)0)
+    {
+        return;
+    }
+
+    do
+    {
+        c->next = w->results;
+    }
+    while (!__sync_bool_compare_and_swap (&(w->results), c->next, c));
+
+    *chunk = (struct walk_chunk *)0;
+
+    walk_signal (w);
+}
+
+static struct walk_record *walk_record
+        (struct walk *w, struct walk_chunk **chunk, unsigned int length)
+{
+    struct walk_record *r;
+    unsigned int size = sizeof (struct walk_record) + length + 1;
+
+    size = (size + sizeof (long) - 1) & ~(sizeof (long) - 1);
+
+    if ((*chunk != (struct walk_chunk *)0) &&
+        (((*chunk)->used + size) > (DIRECTORY_WALK_CHUNK_SIZE
+                                    - sizeof (struct walk_chunk))))
+    {
+        walk_flush (w, chunk);
+    }
+
+    if (*chunk == (struct walk_chunk *)0)
+    {
+        *chunk = get_mem (DIRECTORY_WALK_CHUNK_SIZE);
+        (*chunk)->used = 0;
+    }
+
+    r = (struct walk_record *)((*chunk)->data + (*chunk)->used);
+    r->size = size;
+    (*chunk)->used += size;
+
+    return r;
+}
+
+static void walk_directory (struct walk *w, struct walk_task *t,
+                            char *buffer, struct walk_chunk **chunk)
+{
+    int rc;
+
+    while ((rc = sys_getdents64 (t->fd, buffer, LIBCURIE_GLOB_BUFFER_SIZE)) > 0)
+    {
+        unsigned int p = 0;
+
+        for (struct dirent64 *e = (struct dirent64 *)buffer; p < rc;
+             e = (struct dirent64 *)(buffer + (p = p + e->d_reclen)))
+        {
+            const char *s = e->d_name;
+            struct walk_record *r;
+            unsigned int i, l;
+
+            if ((s[0] == '.') &&
+                ((s[1] == 0) || ((s[1] == '.') && (s[2] == 0))))
+            {
+                continue;
+            }
+
+            for (l = 0; s[l]; l++);
+
+            if ((t->length + 1 + l) >= sizeof (t->path))
+            {
+                /* too deep to describe */
+                continue;
+            }
+
+            r = walk_record (w, chunk, t->length + 1 + l);
+
+            for (i = 0; i < t->length; i++)
+            {
+                r->path[i] = t->path[i];
+            }
+
+            r->path[i] = '/';
+
+            for (i++, l = 0; s[l]; i++, l++)
+            {
+                r->path[i] = s[l];
+            }
+
+            r->path[i] = 0;
+
+#if defined(have_walk_stat)
+            r->have_stat = w->metadata &&
+                (sys_newfstatat (t->fd, (char *)s, (void *)&(r->st),
+                                 WALK_STAT_FLAGS) == 0);
+#else
+            r->have_stat = (char)0;
+#endif
+
+            if ((e->d_type == DT_DIR) || (e->d_type == DT_UNKNOWN))
+            {
+                /* O_NOFOLLOW makes this fail for symbolic links and
+                   O_DIRECTORY for everything else that isn't a directory */
+                int fd = sys_openat (t->fd, s, WALK_OPEN_FLAGS, 0);
+
+                if (fd >= 0)
+                {
+                    struct walk_task *n = get_mem (sizeof (struct walk_task));
+
+                    n->fd     = fd;
+                    n->length = i;
+
+                    for (i = 0; i <= n->length; i++)
+                    {
+                        n->path[i] = r->path[i];
+                    }
+
+                    walk_push_task (w, n);
+                }
+            }
+        }
+    }
+}
+
+static void walk_worker (void *aux)
+{
+    struct walk *w = (struct walk *)aux;
+    struct walk_chunk *chunk = (struct walk_chunk *)0;
+    char *buffer = get_mem (LIBCURIE_GLOB_BUFFER_SIZE);
+    struct walk_task *t;
+
+    while (w->outstanding > 0)
+    {
+        if ((t = walk_pop_task (w)) == (struct walk_task *)0)
+        {
+            /* let the main thread see what we have while we wait */
+            walk_flush (w, &chunk);
+            thread_yield ();
+            continue;
+        }
+
+        walk_directory (w, t, buffer, &chunk);
+
+        (void)sys_close ((unsigned int)t->fd);
+        free_mem (sizeof (struct walk_task), t);
+
+        (void)__sync_sub_and_fetch (&(w->outstanding), 1);
+    }
+
+    walk_flush (w, &chunk);
+    free_mem (LIBCURIE_GLOB_BUFFER_SIZE, buffer);
+
+    (void)__sync_add_and_fetch (&(w->finished), 1);
+    walk_signal (w);
+}
+
+struct walk_metadata
+{
+    struct walk *walk;
+    sexpr path;
+};
+
+static void with_metadata (struct metadata *metadata, void *aux)
+{
+    struct walk_metadata *m = (struct walk_metadata *)aux;
+
+    m->walk->on_entry (m->path, metadata, m->walk->aux);
+}
+
+static void walk_deliver (struct walk *w, struct walk_record *r)
+{
+    sexpr path = make_string (r->path);
+
+#if defined(have_walk_stat)
+    if (r->have_stat)
+    {
+        struct walk_metadata m = { w, path };
+        enum metadata_classification_unix c;
+        int attributes = 0;
+
+        switch (r->st.st_mode & 0xf000)
+        {
+            case 0xc000: c = mcu_socket;           break;
+            case 0xa000: c = mcu_symbolic_link;    break;
+            case 0x8000: c = mcu_file;             break;
+            case 0x6000: c = mcu_block_device;     break;
+            case 0x4000: c = mcu_directory;        break;
+            case 0x2000: c = mcu_character_device; break;
+            case 0x1000: c = mcu_fifo;             break;
+            default:     c = mcu_unknown;          break;
+        }
+
+        if (0x0800 & r->st.st_mode) { attributes |= MAT_SET_UID; }
+        if (0x0400 & r->st.st_mode) { attributes |= MAT_SET_GID; }
+        if (0x0200 & r->st.st_mode) { attributes |= MAT_STICKY;  }
+
+        metadata_from_unix
+            (c, r->st.st_uid, r->st.st_gid, r->st.st_mode, r->st.st_atime,
+             r->st.st_mtime, r->st.st_ctime, r->st.st_size, r->st.st_dev,
+             attributes, with_metadata, (void *)&m);
+
+        return;
+    }
+#endif
+
+    w->on_entry (path, (struct metadata *)0, w->aux);
+}
+
+static void walk_drain (struct walk *w)
+{
+    struct walk_chunk *c, *n, *l = (struct walk_chunk *)0;
+    unsigned long p;
+
+    c = __sync_lock_test_and_set (&(w->results), (struct walk_chunk *)0);
+
+    /* oldest chunk first */
+    while (c != (struct walk_chunk *)0)
+    {
+        n = c->next;
+        c->next = l;
+        l = c;
+        c = n;
+    }
+
+    while (l != (struct walk_chunk *)0)
+    {
+        for (p = 0; p < l->used;
+             p += ((struct walk_record *)(l->data + p))->size)
+        {
+            walk_deliver (w, (struct walk_record *)(l->data + p));
+        }
+
+        n = l->next;
+        free_mem (DIRECTORY_WALK_CHUNK_SIZE, l);
+        l = n;
+    }
+}
+
+static void walk_on_read (struct io *io, void *aux)
+{
+    struct walk *w = (struct walk *)aux;
+    unsigned int i;
+
+    io->position = io->length;
+
+    walk_drain (w);
+
+    if ((w->finished == w->threads) && (w->on_entry != 0))
+    {
+        for (i = 0; i < w->threads; i++)
+        {
+            if (w->thread[i] != (struct thread *)0)
+            {
+                thread_join (w->thread[i]);
+            }
+        }
+
+        walk_drain (w);
+
+        if (w->on_done != (void (*)(void *))0)
+        {
+            w->on_done (w->aux);
+        }
+
+        w->on_entry = 0;
+
+        multiplex_del_io (io);
+    }
+}
+
+static void walk_on_close (struct io *io, void *aux)
+{
+    free_mem (sizeof (struct walk), aux);
+}
+
+void multiplex_directory_walk ( void )
+{
+    multiplex_io ();
+}
+
+void multiplex_add_directory_walk
+        (const char *root, unsigned int threads, char metadata,
+         void (*on_entry)(sexpr, struct metadata *, void *),
+         void (*on_done)(void *), void *aux)
+{
+    struct walk *w;
+    struct walk_task *t;
+    struct io *io;
+    unsigned int i;
+    int fd, event;
+
+    if ((event = sys_eventfd (0)) < 0)
+    {
+        if (on_done != (void (*)(void *))0)
+        {
+            on_done (aux);
+        }
+        return;
+    }
+
+    w = get_mem (sizeof (struct walk));
+    t = get_mem (sizeof (struct walk_task));
+
+    if (threads == 0)
+    {
+        threads = DIRECTORY_WALK_THREADS;
+    }
+    else if (threads > (sizeof (w->thread) / sizeof (struct thread *)))
+    {
+        threads = sizeof (w->thread) / sizeof (struct thread *);
+    }
+
+    w->lock        = 0;
+    w->tasks       = (struct walk_task *)0;
+    w->outstanding = 0;
+    w->results     = (struct walk_chunk *)0;
+    w->finished    = 0;
+    w->event       = event;
+    w->metadata    = metadata;
+    w->threads     = threads;
+    w->on_entry    = on_entry;
+    w->on_done     = on_done;
+    w->aux         = aux;
+
+    for (i = 0; root[i] && (i < (sizeof (t->path) - 1)); i++)
+    {
+        t->path[i] = root[i];
+    }
+
+    t->path[i] = 0;
+    t->length  = i;
+
+    if ((fd = sys_open (t->path, WALK_OPEN_FLAGS & ~0x20000, 0)) >= 0)
+    {
+        t->fd = fd;
+        walk_push_task (w, t);
+    }
+    else
+    {
+        free_mem (sizeof (struct walk_task), t);
+    }
+
+    for (i = 0; i < threads; i++)
+    {
+        w->thread[i] = thread_create (walk_worker, (void *)w);
+
+        if (w->thread[i] == (struct thread *)0)
+        {
+            /* no threads, so do the work in this one; the results are still
+               delivered through multiplex() */
+            walk_worker ((void *)w);
+        }
+    }
+
+    io = io_open (event);
+    io->type = iot_read;
+
+    multiplex_add_io (io, walk_on_read, walk_on_close, (void *)w);
+}
@@ -30,6 +30,8 @@
 #include <curie/directory-system.h>
 #include <curie/internal-constants.h>
 #include <curie/io-system.h>
+#include <curie/memory.h>
+#include <curie/gc.h>
 
 /* okay, i give up, kernel header hell wins. i suppose this can't really change
    too often anyway, since it'd break binary compatibility. */
@@ -74,3 +76,260 @@ sexpr read_directory_rx (const char *base, sexpr rx)
 
     return r;
 }
+
+/* d_type values from getdents64 */
+#define DT_UNKNOWN 0
+#define DT_DIR     4
+#define DT_LNK     10
+
+struct glob
+{
+    char **map;
+    unsigned int components;
+    sexpr *rx;
+    char **buffer;
+    char path[LIBCURIE_GLOB_PATH_SIZE];
+    void (*callback)(const char *, void *);
+    void *aux;
+    unsigned long matches;
+};
+
+static unsigned int glob_append
+        (struct glob *g, unsigned int length, const char *s)
+{
+    unsigned int i = length + 1;
+
+    if (i >= (LIBCURIE_GLOB_PATH_SIZE - 1))
+    {
+        return 0;
+    }
+
+    g->path[length] = '/';
+
+    for (; *s != (char)0; s++, i++)
+    {
+        if (i >= (LIBCURIE_GLOB_PATH_SIZE - 1))
+        {
+            return 0;
+        }
+
+        g->path[i] = *s;
+    }
+
+    g->path[i] = (char)0;
+
+    return i;
+}
+
+static void glob_match (struct glob *g)
+{
+    g->callback (g->path, g->aux);
+    g->matches++;
+}
+
+static void glob_walk
+        (struct glob *g, int fd, unsigned int c, unsigned int length);
+
+static void glob_descend
+        (struct glob *g, int fd, const char *name, unsigned int c,
+         unsigned int length)
+{
+    int nfd = sys_openat (fd, name,
+                          0x90800 /* O_RDONLY | O_NONBLOCK | O_DIRECTORY
+                                     | O_CLOEXEC */, 0);
+
+    if (nfd >= 0)
+    {
+        glob_walk (g, nfd, c, length);
+        a_close (nfd);
+    }
+}
+
+static void glob_walk
+        (struct glob *g, int fd, unsigned int c, unsigned int length)
+{
+    char stat_buffer[LIBCURIE_STAT_BUFFER_SIZE];
+    unsigned int l, next;
+    const char *t;
+    char *buffer;
+    int rc;
+
+    while ((c < g->components) && (g->map[c][0] == 0))
+    {
+        c++;
+    }
+
+    if (c == g->components)
+    {
+        glob_match (g);
+        return;
+    }
+
+    for (next = c + 1; (next < g->components) && (g->map[next][0] == 0);
+         next++);
+
+    t = g->map[c];
+
+    if (g->rx[c] == sx_false)
+    {
+        if ((l = glob_append (g, length, t)) == 0)
+        {
+            return;
+        }
+
+        if (next < g->components)
+        {
+            glob_descend (g, fd, t, next, l);
+        }
+        else if (sys_newfstatat (fd, (char *)t, stat_buffer, 0) == 0)
+        {
+            glob_match (g);
+        }
+
+        return;
+    }
+
+    if (g->buffer[c] == (char *)0)
+    {
+        g->buffer[c] = get_mem (LIBCURIE_GLOB_BUFFER_SIZE);
+    }
+
+    buffer = g->buffer[c];
+
+    while ((rc = sys_getdents64 (fd, buffer, LIBCURIE_GLOB_BUFFER_SIZE)) > 0)
+    {
+        unsigned int p = 0;
+
+        for (struct dirent64 *e = (struct dirent64 *)buffer; p < rc;
+             e = (struct dirent64 *)(buffer + (p = p + e->d_reclen)))
+        {
+            if ((next < g->components) &&
+                (e->d_type != DT_DIR) && (e->d_type != DT_LNK) &&
+                (e->d_type != DT_UNKNOWN))
+            {
+                /* can't have anything below it */
+                continue;
+            }
+
+            if (falsep (rx_match (g->rx[c], e->d_name)) ||
+                ((l = glob_append (g, length, e->d_name)) == 0))
+            {
+                continue;
+            }
+
+            if (next < g->components)
+            {
+                glob_descend (g, fd, e->d_name, next, l);
+            }
+            else
+            {
+                glob_match (g);
+            }
+        }
+    }
+}
+
+unsigned long read_directory_glob
+        (const char *p, void (*callback)(const char *, void *), void *aux)
+{
+    struct glob *g = get_mem (sizeof (struct glob));
+    unsigned int l = 0, s = 1, c, map_s, mapd_l, rx_s, buffer_s;
+    unsigned long rv;
+    char *mapd;
+    int fd;
+    sexpr rxs = sx_end_of_list;
+    gc_root root = gc_register_root (&rxs);
+
+    while (p[l])
+    {
+        if (p[l] == '/') s++;
+
+        l++;
+    }
+
+    map_s    = sizeof (char *) * s;
+    mapd_l   = l + 1;
+    rx_s     = sizeof (sexpr) * s;
+    buffer_s = sizeof (char *) * s;
+
+    g->map        = aalloc (map_s);
+    mapd          = aalloc (mapd_l);
+    g->rx         = aalloc (rx_s);
+    g->buffer     = aalloc (buffer_s);
+    g->components = s;
+    g->callback   = callback;
+    g->aux        = aux;
+    g->matches    = 0;
+
+    for (c = 0, s = 0, l = 0; p[l]; l++)
+    {
+        if (p[l] == '/')
+        {
+            mapd[l] = 0;
+            g->map[s] = (mapd + c);
+            s++;
+            c = l + 1;
+        }
+        else
+        {
+            mapd[l] = p[l];
+        }
+    }
+
+    mapd[l] = 0;
+    g->map[s] = (mapd + c);
+
+    for (c = 0; c < g->components; c++)
+    {
+        g->buffer[c] = (char *)0;
+        g->rx[c] = ((g->map[c][0] != 0) &&
+                    read_directory_component_rxp (g->map[c]))
+                 ? rx_compile (g->map[c]) : sx_false;
+
+        /* the callback may well run the gc */
+        rxs = cons (g->rx[c], rxs);
+    }
+
+    if (g->map[0][0] == 0)
+    {
+        g->path[0] = '/';
+        g->path[1] = '.';
+        g->path[2] = 0;
+        l = 2;
+    }
+    else
+    {
+        g->path[0] = '.';
+        g->path[1] = 0;
+        l = 1;
+    }
+
+    fd = sys_open (g->path, 0x90800 /* O_RDONLY | O_NONBLOCK | O_DIRECTORY
+                                       | O_CLOEXEC */, 0);
+
+    if (fd >= 0)
+    {
+        glob_walk (g, fd, 0, l);
+        a_close (fd);
+    }
+
+    for (c = 0; c < g->components; c++)
+    {
+        if (g->buffer[c] != (char *)0)
+        {
+            free_mem (LIBCURIE_GLOB_BUFFER_SIZE, g->buffer[c]);
+        }
+    }
+
+    rv = g->matches;
+
+    afree (buffer_s, g->buffer);
+    afree (rx_s, g->rx);
+    afree (mapd_l, mapd);
+    afree (map_s, g->map);
+    free_mem (sizeof (struct glob), g);
+
+    gc_unregister_root (root);
+
+    return rv;
+}
@@ -0,0 +1,421 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <syscall/syscall.h>
+#include <curie/io-system.h>
+#include <curie/memory.h>
+
+struct batch_request
+{
+    int fd;
+    char write;
+    char done;
+    void *buffer;
+    unsigned int count;
+    void *tag;
+};
+
+static struct batch_request *requests = (struct batch_request *)0;
+static unsigned int requests_count = 0;
+static unsigned long requests_size = 0;
+static unsigned long syscalls = 0;
+
+static void queue (int fd, char write, void *buf, unsigned int count,
+                   void *tag)
+{
+    unsigned long need = (requests_count + 1) * sizeof (struct batch_request);
+
+    if (need > requests_size)
+    {
+        unsigned long newsize = requests_size + LIBCURIE_PAGE_SIZE;
+
+        requests = (requests_size == 0)
+                 ? get_mem (newsize)
+                 : resize_mem (requests_size, requests, newsize);
+        requests_size = newsize;
+    }
+
+    requests[requests_count].fd     = fd;
+    requests[requests_count].write  = write;
+    requests[requests_count].done   = (char)0;
+    requests[requests_count].buffer = buf;
+    requests[requests_count].count  = count;
+    requests[requests_count].tag    = tag;
+
+    requests_count++;
+}
+
+void a_batch_read (int fd, void *buf, unsigned int count, void *tag)
+{
+    queue (fd, (char)0, buf, count, tag);
+}
+
+void a_batch_write (int fd, const void *buf, unsigned int count, void *tag)
+{
+    queue (fd, (char)1, (void *)buf, count, tag);
+}
+
+/* carries out the requests from first onwards with plain syscalls */
+static void submit_plain
+    (unsigned int first, void (*on_complete)(void *tag, int result))
+{
+    unsigned int i;
+
+    for (i = first; i < requests_count; i++)
+    {
+        struct batch_request *r = &(requests[i]);
+
+        if (!r->done)
+        {
+            r->done = (char)1;
+            syscalls++;
+            on_complete (r->tag, r->write ? a_write (r->fd, r->buffer, r->count)
+                                          : a_read  (r->fd, r->buffer, r->count));
+        }
+    }
+
+    requests_count = 0;
+}
+
+#if defined(have_sys_io_uring_setup) && defined(have_sys_io_uring_enter) && \
+    defined(have_sys_mmap) && defined(have_sys_close)
+
+/* io_uring lets us hand all of the requests of a multiplexer tick to the
+   kernel with a single syscall. the kernel ABI is stable, so the structures
+   and constants are simply replicated here. */
+
+#define RING_ENTRIES           256
+
+#define IORING_OFF_SQ_RING     0x0
+#define IORING_OFF_CQ_RING     0x8000000
+#define IORING_OFF_SQES        0x10000000
+#define IORING_FEAT_RW_CUR_POS (1 << 3)
+#define IORING_ENTER_GETEVENTS 0x1
+#define IORING_OP_READ         22
+#define IORING_OP_WRITE        23
+
+struct io_sqring_offsets
+{
+    unsigned int head, tail, ring_mask, ring_entries, flags, dropped, array,
+                 resv1;
+    unsigned long long resv2;
+};
+
+struct io_cqring_offsets
+{
+    unsigned int head, tail, ring_mask, ring_entries, overflow, cqes, flags,
+                 resv1;
+    unsigned long long resv2;
+};
+
+struct io_uring_params
+{
+    unsigned int sq_entries, cq_entries, flags, sq_thread_cpu, sq_thread_idle,
+                 features, wq_fd, resv[3];
+    struct io_sqring_offsets sq_off;
+    struct io_cqring_offsets cq_off;
+};
+
+struct io_uring_sqe
+{
+    unsigned char opcode, flags;
+    unsigned short ioprio;
+    int fd;
+    unsigned long long off, addr;
+    unsigned int len, rw_flags;
+    unsigned long long user_data;
+    unsigned short buf_index, personality;
+    int splice_fd_in;
+    unsigned long long addr3, pad;
+};
+
+struct io_uring_cqe
+{
+    unsigned long long user_data;
+    int res;
+    unsigned int flags;
+};
+
+enum ring_state { rs_unknown, rs_available, rs_unavailable };
+
+static enum ring_state ring_state = rs_unknown;
+static int ring_fd = -1;
+
+static unsigned int *sq_tail, *sq_mask, *sq_array, sq_entries;
+static unsigned int *cq_head, *cq_tail, *cq_mask;
+static struct io_uring_sqe *sqes;
+static struct io_uring_cqe *cqes;
+
+#define mmap_failedp(p) (((signed long long)(p) < 0) &&\
+                         ((signed long long)(p) > -4096))
+
+static void *map_ring (unsigned long size, unsigned long offset)
+{
+    return sys_mmap ((void *)0, size, 0x3 /* PROT_READ | PROT_WRITE */,
+                     0x8001 /* MAP_SHARED | MAP_POPULATE */, ring_fd, offset);
+}
+
+static void ring_setup ( void )
+{
+    struct io_uring_params p;
+    char *sq, *cq, *e;
+    unsigned int i;
+
+    ring_state = rs_unavailable;
+
+    for (i = 0; i < sizeof (p); i++)
+    {
+        ((char *)&p)[i] = 0;
+    }
+
+    ring_fd = (int)sys_io_uring_setup (RING_ENTRIES, &p);
+
+    if (ring_fd < 0)
+    {
+        return;
+    }
+
+    /* kernels without this feature also don't know about the plain read and
+       write operations */
+    if (!(p.features & IORING_FEAT_RW_CUR_POS))
+    {
+        (void)sys_close (ring_fd);
+        return;
+    }
+
+    sq = map_ring (p.sq_off.array + p.sq_entries * sizeof (unsigned int),
+                   IORING_OFF_SQ_RING);
+    cq = map_ring (p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe),
+                   IORING_OFF_CQ_RING);
+    e  = map_ring (p.sq_entries * sizeof (struct io_uring_sqe),
+                   IORING_OFF_SQES);
+
+    if (mmap_failedp (sq) || mmap_failedp (cq) || mmap_failedp (e))
+    {
+        /* the mappings will go away along with the process */
+        (void)sys_close (ring_fd);
+        return;
+    }
+
+    sq_tail    = (unsigned int *)(sq + p.sq_off.tail);
+    sq_mask    = (unsigned int *)(sq + p.sq_off.ring_mask);
+    sq_array   = (unsigned int *)(sq + p.sq_off.array);
+    sq_entries = p.sq_entries;
+    cq_head    = (unsigned int *)(cq + p.cq_off.head);
+    cq_tail    = (unsigned int *)(cq + p.cq_off.tail);
+    cq_mask    = (unsigned int *)(cq + p.cq_off.ring_mask);
+    cqes       = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    sqes       = (struct io_uring_sqe *)e;
+
+    ring_state = rs_available;
+}
+
+static unsigned int reap (void (*on_complete)(void *tag, int result))
+{
+    unsigned int head = *cq_head, n = 0;
+
+    __sync_synchronize ();
+
+    while (head != *cq_tail)
+    {
+        struct io_uring_cqe *cqe = &(cqes[(head & *cq_mask)]);
+        struct batch_request *r = &(requests[cqe->user_data]);
+
+        if (cqe->res < 0)
+        {
+            last_error_recoverable_p =
+                ((cqe->res == -4 /*EINTR*/) || (cqe->res == -11 /*EAGAIN*/))
+                ? (char)1 : (char)0;
+        }
+
+        r->done = (char)1;
+        on_complete (r->tag, cqe->res);
+
+        head++;
+        n++;
+    }
+
+    __sync_synchronize ();
+
+    *cq_head = head;
+
+    return n;
+}
+
+/* waits for the submitted requests first..first+submitted that haven't
+   completed yet; if even that fails, they're reported as failed, since
+   running them again might read or write the same data twice. */
+static void ring_drain
+    (unsigned int first, unsigned int submitted, unsigned int completed,
+     void (*on_complete)(void *tag, int result))
+{
+    unsigned int j;
+    long rv;
+
+    completed += reap (on_complete);
+
+    while (completed < submitted)
+    {
+        rv = sys_io_uring_enter (ring_fd, 0, (submitted - completed),
+                                 IORING_ENTER_GETEVENTS, (void *)0, 0);
+        syscalls++;
+
+        if ((rv < 0) && (rv != -4 /*EINTR*/) && (rv != -16 /*EBUSY*/))
+        {
+            last_error_recoverable_p = (char)0;
+
+            for (j = first; j < (first + submitted); j++)
+            {
+                if (!requests[j].done)
+                {
+                    requests[j].done = (char)1;
+                    on_complete (requests[j].tag, -1);
+                }
+            }
+
+            return;
+        }
+
+        completed += reap (on_complete);
+    }
+}
+
+void a_batch_submit (void (*on_complete)(void *tag, int result))
+{
+    unsigned int i = 0;
+
+    if (ring_state == rs_unknown)
+    {
+        ring_setup ();
+    }
+
+    if (ring_state != rs_available)
+    {
+        submit_plain (0, on_complete);
+        return;
+    }
+
+    while (i < requests_count)
+    {
+        unsigned int tail = *sq_tail, n = 0, submitted = 0, completed = 0;
+
+        while (((i + n) < requests_count) && (n < sq_entries))
+        {
+            struct batch_request *r = &(requests[(i + n)]);
+            unsigned int index = tail & *sq_mask;
+            struct io_uring_sqe *sqe = &(sqes[index]);
+            unsigned int j;
+
+            for (j = 0; j < sizeof (struct io_uring_sqe); j++)
+            {
+                ((char *)sqe)[j] = 0;
+            }
+
+            sqe->opcode    = r->write ? IORING_OP_WRITE : IORING_OP_READ;
+            sqe->fd        = r->fd;
+            sqe->off       = (unsigned long long)-1; /* current position */
+            sqe->addr      = (unsigned long long)(unsigned long)r->buffer;
+            sqe->len       = r->count;
+            sqe->user_data = i + n;
+
+            sq_array[index] = index;
+
+            tail++;
+            n++;
+        }
+
+        __sync_synchronize ();
+
+        *sq_tail = tail;
+
+        /* the descriptors are known to be ready, so the requests will
+           usually all be complete when this returns */
+        while (completed < n)
+        {
+            long rv = sys_io_uring_enter
+                (ring_fd, (n - submitted), (n - completed),
+                 IORING_ENTER_GETEVENTS, (void *)0, 0);
+
+            syscalls++;
+
+            if (rv >= 0)
+            {
+                submitted += (unsigned int)rv;
+            }
+            else if ((rv != -4 /*EINTR*/) && (rv != -16 /*EBUSY*/))
+            {
+                /* the ring is not usable after all: take back the entries
+                   that the kernel never saw, wait for the ones it did, and do
+                   whatever is left the old-fashioned way */
+                __sync_synchronize ();
+
+                *sq_tail = tail - (n - submitted);
+
+                ring_drain (i, submitted, completed, on_complete);
+
+                ring_state = rs_unavailable;
+                submit_plain (i + submitted, on_complete);
+                return;
+            }
+
+            completed += reap (on_complete);
+        }
+
+        i += n;
+    }
+
+    requests_count = 0;
+}
+
+char a_batch_ringp ( void )
+{
+    if (ring_state == rs_unknown)
+    {
+        ring_setup ();
+    }
+
+    return (ring_state == rs_available);
+}
+
+#else
+
+void a_batch_submit (void (*on_complete)(void *tag, int result))
+{
+    submit_plain (0, on_complete);
+}
+
+char a_batch_ringp ( void )
+{
+    return (char)0;
+}
+
+#endif
+
+unsigned long a_batch_syscalls ( void )
+{
+    return syscalls;
+}
@@ -0,0 +1,97 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <syscall/syscall.h>
+#include <curie/memory.h>
+
+#if defined(have_sys_memfd_create) && defined(have_sys_ftruncate) && \
+    defined(have_sys_mmap) && defined(have_sys_munmap) && \
+    defined(have_sys_close)
+
+void *get_mem_ring (unsigned long int size) {
+    char *rv;
+    long fd;
+
+    if ((size == 0) || ((size % LIBCURIE_PAGE_SIZE) != 0))
+    {
+        return (void *)0;
+    }
+
+    fd = sys_memfd_create ("curie-ring", 0x1 /* MFD_CLOEXEC */);
+
+    if (fd < 0)
+    {
+        return (void *)0;
+    }
+
+    if (sys_ftruncate ((unsigned int)fd, size) < 0)
+    {
+        (void)sys_close ((unsigned int)fd);
+        return (void *)0;
+    }
+
+    /* reserve enough address space for both mappings first, then put the
+       file in there twice */
+    rv = sys_mmap ((void *)0, (2 * size), 0x0 /* PROT_NONE */,
+                   0x22 /* MAP_ANON | MAP_PRIVATE */, -1, 0);
+
+    if ((signed long long)rv <= 0)
+    {
+        (void)sys_close ((unsigned int)fd);
+        return (void *)0;
+    }
+
+    if ((sys_mmap (rv, size, 0x3 /* PROT_READ | PROT_WRITE */,
+                   0x11 /* MAP_FIXED | MAP_SHARED */, fd, 0) != rv) ||
+        (sys_mmap (rv + size, size, 0x3 /* PROT_READ | PROT_WRITE */,
+                   0x11 /* MAP_FIXED | MAP_SHARED */, fd, 0) != (rv + size)))
+    {
+        (void)sys_munmap (rv, (2 * size));
+        (void)sys_close ((unsigned int)fd);
+        return (void *)0;
+    }
+
+    /* the mappings keep the file alive */
+    (void)sys_close ((unsigned int)fd);
+
+    return rv;
+}
+
+void free_mem_ring (unsigned long int size, void *location) {
+    (void)sys_munmap (location, (2 * size));
+}
+
+#else
+
+void *get_mem_ring (unsigned long int size) {
+    return (void *)0;
+}
+
+void free_mem_ring (unsigned long int size, void *location) {
+}
+
+#endif
@@ -0,0 +1,62 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+
+#include <syscall/syscall.h>
+#include <curie/io-system.h>
+#include <curie/network-system.h>
+
+#if defined(have_sys_eventfd)
+
+/* eventfd counters are read and reset with a single 8-byte read(), which is
+   exactly what the I/O multiplexer does when the descriptor is readable. */
+
+enum io_result a_open_event (int result[])
+{
+    int fd = sys_eventfd (0);
+
+    if (fd < 0)
+    {
+        return a_open_loop (result);
+    }
+
+    a_make_nonblocking (fd);
+
+    result[0] = fd;
+    result[1] = fd;
+
+    return io_complete;
+}
+
+#else
+
+enum io_result a_open_event (int result[])
+{
+    return a_open_loop (result);
+}
+
+#endif
@@ -28,6 +28,75 @@
 #include <syscall/syscall.h>
 #include <curie/multiplex-system.h>
 
+#include <curie/memory.h>
+
+#if defined(have_sys_poll)
+
+/* poll() is used in preference to select() because the latter is limited to a
+   fixed number of descriptors and the kernel needs to scan the whole bitmap up
+   to the highest descriptor, whereas with poll() the work only depends on the
+   number of descriptors that are actually being watched. */
+
+#define POLLIN   0x0001
+#define POLLOUT  0x0004
+#define POLLERR  0x0008
+#define POLLHUP  0x0010
+#define POLLNVAL 0x0020
+
+struct pollfd {
+    int fd;
+    short events;
+    short revents;
+};
+
+static struct pollfd *pollfds = (struct pollfd *)0;
+static unsigned long pollfds_size = 0;
+
+void a_select_with_fds (int *rfds, int rnum, int *wfds, int wnum) {
+    unsigned long need = (unsigned long)(rnum + wnum) * sizeof(struct pollfd);
+    int i, r;
+
+    if (need > pollfds_size) {
+        unsigned long newsize = need + LIBCURIE_PAGE_SIZE
+                              - (need % LIBCURIE_PAGE_SIZE);
+
+        pollfds = (pollfds_size == 0)
+                ? get_mem (newsize)
+                : resize_mem (pollfds_size, pollfds, newsize);
+        pollfds_size = newsize;
+    }
+
+    for (i = 0; i < rnum; i++) {
+        pollfds[i].fd      = rfds[i];
+        pollfds[i].events  = POLLIN;
+        pollfds[i].revents = 0;
+    }
+
+    for (i = 0; i < wnum; i++) {
+        pollfds[(rnum + i)].fd      = wfds[i];
+        pollfds[(rnum + i)].events  = POLLOUT;
+        pollfds[(rnum + i)].revents = 0;
+    }
+
+    r = sys_poll ((void *)pollfds, (unsigned int)(rnum + wnum), -1);
+
+    /* errors and hangups count as ready, so that the next read or write
+       picks up the condition */
+    for (i = 0; i < rnum; i++) {
+        if ((r <= 0) || (pollfds[i].revents == 0)) {
+            rfds[i] = -1;
+        }
+    }
+
+    for (i = 0; i < wnum; i++) {
+        if ((r <= 0) || (pollfds[(rnum + i)].revents == 0)) {
+            wfds[i] = -1;
+        }
+    }
+}
+
+#else
+
 #define BITSPERBYTE 8
 #define MAXCELLS 16
 #define CELLSIZE (unsigned int)(sizeof(unsigned int) * BITSPERBYTE)
@@ -105,3 +174,5 @@ void a_select_with_fds (int *rfds, int rnum, int *wfds, int wnum) {
         }
     }
 }
+
+#endif
@@ -0,0 +1,92 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+
+#include <syscall/syscall.h>
+#include <curie/sexpr.h>
+#include <curie/sexpr-internal.h>
+
+#if defined(have_sys_open) && defined(have_sys_close) && \
+    defined(have_sys_lseek) && defined(have_sys_mmap) && \
+    defined(have_sys_munmap)
+
+#define mmap_failedp(p) (((signed long long)(p) < 0) &&\
+                         ((signed long long)(p) > -4096))
+
+void *a_map_image (const char *path, void *address, unsigned long length)
+{
+    void *rv;
+    int fd = sys_open (path, 0x80000 /* O_RDONLY | O_CLOEXEC */, 0);
+
+    if (fd < 0)
+    {
+        return (void *)0;
+    }
+
+    /* mapping past the end of the file would get us SIGBUS later on */
+    if ((unsigned long)sys_lseek ((unsigned int)fd, 0, 2 /* SEEK_END */)
+            < length)
+    {
+        (void)sys_close ((unsigned int)fd);
+        return (void *)0;
+    }
+
+    rv = sys_mmap (address, length, 0x1 /* PROT_READ */,
+                   0x2 /* MAP_PRIVATE */, fd, 0);
+
+    if (!mmap_failedp (rv) && (rv != address))
+    {
+        /* somebody else is using that spot, so the image needs to be
+           relocated, which means writing to it */
+        (void)sys_munmap (rv, length);
+
+        rv = sys_mmap ((void *)0, length, 0x3 /* PROT_READ | PROT_WRITE */,
+                       0x2 /* MAP_PRIVATE */, fd, 0);
+    }
+
+    (void)sys_close ((unsigned int)fd);
+
+    return mmap_failedp (rv) ? (void *)0 : rv;
+}
+
+void a_unmap_image (void *image, unsigned long length)
+{
+    (void)sys_munmap (image, length);
+}
+
+#else
+
+void *a_map_image (const char *path, void *address, unsigned long length)
+{
+    return (void *)0;
+}
+
+void a_unmap_image (void *image, unsigned long length)
+{
+}
+
+#endif
@@ -0,0 +1,118 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <syscall/syscall.h>
+#include <curie/memory.h>
+#include <sievert/shell-system.h>
+
+#if defined(have_sys_inotify_init1) && defined(have_sys_inotify_add_watch) \
+    && defined(have_sys_read) && defined(have_sys_close)
+
+/* IN_NONBLOCK | IN_CLOEXEC */
+#define WATCH_FLAGS 0x80800
+
+/* IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE | IN_DELETE |
+   IN_DELETE_SELF | IN_MOVE_SELF */
+#define WATCH_MASK  0xfc4
+
+struct directory_watch
+{
+    int fd;
+};
+
+struct directory_watch *directory_watch_create ( void )
+{
+    struct directory_watch *watch;
+    long fd = sys_inotify_init1 (WATCH_FLAGS);
+
+    if (fd < 0)
+    {
+        return (struct directory_watch *)0;
+    }
+
+    watch = aalloc (sizeof (struct directory_watch));
+
+    if (watch == (struct directory_watch *)0)
+    {
+        (void)sys_close ((unsigned int)fd);
+        return (struct directory_watch *)0;
+    }
+
+    watch->fd = (int)fd;
+
+    return watch;
+}
+
+char directory_watch_add
+        (struct directory_watch *watch, const char *directory)
+{
+    return (sys_inotify_add_watch (watch->fd, directory, WATCH_MASK) >= 0)
+         ? (char)1 : (char)0;
+}
+
+char directory_watch_changed (struct directory_watch *watch)
+{
+    char buffer[0x1000], rv = (char)0;
+
+    /* we don't care what happened, only that something did */
+    while (sys_read ((unsigned int)watch->fd, buffer, sizeof (buffer)) > 0)
+    {
+        rv = (char)1;
+    }
+
+    return rv;
+}
+
+void directory_watch_destroy (struct directory_watch *watch)
+{
+    (void)sys_close ((unsigned int)watch->fd);
+    afree (sizeof (struct directory_watch), watch);
+}
+
+#else
+
+struct directory_watch *directory_watch_create ( void )
+{
+    return (struct directory_watch *)0;
+}
+
+char directory_watch_add
+        (struct directory_watch *watch, const char *directory)
+{
+    return (char)0;
+}
+
+char directory_watch_changed (struct directory_watch *watch)
+{
+    return (char)1;
+}
+
+void directory_watch_destroy (struct directory_watch *watch)
+{
+}
+
+#endif
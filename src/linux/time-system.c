@@ -0,0 +1,246 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <syscall/syscall.h>
+#include <curie/time-system.h>
+
+#include <linux/elf.h>
+
+/* auxiliary vector entry with the address of the vDSO's ELF header */
+#define AT_SYSINFO_EHDR 33
+
+/* CLOCK_REALTIME, CLOCK_MONOTONIC, CLOCK_BOOTTIME */
+static const unsigned int clock_ids[] = { 0, 1, 7 };
+
+#if defined(__LP64__) || defined(_LP64)
+typedef Elf64_Ehdr elf_ehdr;
+typedef Elf64_Phdr elf_phdr;
+typedef Elf64_Dyn  elf_dyn;
+typedef Elf64_Sym  elf_sym;
+#else
+typedef Elf32_Ehdr elf_ehdr;
+typedef Elf32_Phdr elf_phdr;
+typedef Elf32_Dyn  elf_dyn;
+typedef Elf32_Sym  elf_sym;
+#endif
+
+struct timespec_k
+{
+    long tv_sec;
+    long tv_nsec;
+};
+
+typedef int (*vdso_clock_gettime) (int, struct timespec_k *);
+
+static char               vdso_resolved = (char)0;
+static vdso_clock_gettime vdso_gettime  = (vdso_clock_gettime)0;
+
+static unsigned long auxv_get (unsigned long type)
+{
+    unsigned long auxv[0x40], rv = 0;
+    long fd = sys_open ("/proc/self/auxv", 0, 0), r;
+
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    while ((rv == 0) &&
+           ((r = sys_read ((unsigned int)fd, (char *)auxv, sizeof (auxv))) > 0))
+    {
+        long i, n = r / (long)(sizeof (unsigned long) * 2);
+
+        for (i = 0; i < n; i++)
+        {
+            if (auxv[(i * 2)] == type)
+            {
+                rv = auxv[(i * 2) + 1];
+                break;
+            }
+            else if (auxv[(i * 2)] == 0)
+            {
+                r = 0;
+                break;
+            }
+        }
+
+        if (r == 0)
+        {
+            break;
+        }
+    }
+
+    (void)sys_close ((unsigned int)fd);
+
+    return rv;
+}
+
+static unsigned long vdso_lookup (unsigned long base, const char *name)
+{
+    elf_ehdr *ehdr = (elf_ehdr *)base;
+    elf_phdr *phdr;
+    elf_dyn *dyn = (elf_dyn *)0;
+    elf_sym *symtab = (elf_sym *)0;
+    const char *strtab = (const char *)0;
+    unsigned int *hash = (unsigned int *)0;
+    unsigned long bias = 0, i;
+    char have_bias = (char)0;
+
+    if ((ehdr->e_ident[0] != 0x7f) || (ehdr->e_ident[1] != 'E') ||
+        (ehdr->e_ident[2] != 'L')  || (ehdr->e_ident[3] != 'F'))
+    {
+        return 0;
+    }
+
+    phdr = (elf_phdr *)(base + ehdr->e_phoff);
+
+    for (i = 0; i < ehdr->e_phnum; i++)
+    {
+        if ((phdr[i].p_type == PT_LOAD) && (have_bias == (char)0))
+        {
+            bias      = base + phdr[i].p_offset - phdr[i].p_vaddr;
+            have_bias = (char)1;
+        }
+        else if (phdr[i].p_type == PT_DYNAMIC)
+        {
+            dyn = (elf_dyn *)(base + phdr[i].p_offset);
+        }
+    }
+
+    if ((have_bias == (char)0) || (dyn == (elf_dyn *)0))
+    {
+        return 0;
+    }
+
+    for (; dyn->d_tag != DT_NULL; dyn++)
+    {
+        switch (dyn->d_tag)
+        {
+            case DT_SYMTAB:
+                symtab = (elf_sym *)(bias + dyn->d_un.d_ptr);
+                break;
+            case DT_STRTAB:
+                strtab = (const char *)(bias + dyn->d_un.d_ptr);
+                break;
+            case DT_HASH:
+                hash = (unsigned int *)(bias + dyn->d_un.d_ptr);
+                break;
+        }
+    }
+
+    if ((symtab == (elf_sym *)0) || (strtab == (const char *)0) ||
+        (hash == (unsigned int *)0))
+    {
+        return 0;
+    }
+
+    /* the second word of the SysV hash table is the number of symbols */
+    for (i = 0; i < hash[1]; i++)
+    {
+        const char *s = strtab + symtab[i].st_name, *t = name;
+
+        if ((ELF_ST_TYPE (symtab[i].st_info) != STT_FUNC) ||
+            (symtab[i].st_shndx == SHN_UNDEF))
+        {
+            continue;
+        }
+
+        while ((*s == *t) && (*t != (char)0))
+        {
+            s++;
+            t++;
+        }
+
+        if ((*s == (char)0) && (*t == (char)0))
+        {
+            return bias + symtab[i].st_value;
+        }
+    }
+
+    return 0;
+}
+
+static void vdso_resolve (void)
+{
+    unsigned long base = auxv_get (AT_SYSINFO_EHDR);
+
+    if (base != 0)
+    {
+        unsigned long f = vdso_lookup (base, "__vdso_clock_gettime");
+
+        if (f == 0)
+        {
+            f = vdso_lookup (base, "__kernel_clock_gettime");
+        }
+
+        vdso_gettime = (vdso_clock_gettime)f;
+    }
+
+    vdso_resolved = (char)1;
+}
+
+char a_clock
+    (enum dt_clock clock, int_64_s *seconds, unsigned long *nanoseconds)
+{
+    struct timespec_k ts;
+
+    if (vdso_resolved == (char)0)
+    {
+        vdso_resolve ();
+    }
+
+    if ((vdso_gettime != (vdso_clock_gettime)0) &&
+        (vdso_gettime ((int)clock_ids[clock], &ts) == 0))
+    {
+        *seconds     = (int_64_s)ts.tv_sec;
+        *nanoseconds = (unsigned long)ts.tv_nsec;
+
+        return (char)1;
+    }
+
+#if defined(have_sys_clock_gettime)
+    if (sys_clock_gettime (clock_ids[clock], &ts) == 0)
+    {
+        *seconds     = (int_64_s)ts.tv_sec;
+        *nanoseconds = (unsigned long)ts.tv_nsec;
+
+        return (char)1;
+    }
+#endif
+
+#if defined(have_sys_time)
+    if (clock == dtc_realtime)
+    {
+        *seconds     = (int_64_s)sys_time (0);
+        *nanoseconds = 0;
+
+        return (char)1;
+    }
+#endif
+
+    return (char)0;
+}
@@ -0,0 +1,227 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <syscall/syscall.h>
+#include <curie/thread.h>
+#include <curie/memory.h>
+
+#if defined(have_sys_clone) && defined(have_sys_futex) && \
+    defined(have_sys_exit) && defined(have_sys_sched_yield) && \
+    defined(have_sys_arch_prctl)
+
+#define THREAD_STACK_SIZE 0x40000
+
+/* CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD |
+   CLONE_SYSVSEM | CLONE_SETTLS | CLONE_PARENT_SETTID | CLONE_CHILD_CLEARTID */
+#define THREAD_CLONE_FLAGS 0x3d0f00
+
+#define FUTEX_WAIT 0
+
+#define ARCH_SET_FS 0x1002
+
+/* the thread struct lives at the bottom of the thread's stack; each thread's
+   %fs points at its own, so the first member needs to point back at it, for
+   thread_index() to find it. */
+struct thread
+{
+    struct thread *self;
+    volatile int tid;
+    unsigned int index;
+};
+
+static struct thread thread_main = { &thread_main, 0, 0 };
+
+/* %fs is only set up once there's more than one thread */
+static char thread_fs = (char)0;
+
+/* bit i is set while index i is in use; the main thread always has 0 */
+static volatile unsigned long thread_indices = 0x1;
+
+/* the kernel returns from clone() twice, but the child has a new, empty
+   stack, so it can't return into C code; it picks up the function and its
+   argument from the new stack instead and calls it right away. */
+static long thread_clone
+    (void *stack, struct thread *t, void (*function)(void *), void *aux)
+{
+    register unsigned long out __asm__("rax") = (unsigned long)__NR_clone;
+    register unsigned long a1  __asm__("rdi") = THREAD_CLONE_FLAGS;
+    register unsigned long a2  __asm__("rsi") = (unsigned long)stack - 16;
+    register unsigned long a3  __asm__("rdx") = (unsigned long)&(t->tid);
+    register unsigned long a4  __asm__("r10") = (unsigned long)&(t->tid);
+    register unsigned long a5  __asm__("r8")  = (unsigned long)t;
+
+    ((void (**)(void *))stack)[-2] = function;
+    ((void **)stack)[-1] = aux;
+
+    __asm__ volatile ( "syscall\n\t"
+                       "test %%rax, %%rax\n\t"
+                       "jnz 1f\n\t"
+                       "xor %%ebp, %%ebp\n\t"
+                       "pop %%rax\n\t"
+                       "pop %%rdi\n\t"
+                       "call *%%rax\n\t"
+                       "mov %2, %%eax\n\t"
+                       "xor %%edi, %%edi\n\t"
+                       "syscall\n\t"
+                       "hlt\n"
+                       "1:"
+                       : "+a"(out)
+                       : "q"(a1), "i"(__NR_exit), "q"(a2), "q"(a3), "q"(a4),
+                         "q"(a5)
+                       : "cc", "memory", "rcx", "r11" );
+
+    return (long)out;
+}
+
+static void thread_release_index (unsigned int index)
+{
+    unsigned long u;
+
+    do
+    {
+        u = thread_indices;
+    }
+    while (!__sync_bool_compare_and_swap
+               (&thread_indices, u, u & ~(1UL << index)));
+}
+
+struct thread *thread_create (void (*function)(void *), void *aux)
+{
+    char *stack;
+    struct thread *t;
+    unsigned long u;
+    unsigned int index;
+
+    if (!thread_fs)
+    {
+        if (sys_arch_prctl (ARCH_SET_FS, (unsigned long)&thread_main) < 0)
+        {
+            return (struct thread *)0;
+        }
+
+        thread_fs = (char)1;
+    }
+
+    do
+    {
+        u = thread_indices;
+
+        if (~u == 0)
+        {
+            return (struct thread *)0;
+        }
+
+        index = (unsigned int)__builtin_ctzl (~u);
+
+        if (index >= THREAD_MAX)
+        {
+            return (struct thread *)0;
+        }
+    }
+    while (!__sync_bool_compare_and_swap
+               (&thread_indices, u, u | (1UL << index)));
+
+    stack = get_mem (THREAD_STACK_SIZE);
+    t     = (struct thread *)stack;
+
+    if (stack == (char *)0)
+    {
+        thread_release_index (index);
+        return (struct thread *)0;
+    }
+
+    t->self  = t;
+    t->tid   = 0;
+    t->index = index;
+
+    if (thread_clone (stack + THREAD_STACK_SIZE, t, function, aux)
+        < 0)
+    {
+        free_mem (THREAD_STACK_SIZE, stack);
+        thread_release_index (index);
+        return (struct thread *)0;
+    }
+
+    return t;
+}
+
+void thread_join (struct thread *thread)
+{
+    int tid;
+
+    /* the kernel clears the tid and wakes us up once the thread is gone */
+    while ((tid = thread->tid) != 0)
+    {
+        (void)sys_futex ((int *)&(thread->tid), FUTEX_WAIT, tid, (void *)0,
+                         (int *)0, 0);
+    }
+
+    thread_release_index (thread->index);
+
+    free_mem (THREAD_STACK_SIZE, (void *)thread);
+}
+
+unsigned int thread_index (void)
+{
+    struct thread *t;
+
+    if (!thread_fs)
+    {
+        return 0;
+    }
+
+    __asm__ ("mov %%fs:0, %0" : "=r"(t));
+
+    return t->index;
+}
+
+void thread_yield (void)
+{
+    (void)sys_sched_yield ();
+}
+
+#else
+
+struct thread *thread_create (void (*function)(void *), void *aux)
+{
+    return (struct thread *)0;
+}
+
+void thread_join (struct thread *thread)
+{
+}
+
+unsigned int thread_index (void)
+{
+    return 0;
+}
+
+void thread_yield (void)
+{
+}
+
+#endif
@@ -26,6 +26,7 @@
 */
 
 #include <curie/memory.h>
+#include <curie/memory-internal.h>
 #include <curie/tree.h>
 
 void *aalloc   (unsigned long size) {
@@ -35,6 +36,12 @@ void *aalloc   (unsigned long size) {
 
         return get_pool_mem (&pool);
     } else {
+        if (memory_statistics_active)
+        {
+            memory_statistics_large
+                ((long)calculate_aligned_memory_size (size));
+        }
+
         return get_mem (calculate_aligned_memory_size (size));
     }
 }
@@ -46,6 +53,12 @@ void *arealloc (unsigned long size, void *p, unsigned long new_size) {
     if (msize != mnew_size) {
         if ((msize >= CURIE_POOL_CUTOFF) &&
             (mnew_size >= CURIE_POOL_CUTOFF)) {
+            if (memory_statistics_active)
+            {
+                memory_statistics_large (-(long)msize);
+                memory_statistics_large ((long)mnew_size);
+            }
+
             return resize_mem (msize, p, mnew_size);
         } else {
             unsigned int *new_location = (unsigned int *)aalloc(mnew_size);
@@ -82,6 +95,12 @@ void afree     (unsigned long size, void *p) {
     if (size < CURIE_POOL_CUTOFF) {
         free_pool_mem (p);
     } else {
+        if (memory_statistics_active)
+        {
+            memory_statistics_large
+                (-(long)calculate_aligned_memory_size (size));
+        }
+
         free_mem (calculate_aligned_memory_size (size), p);
     }
 }
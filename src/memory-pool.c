@@ -30,8 +30,47 @@
 #include <curie/memory.h>
 #include <curie/memory-internal.h>
 #include <curie/int.h>
+#include <curie/thread.h>
+
+/* each thread has its own set of static pools when memory_thread_safe is set,
+   otherwise everyone uses the main thread's. entities that are freed by some
+   other thread are pushed onto the owner's remote list, which the owner then
+   takes over in one go when it next allocates something. pools from
+   create_memory_pool() don't belong to any one thread, so they keep their own
+   remote list in their first frame, and whoever allocates next takes it. */
+struct memory_pool_cache
+{
+    struct memory_pool *pools[POOLCOUNT];
+    void * volatile remote;
+};
+
+static struct memory_pool_cache memory_cache_main;
+static struct memory_pool_cache *memory_caches[THREAD_MAX]
+    = { &memory_cache_main };
+
+char memory_thread_safe = (char)0;
+
+#define memory_thread() (memory_thread_safe ? thread_index () : 0)
+
+#define memory_owner_any ((unsigned short)~0)
+
+#if defined(__GNUC__)
+#define memory_cas(p,o,n) __sync_bool_compare_and_swap ((p), (o), (n))
+#else
+#define memory_cas(p,o,n) ((*(p) = (n)), 1)
+#endif
+
+char memory_statistics_active = (char)0;
 
-static struct memory_pool *static_pools[POOLCOUNT];
+static struct memory_statistics pool_statistics[POOLCOUNT];
+static struct memory_statistics large_statistics;
+
+#define count_statistics(size,field)\
+    do {\
+        if (memory_statistics_active &&\
+            (((size) / ENTITY_ALIGNMENT) <= POOLCOUNT))\
+            pool_statistics[(((size) / ENTITY_ALIGNMENT) - 1)].field++;\
+    } while (0)
 
 #define bitmap_set(m,b,c)\
     m[c] &= ~(1 << (b%BITSPERBITMAPENTITY))
@@ -54,13 +93,48 @@ struct memory_pool *create_memory_pool (unsigned long int entitysize)
 
     if (pool->maxentities > BITMAPMAXBLOCKENTRIES) pool->maxentities = BITMAPMAXBLOCKENTRIES;
 
-    pool->next = (struct memory_pool_frame_header *)0;
+    pool->next   = (struct memory_pool_frame_header *)0;
+    pool->pool   = pool;
+    pool->rooms  = (struct memory_pool_frame_header *)0;
+    pool->room   = (struct memory_pool_frame_header *)0;
+    pool->queued = (char)0;
+    pool->remote = (void *)0;
 
-    pool->type = mpft_frame;
+    pool->type  = mpft_frame;
+    pool->owner = memory_owner_any;
 
     return (struct memory_pool *)pool;
 }
 
+/* only ever called by the thread itself, so there's no need to worry about
+   two threads setting up the same cache */
+static struct memory_pool_cache *memory_cache (unsigned int thread)
+{
+    struct memory_pool_cache *c = memory_caches[thread];
+    unsigned int i;
+
+    if (c == (struct memory_pool_cache *)0)
+    {
+        c = get_mem (sizeof (struct memory_pool_cache));
+
+        if (c == (struct memory_pool_cache *)0)
+        {
+            return c;
+        }
+
+        for (i = 0; i < POOLCOUNT; i++)
+        {
+            c->pools[i] = (struct memory_pool *)0;
+        }
+
+        c->remote = (void *)0;
+
+        memory_caches[thread] = c;
+    }
+
+    return c;
+}
+
 void free_memory_pool (struct memory_pool *pool)
 {
     if (pool->type == mpft_frame)
@@ -75,81 +149,223 @@ void free_memory_pool (struct memory_pool *pool)
     }
 }
 
-static void *get_pool_mem_inner
-    (struct memory_pool_frame_header *pool,
-     struct memory_pool_frame_header *frame)
+static void *get_frame_mem (struct memory_pool_frame_header *frame)
 {
-    do {
-        BITMAPENTITYTYPE x = (((1 << BITMAPMAPSIZE)-1) & (frame->map[BITMAPMAPSIZE]));
-        if (x)
-        {
-            BITMAPENTITYTYPE cell = (HASH_MAGIC_TABLE [(((x & -x) * HASH_MAGIC_MULTIPLIER) >> HASH_MAGIC_SHIFT) & HASH_MAGIC_TABLE_MASK]);
-            BITMAPENTITYTYPE index;
+    BITMAPENTITYTYPE x = (((1 << BITMAPMAPSIZE)-1) & (frame->map[BITMAPMAPSIZE]));
 
-            x = frame->map[cell];
+    if (x)
+    {
+        BITMAPENTITYTYPE cell = (HASH_MAGIC_TABLE [(((x & -x) * HASH_MAGIC_MULTIPLIER) >> HASH_MAGIC_SHIFT) & HASH_MAGIC_TABLE_MASK]);
+        BITMAPENTITYTYPE index;
 
-            index = cell * BITSPERBITMAPENTITY +
-                    (HASH_MAGIC_TABLE [(((x & -x) * HASH_MAGIC_MULTIPLIER) >> HASH_MAGIC_SHIFT) & HASH_MAGIC_TABLE_MASK]);
+        x = frame->map[cell];
 
-            if (index < frame->maxentities) {
-                char *frame_mem_start = (char *)frame + sizeof(struct memory_pool_frame_header);
+        index = cell * BITSPERBITMAPENTITY +
+                (HASH_MAGIC_TABLE [(((x & -x) * HASH_MAGIC_MULTIPLIER) >> HASH_MAGIC_SHIFT) & HASH_MAGIC_TABLE_MASK]);
 
-                bitmap_set(frame->map, index, cell);
+        if (index < frame->maxentities) {
+            char *frame_mem_start = (char *)frame + sizeof(struct memory_pool_frame_header);
 
-                if (frame->map[cell] == ((BITMAPENTITYTYPE)0))
-                {
-                    frame->map[BITMAPMAPSIZE] &= ~((BITMAPENTITYTYPE)(1 << cell));
-                }
+            bitmap_set(frame->map, index, cell);
 
-                if ((pool != frame) &&
-                     (pool->next != (struct memory_pool_frame_header *)0)
-                     && (pool->next != frame))
-                {
-                    struct memory_pool_frame_header *cursor = pool->next;
+            if (frame->map[cell] == ((BITMAPENTITYTYPE)0))
+            {
+                frame->map[BITMAPMAPSIZE] &= ~((BITMAPENTITYTYPE)(1 << cell));
+            }
+
+            return (void *)(frame_mem_start
+                    + (index * (frame->entitysize)));
+        }
+    }
+
+    return (void *)0;
+}
+
+static struct memory_pool_frame_header *add_frame
+    (struct memory_pool_frame_header *pool)
+{
+    struct memory_pool_frame_header *n
+        = (struct memory_pool_frame_header *)
+              create_memory_pool (pool->entitysize);
+
+    if (n != (struct memory_pool_frame_header *)0)
+    {
+        n->pool  = pool;
+        n->owner = pool->owner;
+    }
+
+    return n;
+}
+
+/* the first few frames are full; frames further down with free entities are
+   on the rooms list, where they stay until they're found to be full. only if
+   there's none of those is there a new frame, right after the first one. */
+static void *get_room_mem (struct memory_pool_frame_header *pool)
+{
+    struct memory_pool_frame_header *frame;
+    void *mem;
+
+    while ((frame = pool->rooms) != (struct memory_pool_frame_header *)0)
+    {
+        if ((mem = get_frame_mem (frame)) != (void *)0)
+        {
+            return mem;
+        }
 
-                    while (cursor->next != frame)
-                    {
-                        cursor = cursor->next;
-                    }
+        pool->rooms   = frame->room;
+        frame->queued = (char)0;
+    }
+
+    if ((frame = add_frame (pool)) == (struct memory_pool_frame_header *)0)
+    {
+        return (void *)0;
+    }
+
+    frame->next = pool->next;
+    pool->next  = frame;
+
+    return get_frame_mem (frame);
+}
 
-                    cursor->next = frame->next;
-                    frame->next = pool->next;
-                    pool->next = frame;
+static void *get_pool_mem_inner
+    (struct memory_pool_frame_header *pool,
+     struct memory_pool_frame_header *frame)
+{
+    unsigned int probes = 0;
+    void *mem;
+
+    do {
+        if ((mem = get_frame_mem (frame)) != (void *)0)
+        {
+            if ((pool != frame) &&
+                 (pool->next != (struct memory_pool_frame_header *)0)
+                 && (pool->next != frame))
+            {
+                struct memory_pool_frame_header *cursor = pool->next;
+
+                while (cursor->next != frame)
+                {
+                    cursor = cursor->next;
                 }
 
-                return (void *)(frame_mem_start
-                        + (index * (frame->entitysize)));
+                cursor->next = frame->next;
+                frame->next = pool->next;
+                pool->next = frame;
             }
+
+            return mem;
         }
 
         if (frame->next == (struct memory_pool_frame_header *)0) {
-            frame->next = (struct memory_pool_frame_header *)
-                          create_memory_pool (frame->entitysize);
+            frame->next = add_frame (pool);
         }
+        else if (probes == POOL_FRAME_PROBES)
+        {
+            /* don't walk all the way to the end of the list, as that makes
+               allocations linear in the number of frames */
+            return get_room_mem (pool);
+        }
+
+        probes++;
     } while ((frame = frame->next) != (struct memory_pool_frame_header *)0);
 
     return (void *)0;
 }
 
+#define memory_frame(mem)\
+    ((struct memory_pool_frame_header *)\
+     ((((int_pointer)(mem)) / LIBCURIE_PAGE_SIZE) * LIBCURIE_PAGE_SIZE))
+
+static void free_pool_mem_local
+    (struct memory_pool_frame_header *pool, void *mem)
+{
+    char *pool_mem_start = (char *)pool + sizeof(struct memory_pool_frame_header);
+
+    unsigned int index = (unsigned int)(((char*)mem - pool_mem_start) / pool->entitysize);
+    unsigned int cell = ((unsigned int)((index) / BITSPERBITMAPENTITY));
+
+    bitmap_clear (pool->map, index, cell);
+    pool->map[BITMAPMAPSIZE] |= ((BITMAPENTITYTYPE)(1 << cell));
+
+    if (!pool->queued && (pool->pool != pool))
+    {
+        pool->queued      = (char)1;
+        pool->room        = pool->pool->rooms;
+        pool->pool->rooms = pool;
+    }
+}
+
+static void collect_remote_pool_mem (void * volatile *remote)
+{
+    void *mem, *next;
+
+    do
+    {
+        mem = *remote;
+    }
+    while (!memory_cas (remote, mem, (void *)0));
+
+    for (; mem != (void *)0; mem = next)
+    {
+        next = *((void **)mem);
+
+        free_pool_mem_local (memory_frame (mem), mem);
+    }
+}
+
 void *get_pool_mem(struct memory_pool *pool)
 {
+    struct memory_pool_cache *c = &memory_cache_main;
+
+    count_statistics (pool->entitysize, allocations);
+
+    if (memory_thread_safe)
+    {
+        if ((c = memory_cache (thread_index ()))
+                == (struct memory_pool_cache *)0)
+        {
+            return (void *)0;
+        }
+
+        if (c->remote != (void *)0)
+        {
+            collect_remote_pool_mem (&(c->remote));
+        }
+    }
+
     switch (pool->type)
     {
         case mpft_static_header:
         {
             unsigned short r = (pool->entitysize / ENTITY_ALIGNMENT) - 1;
 
-            if (static_pools[r] == (struct memory_pool *)0)
+            if (c->pools[r] == (struct memory_pool *)0)
             {
-                static_pools[r] = create_memory_pool(pool->entitysize);
+                struct memory_pool_frame_header *h
+                    = (struct memory_pool_frame_header *)
+                          create_memory_pool (pool->entitysize);
+
+                if (h == (struct memory_pool_frame_header *)0)
+                {
+                    return (void *)0;
+                }
+
+                h->owner    = (unsigned short)memory_thread ();
+                c->pools[r] = (struct memory_pool *)h;
             }
 
             return get_pool_mem_inner
-                    ((struct memory_pool_frame_header *)static_pools[r],
-                     (struct memory_pool_frame_header *)static_pools[r]);
+                    ((struct memory_pool_frame_header *)c->pools[r],
+                     (struct memory_pool_frame_header *)c->pools[r]);
         }
 
         case mpft_frame:
+            if (((struct memory_pool_frame_header *)pool)->remote != (void *)0)
+            {
+                collect_remote_pool_mem
+                    (&(((struct memory_pool_frame_header *)pool)->remote));
+            }
+
             return get_pool_mem_inner((struct memory_pool_frame_header *)pool,
                                       (struct memory_pool_frame_header *)pool);
     }
@@ -164,21 +380,86 @@ void free_pool_mem(void *mem)
    this is because get_mem_chunk() is supposed to use an address that is
    pagesize-aligned. */
 
-    struct memory_pool_frame_header *pool = (struct memory_pool_frame_header *)((((int_pointer)(((int_pointer)mem)) / LIBCURIE_PAGE_SIZE)) * LIBCURIE_PAGE_SIZE);
-    char *pool_mem_start = (char *)pool + sizeof(struct memory_pool_frame_header);
+    struct memory_pool_frame_header *pool = memory_frame (mem);
 
-    unsigned int index = (unsigned int)(((char*)mem - pool_mem_start) / pool->entitysize);
-    unsigned int cell = ((unsigned int)((index) / BITSPERBITMAPENTITY));
+    count_statistics (pool->entitysize, frees);
 
-    bitmap_clear (pool->map, index, cell);
-    pool->map[BITMAPMAPSIZE] |= ((BITMAPENTITYTYPE)(1 << cell));
+    if (memory_thread_safe && (pool->owner != thread_index ()))
+    {
+        void * volatile *remote = (pool->owner == memory_owner_any)
+                                ? &(pool->pool->remote)
+                                : &(memory_caches[pool->owner]->remote);
+        void *head;
+
+        do
+        {
+            head = *remote;
+            *((void **)mem) = head;
+        }
+        while (!memory_cas (remote, head, mem));
+
+        return;
+    }
+
+    free_pool_mem_local (pool, mem);
+}
+
+static char frame_full (struct memory_pool_frame_header *frame)
+{
+    unsigned int i, base;
+
+    /* the bits for entities beyond maxentities are always set, so they need
+       to be masked out */
+    for (i = 0, base = 0; (i < BITMAPMAPSIZE) && (base < frame->maxentities);
+         i++, base += BITSPERBITMAPENTITY)
+    {
+        BITMAPENTITYTYPE x = frame->map[i];
+
+        if ((frame->maxentities - base) < BITSPERBITMAPENTITY)
+        {
+            x &= (BITMAPENTITYTYPE)
+                     ((1 << (frame->maxentities - base)) - 1);
+        }
+
+        if (x != (BITMAPENTITYTYPE)0)
+        {
+            return (char)0;
+        }
+    }
+
+    return (char)1;
+}
+
+/* optimising frees and moves frames around, so the rooms list is redone from
+   scratch; the first frame may have changed, too. */
+static void queue_rooms (struct memory_pool_frame_header *pool)
+{
+    struct memory_pool_frame_header *frame;
+
+    pool->rooms = (struct memory_pool_frame_header *)0;
+
+    for (frame = pool; frame != (struct memory_pool_frame_header *)0;
+         frame = frame->next)
+    {
+        frame->pool   = pool;
+        frame->queued = (char)0;
+
+        if ((frame != pool) && !frame_full (frame))
+        {
+            frame->queued = (char)1;
+            frame->room   = pool->rooms;
+            pool->rooms   = frame;
+        }
+    }
 }
 
 void optimise_memory_pool(struct memory_pool *pool)
 {
     struct memory_pool_frame_header
         *cursor = (struct memory_pool_frame_header *)pool,
-        *last = (struct memory_pool_frame_header *)0;
+        *last = (struct memory_pool_frame_header *)0,
+        *full = (struct memory_pool_frame_header *)0,
+        *full_last = (struct memory_pool_frame_header *)0;
     unsigned int i;
 
     if (cursor->type != mpft_frame) return;
@@ -200,13 +481,53 @@ void optimise_memory_pool(struct memory_pool *pool)
             free_mem_chunk((void *)cursor);
             cursor = last;
         }
+        else if (frame_full (cursor))
+        {
+            /* full frames go to the end, so that get_pool_mem() finds the
+               ones with free entities first */
+            last->next   = cursor->next;
+            cursor->next = (struct memory_pool_frame_header *)0;
+
+            if (full_last == (struct memory_pool_frame_header *)0)
+            {
+                full = cursor;
+            }
+            else
+            {
+                full_last->next = cursor;
+            }
+
+            full_last = cursor;
+            cursor    = last;
+        }
+    }
+
+    if (cursor != (struct memory_pool_frame_header *)0)
+    {
+        cursor->next = full;
     }
+
+    queue_rooms ((struct memory_pool_frame_header *)pool);
 }
 
 void optimise_static_memory_pools()
 {
+    struct memory_pool_cache *c = memory_caches[memory_thread ()];
+    struct memory_pool **static_pools;
     unsigned int i;
 
+    if (c == (struct memory_pool_cache *)0)
+    {
+        return;
+    }
+
+    if (c->remote != (void *)0)
+    {
+        collect_remote_pool_mem (&(c->remote));
+    }
+
+    static_pools = c->pools;
+
     for (i = 0; i < POOLCOUNT; i++)
     {
         if (static_pools[i] != (struct memory_pool *)0)
@@ -237,6 +558,105 @@ void optimise_static_memory_pools()
                     h = (struct memory_pool_frame_header *)0;
                 }
             }
+
+            if (static_pools[i] != (struct memory_pool *)0)
+            {
+                queue_rooms
+                    ((struct memory_pool_frame_header *)(static_pools[i]));
+            }
+        }
+    }
+}
+
+void memory_statistics_start ( void )
+{
+    unsigned int i;
+
+    for (i = 0; i < POOLCOUNT; i++)
+    {
+        pool_statistics[i].allocations = 0;
+        pool_statistics[i].frees       = 0;
+    }
+
+    large_statistics.allocations = 0;
+    large_statistics.frees       = 0;
+    large_statistics.live        = 0;
+
+    memory_statistics_active = (char)1;
+}
+
+void memory_statistics_large (long size)
+{
+    if (size < 0)
+    {
+        large_statistics.frees++;
+
+        /* the block may well have been allocated before the counters were
+           started */
+        large_statistics.live =
+            (large_statistics.live > (unsigned long)(-size))
+            ? (large_statistics.live - (unsigned long)(-size)) : 0;
+    }
+    else
+    {
+        large_statistics.allocations++;
+        large_statistics.live += (unsigned long)size;
+    }
+}
+
+void memory_statistics (unsigned long size, struct memory_statistics *s)
+{
+    struct memory_pool_cache *c = memory_caches[memory_thread ()];
+    struct memory_pool_frame_header *h;
+    unsigned int r;
+
+    if (size == 0)
+    {
+        *s = large_statistics;
+        s->frames        = 0;
+        s->fragmentation = 0;
+        return;
+    }
+
+    size = calculate_aligned_memory_size (size);
+    r    = (unsigned int)((size / ENTITY_ALIGNMENT) - 1);
+
+    s->allocations   = (r < POOLCOUNT) ? pool_statistics[r].allocations : 0;
+    s->frees         = (r < POOLCOUNT) ? pool_statistics[r].frees       : 0;
+    s->frames        = 0;
+    s->live          = 0;
+    s->fragmentation = 0;
+
+    if ((r >= POOLCOUNT) || (c == (struct memory_pool_cache *)0))
+    {
+        return;
+    }
+
+    /* the bits for entities beyond maxentities are never cleared, so the
+       number of cleared bits is the number of entities in use */
+    for (h = (struct memory_pool_frame_header *)(c->pools[r]);
+         h != (struct memory_pool_frame_header *)0; h = h->next)
+    {
+        unsigned long used = 0;
+        unsigned int i;
+
+        for (i = 0; i < BITMAPMAPSIZE; i++)
+        {
+            BITMAPENTITYTYPE x = ~(h->map[i]);
+
+            while (x != (BITMAPENTITYTYPE)0)
+            {
+                x &= x - 1;
+                used++;
+            }
+        }
+
+        s->frames++;
+        s->live += used;
+
+        if ((used > 0) && (used < h->maxentities))
+        {
+            s->fragmentation += h->maxentities - used;
         }
     }
 }
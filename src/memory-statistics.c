@@ -0,0 +1,136 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/memory-statistics.h>
+#include <curie/memory.h>
+#include <curie/memory-internal.h>
+#include <curie/internal-constants.h>
+#include <curie/constants.h>
+#include <curie/multiplex.h>
+#include <curie/time.h>
+
+define_symbol (sym_memory_statistics,    "memory-statistics");
+define_symbol (sym_seconds,              "seconds");
+define_symbol (sym_size_class,           "size-class");
+define_symbol (sym_size,                 "size");
+define_symbol (sym_allocations,          "allocations");
+define_symbol (sym_frees,                "frees");
+define_symbol (sym_allocations_per_second, "allocations-per-second");
+define_symbol (sym_frames,               "frames");
+define_symbol (sym_live,                 "live");
+define_symbol (sym_fragmentation,        "fragmentation");
+define_symbol (sym_large,                "large");
+define_symbol (sym_bytes,                "bytes");
+
+static struct datetime start_time;
+
+static void start ( void )
+{
+    if (!memory_statistics_active)
+    {
+        start_time = dt_get ();
+        memory_statistics_start ();
+    }
+}
+
+static unsigned long seconds_since_start ( void )
+{
+    struct datetime now = dt_get ();
+
+    return (unsigned long)(now.date - start_time.date) * SECONDS_PER_DAY
+         + now.time - start_time.time;
+}
+
+static sexpr field (sexpr name, unsigned long value, sexpr rest)
+{
+    return cons (cons (name, cons (make_integer (value), sx_end_of_list)),
+                 rest);
+}
+
+sexpr sx_memory_statistics ( void )
+{
+    struct memory_statistics s;
+    unsigned long seconds, size;
+    sexpr rv = sx_end_of_list;
+
+    start ();
+
+    seconds = seconds_since_start ();
+
+    memory_statistics (0, &s);
+
+    rv = cons (cons (sym_large,
+                 field (sym_allocations, s.allocations,
+                 field (sym_frees, s.frees,
+                 field (sym_allocations_per_second,
+                        (seconds > 0) ? (s.allocations / seconds)
+                                      : s.allocations,
+                 field (sym_bytes, s.live, sx_end_of_list))))),
+               rv);
+
+    /* build the list back to front, so the sizes come out in order */
+    for (size = POOLCOUNT * ENTITY_ALIGNMENT; size > 0;
+         size -= ENTITY_ALIGNMENT)
+    {
+        memory_statistics (size, &s);
+
+        if ((s.allocations == 0) && (s.frees == 0) && (s.frames == 0))
+        {
+            continue;
+        }
+
+        rv = cons (cons (sym_size_class,
+                     field (sym_size, size,
+                     field (sym_allocations, s.allocations,
+                     field (sym_frees, s.frees,
+                     field (sym_allocations_per_second,
+                            (seconds > 0) ? (s.allocations / seconds)
+                                          : s.allocations,
+                     field (sym_frames, s.frames,
+                     field (sym_live, s.live,
+                     field (sym_fragmentation, s.fragmentation,
+                            sx_end_of_list)))))))),
+                   rv);
+    }
+
+    return cons (sym_memory_statistics,
+                 field (sym_seconds, seconds, rv));
+}
+
+static enum signal_callback_result on_signal (enum signal signal, void *aux)
+{
+    sx_write ((struct sexpr_io *)aux, sx_memory_statistics ());
+
+    return scr_keep;
+}
+
+void multiplex_memory_statistics (enum signal signal, struct sexpr_io *io)
+{
+    start ();
+
+    multiplex_add_signal (signal, on_signal, (void *)io);
+}
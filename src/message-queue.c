@@ -0,0 +1,222 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+
+#include <curie/message-queue.h>
+#include <curie/multiplex.h>
+#include <curie/memory.h>
+#include <curie/io-system.h>
+
+#if defined(__GNUC__)
+#define queue_cas(p,o,n) __sync_bool_compare_and_swap ((p), (o), (n))
+#define queue_barrier()  __sync_synchronize ()
+#else
+#define queue_cas(p,o,n) ((*(p) = (n)), 1)
+#define queue_barrier()
+#endif
+
+/* the ring is a sequence-numbered array, as in Vyukov's bounded queue: a slot
+   is free for the producer that claims position p once its sequence is p, and
+   it holds a message for the consumer once its sequence is p + 1. producers
+   claim positions by incrementing the tail, which is the only contended
+   word. */
+
+struct message_slot
+{
+    volatile unsigned long sequence;
+    unsigned int length;
+    char *data;
+    char inline_data[MESSAGE_QUEUE_INLINE];
+};
+
+struct message_queue
+{
+    volatile unsigned long tail;
+
+    /* set by the first producer that posts after the consumer started
+       draining; only that one writes to the wake-up descriptor. */
+    volatile int signalled;
+
+    unsigned long head;
+    unsigned long mask;
+    unsigned long size;
+    int event[2];
+    struct io *io;
+    struct io *wakeup;
+
+    struct message_slot slot[];
+};
+
+static void queue_drain (struct message_queue *q)
+{
+    struct message_slot *s;
+
+    q->signalled = 0;
+    queue_barrier ();
+
+    for (s = q->slot + (q->head & q->mask);
+         s->sequence == (q->head + 1);
+         s = q->slot + (q->head & q->mask))
+    {
+        if (io_collect (q->io, s->data, s->length) != io_incomplete)
+        {
+            /* left in the queue; the next post wakes us up again */
+            break;
+        }
+
+        if (s->data != s->inline_data)
+        {
+            free_mem (s->length, s->data);
+        }
+
+        queue_barrier ();
+
+        s->sequence = q->head + q->mask + 1;
+        q->head++;
+    }
+}
+
+static void queue_on_read (struct io *io, void *aux)
+{
+    io->position = io->length;
+
+    queue_drain ((struct message_queue *)aux);
+}
+
+static void queue_on_close (struct io *io, void *aux)
+{
+    struct message_queue *q = (struct message_queue *)aux;
+
+    if (q->event[1] != q->event[0])
+    {
+        (void)a_close (q->event[1]);
+    }
+
+    free_mem (q->size, (void *)q);
+}
+
+void multiplex_message_queue ( void )
+{
+    multiplex_io ();
+}
+
+struct io *io_open_message_queue
+        (unsigned int slots, struct message_queue **queue)
+{
+    struct message_queue *q;
+    unsigned long n = 1, size, i;
+    int event[2];
+
+    if (a_open_event (event) != io_complete)
+    {
+        return (struct io *)0;
+    }
+
+    while (n < slots)
+    {
+        n <<= 1;
+    }
+
+    size = sizeof (struct message_queue) + n * sizeof (struct message_slot);
+    q    = get_mem (size);
+
+    q->tail      = 0;
+    q->signalled = 0;
+    q->head      = 0;
+    q->mask      = n - 1;
+    q->size      = size;
+    q->event[0]  = event[0];
+    q->event[1]  = event[1];
+
+    for (i = 0; i < n; i++)
+    {
+        q->slot[i].sequence = i;
+    }
+
+    q->io     = io_open_special ();
+    q->wakeup = io_open (event[0]);
+    q->wakeup->type = iot_read;
+
+    multiplex_add_io (q->wakeup, queue_on_read, queue_on_close, (void *)q);
+
+    *queue = q;
+
+    return q->io;
+}
+
+enum io_result message_queue_post
+        (struct message_queue *queue, const char *data, unsigned int length)
+{
+    struct message_slot *s;
+    unsigned long t;
+    unsigned int i;
+    long d;
+    char *b;
+    int_64 one = 1;
+
+    do
+    {
+        t = queue->tail;
+        s = queue->slot + (t & queue->mask);
+        d = (long)(s->sequence - t);
+
+        if (d < 0)
+        {
+            /* the consumer hasn't got to this slot yet */
+            return io_no_change;
+        }
+    }
+    while ((d > 0) || !queue_cas (&(queue->tail), t, t + 1));
+
+    b = (length <= MESSAGE_QUEUE_INLINE) ? s->inline_data : get_mem (length);
+
+    for (i = 0; i < length; i++)
+    {
+        b[i] = data[i];
+    }
+
+    s->data   = b;
+    s->length = length;
+
+    queue_barrier ();
+
+    s->sequence = t + 1;
+
+    if (queue_cas (&(queue->signalled), 0, 1))
+    {
+        (void)a_write (queue->event[1], (void *)&one, sizeof (one));
+    }
+
+    return io_complete;
+}
+
+void message_queue_close (struct message_queue *queue)
+{
+    queue_drain (queue);
+
+    multiplex_del_io (queue->wakeup);
+}
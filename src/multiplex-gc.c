@@ -0,0 +1,66 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/gc.h>
+#include <curie/multiplex.h>
+#include <curie/multiplex-system.h>
+#include <curie/internal-constants.h>
+
+static enum multiplex_result mx_f_count(int *r, int *w);
+static void mx_f_augment(int *rs, int *r, int *ws, int *w);
+static void mx_f_callback(int *rs, int r, int *ws, int w);
+
+static struct multiplex_functions mx_functions = {
+    mx_f_count,
+    mx_f_augment,
+    mx_f_callback,
+    (struct multiplex_functions *)0
+};
+
+static enum multiplex_result mx_f_count(int *r, int *w) {
+    return mx_ok;
+}
+
+static void mx_f_augment(int *rs, int *r, int *ws, int *w) {
+}
+
+static void mx_f_callback(int *rs, int r, int *ws, int w) {
+    if (gc_sweeping) {
+        (void)gc_sweep (GC_SWEEP_TICK);
+    } else {
+        (void)gc_tidy ();
+    }
+}
+
+void multiplex_gc () {
+    static char installed = (char)0;
+
+    if (installed == (char)0) {
+        multiplex_add (&mx_functions);
+        installed = (char)1;
+    }
+}
@@ -26,6 +26,7 @@
 */
 
 #include <curie/multiplex-system.h>
+#include <curie/io-system.h>
 #include <curie/memory.h>
 
 static enum multiplex_result mx_f_count(int *r, int *w);
@@ -36,7 +37,8 @@ enum io_list_status
 {
     ils_nominal = 0x0,
     ils_active  = 0x1,
-    ils_kill    = 0x2
+    ils_kill    = 0x2,
+    ils_dead    = 0x4
 };
 
 struct io_list {
@@ -45,230 +47,634 @@ struct io_list {
     void (*on_close)(struct io *, void *);
     void *data;
     enum io_list_status status;
+
+    /* the file descriptor that this element is indexed under in fd_table, or
+       -1 if the element is kept in the special list */
+    int fd;
+
+    /* the multiplexer pass in which this element was last dispatched; this is
+       used to make sure that elements sharing a file descriptor are only
+       handled once per pass, even if the lists change during the callbacks */
+    unsigned int pass;
+
+    /* the multiplexer pass in which this element's read or write request was
+       queued */
+    unsigned int queued;
+
     struct io_list *next;
+    struct io_list *previous;
+    struct io_list *next_with_fd;
+
+    /* all the elements for the same io structure form a ring */
+    struct io_list *next_with_io;
 };
 
-static struct io_list *list = (struct io_list *)0;
+struct io_list_head {
+    struct io_list *first;
+    struct io_list *last;
+};
 
-static enum multiplex_result mx_f_count(int *r, int *w) {
-    struct io_list *l = list;
+/* elements are kept in one of two lists: elements with a usable file descriptor
+   are in fd_list and can be looked up by their descriptor using fd_table, all
+   others are in special_list. the latter contains iot_special_* structures and
+   structures that have lost their file descriptor and are due to be removed;
+   this way the callback passes that need to look at all special structures
+   never need to look at the (potentially very many) regular ones. at the end
+   of each pass, the elements that are due to be removed are moved from the
+   special list to dead_list, and they're flagged with ils_dead while they're
+   in there. */
+static struct io_list_head fd_list      = { (struct io_list *)0,
+                                            (struct io_list *)0 };
+static struct io_list_head special_list = { (struct io_list *)0,
+                                            (struct io_list *)0 };
+static struct io_list_head dead_list    = { (struct io_list *)0,
+                                            (struct io_list *)0 };
+
+static struct io_list **fd_table = (struct io_list **)0;
+static unsigned long fd_table_size = 0;
+
+static unsigned int pass = 0;
+
+/* total number of bytes to read per tick, the number of bytes read so far in
+   the current tick, and the most that the reads queued for the current round
+   may add to that */
+static unsigned long tick_budget = 0;
+static unsigned long tick_bytes  = 0;
+static unsigned long tick_queued = 0;
+
+/* set when reads were held back for the next round of the current tick */
+static char tick_deferred = (char)0;
+
+#define io_deadp(io)\
+    (((io)->status == io_end_of_file) ||\
+     ((io)->status == io_unrecoverable_error))
+
+/* fixed-size buffers that are full are not read from until some of the data
+   has been processed */
+#define io_fullp(io)\
+    (((io)->buffer_mode != iobm_linear) &&\
+     (((io)->length - (io)->position) >= (io)->buffersize))
+
+#define io_specialp(io)\
+    (((io)->type == iot_special_read) || ((io)->type == iot_special_write))
+
+static void list_append (struct io_list_head *h, struct io_list *l)
+{
+    l->next     = (struct io_list *)0;
+    l->previous = h->last;
 
-    while (l != (struct io_list *)0) {
-        struct io *io = l->io;
+    if (h->last == (struct io_list *)0)
+    {
+        h->first = l;
+    }
+    else
+    {
+        h->last->next = l;
+    }
+
+    h->last = l;
+}
+
+static void list_remove (struct io_list_head *h, struct io_list *l)
+{
+    if (l->previous == (struct io_list *)0)
+    {
+        h->first = l->next;
+    }
+    else
+    {
+        l->previous->next = l->next;
+    }
+
+    if (l->next == (struct io_list *)0)
+    {
+        h->last = l->previous;
+    }
+    else
+    {
+        l->next->previous = l->previous;
+    }
+}
+
+static void fd_table_reserve (int fd)
+{
+    unsigned long need = ((unsigned long)fd + 1) * sizeof (struct io_list *);
+
+    if (need > fd_table_size)
+    {
+        unsigned long newsize = need + LIBCURIE_PAGE_SIZE
+                              - (need % LIBCURIE_PAGE_SIZE), i;
+
+        fd_table = (fd_table_size == 0)
+                 ? get_mem (newsize)
+                 : resize_mem (fd_table_size, fd_table, newsize);
 
-        if ((io->fd == -1))
+        for (i = fd_table_size / sizeof (struct io_list *);
+             i < (newsize / sizeof (struct io_list *)); i++)
         {
-            switch (io->type) {
-                case iot_special_read:
-                case iot_special_write:
-                    if (io->status == io_changes)
-                    {
-                        return mx_immediate_action;
-                    }
-                    break;
-                default:
-                    break;
-            }
-        } else if ((io->status != io_end_of_file) &&
-                   (io->status != io_unrecoverable_error))
+            fd_table[i] = (struct io_list *)0;
+        }
+
+        fd_table_size = newsize;
+    }
+}
+
+static void index_element (struct io_list *l)
+{
+    int fd = l->io->fd;
+
+    if ((fd < 0) || io_specialp (l->io))
+    {
+        l->fd = -1;
+        list_append (&special_list, l);
+    }
+    else
+    {
+        fd_table_reserve (fd);
+
+        l->fd           = fd;
+        l->next_with_fd = fd_table[fd];
+        fd_table[fd]    = l;
+        list_append (&fd_list, l);
+    }
+}
+
+static void unindex_element (struct io_list *l)
+{
+    if (l->fd < 0)
+    {
+        list_remove (((l->status & ils_dead) ? &dead_list : &special_list), l);
+    }
+    else
+    {
+        struct io_list **p = &(fd_table[l->fd]);
+
+        while (*p != l)
         {
-            switch (io->type) {
-                case iot_read:
-                    (*r) += 1;
-                    break;
-                case iot_write:
-                    if (io->length == 0) goto next;
+            p = &((*p)->next_with_fd);
+        }
 
-                    (*w) += 1;
-                    break;
-                default:
-                    break;
+        *p = l->next_with_fd;
+        list_remove (&fd_list, l);
+    }
+}
+
+/* called after an element's io structure has been used; if the structure lost
+   its file descriptor it is moved to the special list, which is where it'll be
+   picked up for removal at the end of the pass. */
+static void reindex_element (struct io_list *l)
+{
+    if ((l->fd >= 0) && ((l->io->fd != l->fd) || io_deadp (l->io)))
+    {
+        unindex_element (l);
+        l->fd = -1;
+        list_append (&special_list, l);
+    }
+}
+
+/* elements are looked up under the io structure's current descriptor; if that
+   was changed behind the multiplexer's back, the element is moved to the
+   special list the next time the multiplexer runs. */
+static struct io_list *find_element (struct io *io)
+{
+    struct io_list *l;
+
+    if ((io->fd >= 0) &&
+        (((unsigned long)io->fd * sizeof (struct io_list *)) < fd_table_size))
+    {
+        for (l = fd_table[io->fd]; l != (struct io_list *)0;
+             l = l->next_with_fd)
+        {
+            if (l->io == io)
+            {
+                return l;
             }
         }
+    }
 
-        next:
-        l = l->next;
+    for (l = special_list.first; l != (struct io_list *)0; l = l->next)
+    {
+        if (l->io == io)
+        {
+            return l;
+        }
     }
 
-    return mx_ok;
+    /* only ever non-empty while the dead elements are being removed */
+    for (l = dead_list.first; l != (struct io_list *)0; l = l->next)
+    {
+        if (l->io == io)
+        {
+            return l;
+        }
+    }
+
+    return (struct io_list *)0;
 }
 
-static void mx_f_augment(int *rs, int *r, int *ws, int *w) {
-    struct io_list *l = list;
+/* removes all the elements for l's io structure and closes it; returns 0 if
+   one of the elements is busy, in which case it's flagged so that it'll be
+   removed once its callback returns. the elements are marked active while
+   their on_close callbacks run, so that they can't be removed from under us
+   by the callbacks. */
+static char del_ring (struct io_list *l)
+{
+    struct io *io = l->io;
+    struct io_list *m, *n;
+
+    m = l;
+    do
+    {
+        if (m->status & ils_active)
+        {
+            m->status |= ils_kill;
+            return (char)0;
+        }
+
+        m = m->next_with_io;
+    }
+    while (m != l);
+
+    do
+    {
+        m->status |= ils_active;
+        m = m->next_with_io;
+    }
+    while (m != l);
+
+    do
+    {
+        if (m->on_close != (void (*)(struct io *, void *))0)
+        {
+            void (*f)(struct io *, void *) = m->on_close;
+            m->on_close = (void (*)(struct io *, void *))0;
+            f (io, m->data);
+        }
+
+        m = m->next_with_io;
+    }
+    while (m != l);
+
+    /* this includes any elements that the callbacks added */
+    m = l;
+    do
+    {
+        n = m->next_with_io;
+
+        unindex_element (m);
+        free_pool_mem (m);
+
+        m = n;
+    }
+    while (m != l);
+
+    io_close (io);
 
-    while (l != (struct io_list *)0) {
+    return (char)1;
+}
+
+static enum multiplex_result mx_f_count(int *r, int *w) {
+    struct io_list *l, *n;
+
+    for (l = special_list.first; l != (struct io_list *)0; l = l->next)
+    {
+        if (io_specialp (l->io) && (l->io->status == io_changes))
+        {
+            return mx_immediate_action;
+        }
+    }
+
+    for (l = fd_list.first; l != (struct io_list *)0; l = n)
+    {
         struct io *io = l->io;
 
-        if ((io->fd != -1) &&
-            (io->status != io_end_of_file) &&
-            (io->status != io_unrecoverable_error))
+        n = l->next;
+
+        if (io_deadp (io) || (io->fd != l->fd))
         {
-            int i, t, fd = io->fd;
-
-            switch (io->type) {
-                case iot_read:
-                    t = *r;
-                    for (i = 0; i < t; i++) {
-                        if (rs[i] == fd) {
-                            goto next;
-                        }
-                    }
-                    rs[i] = fd;
+            /* the status was changed from outside, e.g. with
+               multiplex_del_sexpr(); have the element removed the next time
+               the callbacks run. */
+            reindex_element (l);
+            continue;
+        }
+
+        switch (io->type) {
+            case iot_read:
+                if (!io_fullp (io))
+                {
                     (*r) += 1;
-                    break;
-                case iot_write:
-                    if (io->length == 0) goto next;
-
-                    t = *w;
-                    for (i = 0; i < t; i++) {
-                        if (ws[i] == fd) {
-                            goto next;
-                        }
-                    }
-                    ws[i] = fd;
+                }
+                break;
+            case iot_write:
+                if (io->length != 0)
+                {
                     (*w) += 1;
-                    break;
-                default:
-                    break;
-            }
+                }
+                break;
+            default:
+                break;
         }
+    }
+
+    return mx_ok;
+}
+
+/* elements that share a file descriptor are chained up in fd_table, so in order
+   to avoid adding the same descriptor twice we only add it for the first
+   element in the chain that is interested in it. */
+static char first_with_fd (struct io_list *l, enum io_type type)
+{
+    struct io_list *c;
 
-        next:
-        l = l->next;
+    for (c = fd_table[l->fd]; c != l; c = c->next_with_fd)
+    {
+        if ((c->io->type == type) &&
+            ((type != iot_write) || (c->io->length != 0)) &&
+            ((type != iot_read) || !io_fullp (c->io)))
+        {
+            return (char)0;
+        }
     }
+
+    return (char)1;
 }
 
-static void mx_f_callback(int *rs, int r, int *ws, int w) {
-    struct io_list *l = list, *t;
-    char changes = 1;
+static void mx_f_augment(int *rs, int *r, int *ws, int *w) {
+    struct io_list *l;
 
-    while (l != (struct io_list *)0) {
+    for (l = fd_list.first; l != (struct io_list *)0; l = l->next)
+    {
         struct io *io = l->io;
 
-        if (l->status & ils_active)
+        if (io_deadp (io) || (io->fd != l->fd))
         {
-            goto next;
+            continue;
         }
 
-        if (io->fd == -1)
-        {
-            switch (io->type) {
-                case iot_special_read:
-                case iot_special_write:
-                    if (l->on_read != (void *)0)
-                    {
-                        if (io_read(io) == io_changes)
-                        {
-                            l->status |= ils_active;
-                            l->on_read (io, l->data);
-                            l->status &= ~ils_active;
-                        }
-                    }
-                    break;
-                default:
-                    break;
-            }
+        switch (io->type) {
+            case iot_read:
+                if (!io_fullp (io) && first_with_fd (l, iot_read))
+                {
+                    rs[*r] = l->fd;
+                    (*r) += 1;
+                }
+                break;
+            case iot_write:
+                if ((io->length != 0) && first_with_fd (l, iot_write))
+                {
+                    ws[*w] = l->fd;
+                    (*w) += 1;
+                }
+                break;
+            default:
+                break;
         }
-        else if ((io->status != io_end_of_file) &&
-                 (io->status != io_unrecoverable_error))
+    }
+}
+
+/* queue read or write requests for all the elements waiting for the given
+   descriptor; the requests are carried out in one go by io_queue_submit(),
+   which uses a single syscall for all of them where the OS allows that. no
+   callbacks are run at this point, so the chain can't change under us.
+   with a tick budget, reads are only queued while what they may return still
+   fits in the budget; the rest wait for the next round of the same tick, in
+   case the reads return less than they asked for. */
+static void queue_fd (int fd, enum io_type type)
+{
+    struct io_list *l;
+
+    if (((unsigned long)fd * sizeof (struct io_list *)) >= fd_table_size)
+    {
+        return;
+    }
+
+    for (l = fd_table[fd]; l != (struct io_list *)0; l = l->next_with_fd)
+    {
+        struct io *io = l->io;
+
+        if ((l->queued != pass) && !(l->status & ils_active) &&
+            (io->type == type) && (io->fd == fd) && !io_deadp (io) &&
+            ((type != iot_write) || (io->length != 0)))
         {
-            int i, fd = io->fd;
-
-            switch (io->type) {
-                case iot_read:
-                    for (i = 0; i < r; i++) {
-                        if (rs[i] == fd) {
-                            (void)io_read (io);
-                            if (l->on_read != (void *)0)
-                            {
-                                l->status |= ils_active;
-                                l->on_read (io, l->data);
-                                l->status &= ~ils_active;
-                            }
-                        }
-                    }
-                    break;
-                case iot_write:
-                    if (io->length == 0) goto next;
-
-                    for (i = 0; i < w; i++) {
-                        if (ws[i] == fd) {
-                            (void)io_commit (io);
-                        }
-                    }
-                    break;
-                default:
-                    break;
+            unsigned int size;
+
+            if ((type == iot_read) && (tick_budget != 0))
+            {
+                if (tick_bytes >= tick_budget)
+                {
+                    /* skipped this time; also skip the callback */
+                    l->pass = pass;
+                    io->statistics.starved++;
+                    continue;
+                }
+
+                if ((tick_queued != 0) &&
+                    ((tick_bytes + tick_queued) >= tick_budget))
+                {
+                    tick_deferred = (char)1;
+                    continue;
+                }
+            }
+
+            l->queued = pass;
+
+            if (type == iot_read)
+            {
+                if (io_read_queue (io, &size) == io_incomplete)
+                {
+                    tick_queued += size;
+                }
+                else
+                {
+                    tick_bytes += size;
+                }
+            }
+            else
+            {
+                (void)io_commit_queue (io);
             }
         }
+    }
+}
+
+static void dispatch_element (struct io_list *l)
+{
+    struct io *io = l->io;
 
-        next:
-        t = l;
-        l = l->next;
+    l->pass = pass;
 
-        if (t->status == ils_kill)
+    if (l->fd >= 0)
+    {
+        /* move the element to the end of the list, so that elements which
+           haven't been serviced in a while get to go first next time */
+        list_remove (&fd_list, l);
+        list_append (&fd_list, l);
+    }
+
+    if ((io->type == iot_read) && (l->on_read != (void *)0))
+    {
+        l->status |= ils_active;
+        l->on_read (io, l->data);
+        l->status &= ~ils_active;
+    }
+
+    reindex_element (l);
+
+    if (l->status & ils_kill)
+    {
+        l->status &= ~ils_kill;
+        multiplex_del_io (io);
+    }
+}
+
+/* run the callbacks for all elements whose requests were carried out */
+static void dispatch_fd (int fd)
+{
+    struct io_list *l;
+
+    if (((unsigned long)fd * sizeof (struct io_list *)) >= fd_table_size)
+    {
+        return;
+    }
+
+  retry:
+    for (l = fd_table[fd]; l != (struct io_list *)0; l = l->next_with_fd)
+    {
+        if ((l->queued == pass) && (l->pass != pass) &&
+            !(l->status & ils_active))
         {
-            multiplex_del_io (io);
+            dispatch_element (l);
+
+            /* the callback may have modified the chain, so start over */
+            goto retry;
         }
     }
+}
+
+/* run the on_read callbacks of all special structures that have changes; the
+   list is rescanned after each callback since the callback may well have
+   added or removed elements. returns 1 if any callbacks were run. */
+static char dispatch_special ( void )
+{
+    struct io_list *l;
+    char changes = (char)0;
+
+    pass++;
 
-    while (changes)
+  retry:
+    for (l = special_list.first; l != (struct io_list *)0; l = l->next)
     {
-        changes = 0;
-        l = list;
+        struct io *io = l->io;
 
-        while (l != (struct io_list *)0) {
-            struct io *io = l->io;
+        if ((l->pass != pass) && !(l->status & ils_active) &&
+            io_specialp (io) && (l->on_read != (void *)0))
+        {
+            l->pass = pass;
 
-            if (!(l->status & ils_active) &&
-                (io->fd == -1))
+            if (io_read(io) == io_changes)
             {
-                switch (io->type) {
-                    case iot_special_read:
-                    case iot_special_write:
-                        if (l->on_read != (void *)0)
-                        {
-                            if (io_read(io) == io_changes)
-                            {
-                                l->status |= ils_active;
-                                l->on_read (io, l->data);
-                                changes = 1;
-                                l->status &= ~ils_active;
-                            }
-                        }
-                        break;
-                    default:
-                        break;
+                l->status |= ils_active;
+                l->on_read (io, l->data);
+                l->status &= ~ils_active;
+                changes = (char)1;
+
+                if (l->status & ils_kill)
+                {
+                    l->status &= ~ils_kill;
+                    multiplex_del_io (io);
                 }
+
+                goto retry;
             }
+        }
+    }
+
+    return changes;
+}
+
+static void mx_f_callback(int *rs, int r, int *ws, int w) {
+    struct io_list *l, *n;
+    int i;
+
+    (void)dispatch_special ();
+
+    pass++;
+    tick_bytes = 0;
 
-            t = l;
-            l = l->next;
-            
-            if (t->status == ils_kill)
+    for (i = 0; i < w; i++)
+    {
+        if (ws[i] >= 0)
+        {
+            queue_fd (ws[i], iot_write);
+        }
+    }
+
+    /* each round queues at least one read, so this ends once all the ready
+       structures have either been read from or starved */
+    do
+    {
+        tick_queued   = 0;
+        tick_deferred = (char)0;
+
+        for (i = 0; i < r; i++)
+        {
+            if (rs[i] >= 0)
             {
-                multiplex_del_io (io);
+                queue_fd (rs[i], iot_read);
             }
         }
+
+        tick_bytes += io_queue_submit ();
+    }
+    while (tick_deferred);
+
+    for (i = 0; i < r; i++)
+    {
+        if (rs[i] >= 0)
+        {
+            dispatch_fd (rs[i]);
+        }
+    }
+
+    for (i = 0; i < w; i++)
+    {
+        if (ws[i] >= 0)
+        {
+            dispatch_fd (ws[i]);
+        }
     }
 
-    retry:
-    l = list;
+    while (dispatch_special ());
 
-    while (l != (struct io_list *)0) {
+    /* no callbacks are run while the dead elements are collected, so the list
+       can be walked just once; the on_close callbacks that are run while
+       they're removed may remove any of the others, so those are always taken
+       from the front of dead_list. */
+    for (l = special_list.first; l != (struct io_list *)0; l = n)
+    {
         struct io *io = l->io;
 
-        if (((io->fd == -1) &&
-             (io->type != iot_special_read) &&
-             (io->type != iot_special_write)) ||
-            (io->status == io_end_of_file) ||
-            (io->status == io_unrecoverable_error))
+        n = l->next;
+
+        if (!(l->status & ils_active) &&
+            (((io->fd == -1) && !io_specialp (io)) || io_deadp (io)))
         {
-            multiplex_del_io (io);
-            goto retry;
+            list_remove (&special_list, l);
+            list_append (&dead_list, l);
+            l->status |= ils_dead;
         }
+    }
 
-        l = l->next;
+    while ((l = dead_list.first) != (struct io_list *)0)
+    {
+        if (!del_ring (l))
+        {
+            /* it's busy; it'll be removed once it isn't */
+            list_remove (&dead_list, l);
+            list_append (&special_list, l);
+            l->status &= ~ils_dead;
+        }
     }
 }
 
@@ -288,34 +694,37 @@ void multiplex_io () {
     }
 }
 
+void multiplex_io_budget (unsigned long bytes)
+{
+    tick_budget = bytes;
+}
+
 void multiplex_add_io (struct io *io, void (*on_read)(struct io *, void *), void (*on_close)(struct io *, void *), void *data) {
     static struct memory_pool pool
             = MEMORY_POOL_INITIALISER(sizeof (struct io_list));
 
-    struct io_list *list_element = get_pool_mem (&pool);
+    struct io_list *list_element = get_pool_mem (&pool), *ring;
 
-    list_element->next = (void *)0;
     list_element->io = io;
     list_element->on_read = on_read;
     list_element->on_close = on_close;
     list_element->status = ils_nominal;
     list_element->data = data;
+    list_element->pass = pass;
+    list_element->queued = pass;
+    list_element->next_with_fd = (struct io_list *)0;
 
-    if (list == (void *)0)
+    if ((ring = find_element (io)) != (struct io_list *)0)
     {
-        list = list_element;
+        list_element->next_with_io = ring->next_with_io;
+        ring->next_with_io = list_element;
     }
     else
     {
-        struct io_list *cx = list;
-
-        while ((cx->next) != (struct io_list *)0)
-        {
-            cx = cx->next;
-        }
-
-        cx->next = list_element;
+        list_element->next_with_io = list_element;
     }
+
+    index_element (list_element);
 }
 
 void multiplex_add_io_no_callback (struct io *io)
@@ -325,54 +734,10 @@ void multiplex_add_io_no_callback (struct io *io)
 
 void multiplex_del_io (struct io *io)
 {
-    struct io_list *l = list, **p;
-    char av = (char)0;
-
-
-    while (l != (struct io_list *)0) {
-        if (l->io == io)
-        {
-            if (l->status & ils_active)
-            {
-                l->status |= ils_kill;
-                return;
-            }
-
-            if (l->on_close != (void (*)(struct io *, void *))0)
-            {
-                void (*f)(struct io *, void *) = l->on_close;
-                l->on_close = (void (*)(struct io *, void *))0;
-                f (l->io, l->data);
-            }
-        }
-
-        l = l->next;
-    }
-
-    l = list;
-    p = &list;
-
-    while (l != (struct io_list *)0) {
-        if (l->io == io)
-        {
-            struct io_list *t = l;
-
-            *p = l->next;
-            p = &(l->next);
-            l = *p;
-
-            free_pool_mem (t);
-
-            av = (char)1;
-            continue;
-        }
-
-        p = &(l->next);
-        l = l->next;
-    }
+    struct io_list *l = find_element (io);
 
-    if (av == (char)1)
+    if (l != (struct io_list *)0)
     {
-        io_close (io);
+        (void)del_ring (l);
     }
 }
@@ -27,34 +27,51 @@
 
 #include <syscall/syscall.h>
 #include <curie/multiplex.h>
+#include <curie/multiplex-system.h>
 #include <curie/signal.h>
 #include <curie/signal-system.h>
-#include <curie/tree.h>
 #include <curie/memory.h>
-#include <curie/network.h>
-#include <curie/stack.h>
+#include <curie/io-system.h>
+
+#if defined(__GNUC__)
+#define signal_cas(p,o,n) __sync_bool_compare_and_swap ((p), (o), (n))
+#define signal_barrier()  __sync_synchronize ()
+#else
+#define signal_cas(p,o,n) ((*(p) = (n)), 1)
+#define signal_barrier()
+#endif
 
 struct handler {
-    enum signal signal;
     enum signal_callback_result (*handler)(enum signal, void *);
     void *data;
     struct handler *next;
 };
 
-static struct handler *signal_handlers
-        = (struct handler *)0;
+/* handlers are kept in one list per signal, so delivering a signal only looks
+   at the handlers that are interested in it. */
+static struct handler *signal_handlers[(SIGNAL_MAX_NUM + 1)];
 static char installed = (char)0;
 
+/* the OS-level handler only ever sets flags, which is safe no matter what the
+   main loop is doing at the time; a signal that comes in again before the
+   first one was delivered is only delivered once. */
+static volatile char pending[(SIGNAL_MAX_NUM + 1)];
+static volatile char signals_pending = (char)0;
+
+/* with multiplex_signal_primary(), the first signal after each delivery also
+   makes a wake-up descriptor readable, so that select() returns. */
+static int event[2] = { -1, -1 };
+static volatile int signalled = 0;
+
 static void invoke (enum signal signal) {
-    struct handler *h = signal_handlers, *hp = (struct handler *)0;
+    struct handler *h = signal_handlers[signal], *hp = (struct handler *)0;
 
     while (h != (struct handler *)0) {
-        if ((h->signal == signal) &&
-            (h->handler (signal, h->data) == scr_ditch)) {
+        if (h->handler (signal, h->data) == scr_ditch) {
             if (hp == (struct handler *)0) {
-                signal_handlers = h->next;
+                signal_handlers[signal] = h->next;
                 free_pool_mem ((void *)h);
-                h = signal_handlers;
+                h = signal_handlers[signal];
             } else {
                 hp->next = h->next;
                 free_pool_mem ((void *)h);
@@ -68,94 +85,108 @@ static void invoke (enum signal signal) {
     }
 }
 
-static void queue_on_read (struct io *qin, void *u) {
-    unsigned int position = (unsigned int)(qin->position / sizeof(enum signal)),
-                 length   = (unsigned int)(qin->length / sizeof(enum signal));
+static void deliver ( void ) {
+    char buffer[8];
+    int i;
 
-    enum signal *buffer = (enum signal *)qin->buffer;
-    if (buffer == (enum signal *)0) return;
+    if (signals_pending == (char)0) return;
 
-    while (position < length) {
-        invoke (buffer[position]);
+    signals_pending = (char)0;
 
-        position++;
+    if (signal_cas (&signalled, 1, 0)) {
+        (void)a_read (event[0], (void *)buffer, sizeof (buffer));
     }
 
-    qin->position = (unsigned int)(position * sizeof(enum signal));
-}
+    signal_barrier ();
 
-static struct io *signal_queue = (struct io *)0;
-
-static void queue_on_close (struct io *qin, void *u) {
-    signal_queue = io_open_special();
-    if (signal_queue != (struct io *)0) {
-        multiplex_add_io (signal_queue, queue_on_read, queue_on_close,
-                          (void *)0);
+    for (i = 0; i <= SIGNAL_MAX_NUM; i++) {
+        if (pending[i] != (char)0) {
+            pending[i] = (char)0;
+            invoke ((enum signal)i);
+        }
     }
 }
 
 static void generic_signal_handler (enum signal signal) {
-    if (signal_queue == (struct io *)0) return;
-    (void)io_write (signal_queue,
-                    (char *)&signal,
-                    (unsigned int)sizeof(enum signal));
-}
+    int_64 one = 1;
 
-void multiplex_signal () {
-    if (installed == (char)0) {
-        int i;
+    pending[signal] = (char)1;
+    signals_pending = (char)1;
 
-        multiplex_io();
+    if ((event[1] >= 0) && signal_cas (&signalled, 0, 1)) {
+        (void)a_write (event[1], (void *)&one, sizeof (one));
+    }
+}
 
-        for (i = 0; i < SIGNAL_MAX_NUM; i++) {
-            enum signal s = (enum signal)i;
-            if ((s != sig_bus) && (s != sig_segv) && (s != sig_trap) &&
-                (s != sig_kill) && (s != sig_stop))
-            {
-                a_set_signal_handler (s, generic_signal_handler);
-            }
-        }
+static enum multiplex_result mx_f_count (int *r, int *w) {
+    if (signals_pending != (char)0) {
+        return mx_immediate_action;
+    }
 
-        if ((signal_queue = io_open_special()) == (struct io *)0)
-        {
-            return;
-        }
+    if (event[0] >= 0) {
+        (*r) += 1;
+    }
 
-        multiplex_add_io (signal_queue, queue_on_read, queue_on_close,
-                          (void *)0);
+    return mx_ok;
+}
 
-        installed = (char)1;
+static void mx_f_augment (int *rs, int *r, int *ws, int *w) {
+    if (event[0] >= 0) {
+        rs[(*r)] = event[0];
+        (*r) += 1;
     }
 }
 
-void multiplex_signal_primary () {
-#if defined(_WIN32)
-    multiplex_signal ();
-#else
-    if (installed == (char)0) {
-        static struct io *signal_queue_in;
-        int i;
+static void mx_f_callback (int *rs, int r, int *ws, int w) {
+    int i;
 
-        multiplex_io();
+    for (i = 0; i < r; i++) {
+        if (rs[i] == event[0]) {
+            rs[i] = -1;
+        }
+    }
 
-        for (i = 0; i < SIGNAL_MAX_NUM; i++) {
-            enum signal s = (enum signal)i;
-            if ((s != sig_bus) && (s != sig_segv) && (s != sig_trap) &&
-                (s != sig_kill) && (s != sig_stop))
-            {
-                a_set_signal_handler (s, generic_signal_handler);
-            }
+    deliver ();
+}
+
+static void install ( void ) {
+    static struct multiplex_functions mx_functions = {
+        mx_f_count,
+        mx_f_augment,
+        mx_f_callback,
+        (struct multiplex_functions *)0
+    };
+    int i;
+
+    for (i = 0; i < SIGNAL_MAX_NUM; i++) {
+        enum signal s = (enum signal)i;
+        if ((s != sig_bus) && (s != sig_segv) && (s != sig_trap) &&
+            (s != sig_kill) && (s != sig_stop))
+        {
+            a_set_signal_handler (s, generic_signal_handler);
         }
+    }
 
-        net_open_loop (&signal_queue_in, &signal_queue);
+    multiplex_add (&mx_functions);
 
-        multiplex_add_io (signal_queue_in, queue_on_read, queue_on_close,
-                          (void *)0);
-        multiplex_add_io_no_callback (signal_queue);
+    installed = (char)1;
+}
 
-        installed = (char)1;
+void multiplex_signal () {
+    if (installed == (char)0) {
+        install ();
+    }
+}
+
+void multiplex_signal_primary () {
+#if !defined(_WIN32)
+    if ((event[0] < 0) && (a_open_event (event) != io_complete)) {
+        event[0] = -1;
+        event[1] = -1;
     }
 #endif
+
+    multiplex_signal ();
 }
 
 void multiplex_add_signal
@@ -165,12 +196,15 @@ void multiplex_add_signal
 {
     static struct memory_pool pool
             = MEMORY_POOL_INITIALISER (sizeof(struct handler));
-    struct handler *element = get_pool_mem (&pool);
+    struct handler *element;
+
+    if ((int)signal > SIGNAL_MAX_NUM) return;
+
+    element = get_pool_mem (&pool);
 
-    element->signal = signal;
     element->data = data;
     element->handler = handler;
 
-    element->next = signal_handlers;
-    signal_handlers = element;
+    element->next = signal_handlers[signal];
+    signal_handlers[signal] = element;
 }
@@ -53,3 +53,18 @@ sexpr read_directory_rx (const char *base, sexpr rx)
 
     return r;
 }
+
+unsigned long read_directory_glob
+        (const char *p, void (*callback)(const char *, void *), void *aux)
+{
+    sexpr r = read_directory (p);
+    unsigned long rv = 0;
+
+    for (; consp (r); r = cdr (r))
+    {
+        callback (sx_string (car (r)), aux);
+        rv++;
+    }
+
+    return rv;
+}
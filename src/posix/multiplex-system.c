@@ -25,48 +25,52 @@
  * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
 */
 
-#define _POSIX_SOURCE
+#define _POSIX_C_SOURCE 200112L
 
 #include <curie/multiplex-system.h>
-#include <sys/select.h>
+#include <curie/memory.h>
+#include <poll.h>
+
+static struct pollfd *pollfds = (struct pollfd *)0;
+static unsigned long pollfds_size = 0;
 
 void a_select_with_fds (int *rfds, int rnum, int *wfds, int wnum) {
-    fd_set rset, wset;
-    int highest = 0, r, i;
+    unsigned long need = (unsigned long)(rnum + wnum) * sizeof(struct pollfd);
+    int i, r;
 
-    FD_ZERO(&rset);
+    if (need > pollfds_size) {
+        unsigned long newsize = need + LIBCURIE_PAGE_SIZE
+                              - (need % LIBCURIE_PAGE_SIZE);
 
-    for (i = 0; i < rnum; i++) {
-        if (rfds[i] > highest) highest = rfds[i];
-        FD_SET(rfds[i], &rset);
+        pollfds = (pollfds_size == 0)
+                ? get_mem (newsize)
+                : resize_mem (pollfds_size, pollfds, newsize);
+        pollfds_size = newsize;
     }
 
-    FD_ZERO(&wset);
+    for (i = 0; i < rnum; i++) {
+        pollfds[i].fd      = rfds[i];
+        pollfds[i].events  = POLLIN;
+        pollfds[i].revents = 0;
+    }
 
     for (i = 0; i < wnum; i++) {
-        if (wfds[i] > highest) highest = wfds[i];
-        FD_SET(wfds[i], &wset);
+        pollfds[(rnum + i)].fd      = wfds[i];
+        pollfds[(rnum + i)].events  = POLLOUT;
+        pollfds[(rnum + i)].revents = 0;
     }
 
-    r = select(highest + 1, &rset, &wset, (fd_set *)0, (void *)0);
+    r = poll (pollfds, (nfds_t)(rnum + wnum), -1);
 
-    if (r <= 0) {
-        for (i = 0; i < rnum; i++) {
+    for (i = 0; i < rnum; i++) {
+        if ((r <= 0) || (pollfds[i].revents == 0)) {
             rfds[i] = -1;
         }
-        for (i = 0; i < wnum; i++) {
+    }
+
+    for (i = 0; i < wnum; i++) {
+        if ((r <= 0) || (pollfds[(rnum + i)].revents == 0)) {
             wfds[i] = -1;
         }
-    } else {
-        for (i = 0; i < rnum; i++) {
-            if (!FD_ISSET(rfds[i], &rset)) {
-                rfds[i] = -1;
-            }
-        }
-        for (i = 0; i < wnum; i++) {
-            if (!FD_ISSET(wfds[i], &wset)) {
-                wfds[i] = -1;
-            }
-        }
     }
 }
@@ -51,21 +51,39 @@ sexpr sx_alist_add (sexpr alist, sexpr key, sexpr value)
 
 sexpr sx_alist_remove (sexpr alist, sexpr key)
 {
-    sexpr r = sx_end_of_list;
+    struct sexpr_list_builder list;
+    sexpr tail = sx_nonexistent, c = alist;
+    unsigned long length = 0;
 
-    while (consp (alist))
+    sx_list_builder_initialise (&list);
+
+    while (consp (c))
     {
-        sexpr a = car (alist);
+        sexpr a = car (c);
+
+        c = cdr (c);
 
         if (falsep (equalp (car (a), key)))
         {
-            r = cons (a, r);
+            sx_list_builder_append (&list, a);
+        }
+        else
+        {
+            /* everything after the last match can be shared as-is */
+            length = list.length;
+            tail   = c;
         }
+    }
 
-        alist = cdr (alist);
+    if (nexp (tail))
+    {
+        sx_list_builder_release (&list);
+        return alist;
     }
 
-    return r;
+    list.length = length;
+
+    return sx_list_builder_finish (&list, tail);
 }
 
 sexpr sx_alist_merge (sexpr alist1, sexpr alist2)
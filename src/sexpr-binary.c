@@ -0,0 +1,568 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/memory.h>
+#include <curie/sexpr.h>
+#include <curie/io.h>
+#include <curie/gc.h>
+#include <curie/tree.h>
+#include <curie/internal-constants.h>
+#include <curie/sexpr-internal.h>
+
+/* each value starts with one of these tags; integers from 0 to 127 are sent
+   as sxb_small_integer plus the value, in a single byte */
+enum sx_binary_tag
+{
+    sxb_end_of_list       = 0x00,
+    sxb_true              = 0x01,
+    sxb_false             = 0x02,
+    sxb_nil               = 0x03,
+    sxb_end_of_file       = 0x04,
+    sxb_nonexistent       = 0x05,
+    sxb_not_a_number      = 0x06,
+    sxb_positive_infinity = 0x07,
+    sxb_negative_infinity = 0x08,
+    sxb_dot               = 0x09,
+    sxb_quote             = 0x0a,
+    sxb_quasiquote        = 0x0b,
+    sxb_unquote           = 0x0c,
+    sxb_splice            = 0x0d,
+    sxb_integer           = 0x10, /* zigzag varint */
+    sxb_rational          = 0x11, /* zigzag varint numerator and denominator */
+    sxb_string            = 0x12, /* varint length, characters */
+    sxb_symbol            = 0x13, /* same as a string */
+    sxb_symbol_define     = 0x14, /* like a symbol, then added to the table */
+    sxb_symbol_reference  = 0x15, /* varint index into the table */
+    sxb_special           = 0x16, /* varint code point */
+    sxb_list              = 0x17, /* varint count, elements, then the tail */
+    sxb_small_integer     = 0x80
+};
+
+struct sexpr_binary
+{
+    struct tree *out_index;
+    sexpr        out_symbols;
+    unsigned int out_count;
+    gc_root      out_root;
+
+    sexpr        in_symbols;
+    unsigned int in_count;
+    gc_root      in_root;
+    sexpr        in[SX_BINARY_SYMBOLS];
+};
+
+struct sx_binary_cursor
+{
+    const unsigned char *p;
+    const unsigned char *end;
+    char                 broken;
+    unsigned int         depth;
+};
+
+static struct sexpr_binary *sx_get_binary (struct sexpr_io *io)
+{
+    struct sexpr_binary *b = io->binary;
+
+    if (b == (struct sexpr_binary *)0)
+    {
+        b = get_mem (sizeof (struct sexpr_binary));
+
+        b->out_index   = tree_create ();
+        b->out_symbols = sx_end_of_list;
+        b->out_count   = 0;
+        b->in_symbols  = sx_end_of_list;
+        b->in_count    = 0;
+
+        /* the lists keep the symbols alive; on the way out, that also makes
+           sure that no other symbol can end up at the same address */
+        b->out_root    = gc_register_root (&(b->out_symbols));
+        b->in_root     = gc_register_root (&(b->in_symbols));
+
+        io->binary = b;
+    }
+
+    return b;
+}
+
+void sx_release_binary (struct sexpr_io *io)
+{
+    struct sexpr_binary *b = io->binary;
+
+    if (b != (struct sexpr_binary *)0)
+    {
+        gc_unregister_root (b->out_root);
+        gc_unregister_root (b->in_root);
+        tree_destroy (b->out_index);
+        free_mem (sizeof (struct sexpr_binary), b);
+
+        io->binary = (struct sexpr_binary *)0;
+    }
+}
+
+void sx_offer_binary (struct sexpr_io *io)
+{
+    if (io->out != (struct io *)0)
+    {
+        (void)io_write (io->out, SX_BINARY_OFFER, sizeof (SX_BINARY_OFFER) - 1);
+        io->flags |= SX_IO_BINARY_OFFERED;
+    }
+}
+
+char sx_binary_negotiated (struct sexpr_io *io)
+{
+    return ((io->flags & SX_IO_BINARY) == SX_IO_BINARY) ? (char)1 : (char)0;
+}
+
+/* --- writing -------------------------------------------------------------- */
+
+static void sxb_tag (struct sexpr_string_builder *f, enum sx_binary_tag t)
+{
+    char c = (char)t;
+
+    sx_builder_append_l (f, &c, 1);
+}
+
+static void sxb_varint (struct sexpr_string_builder *f, int_pointer u)
+{
+    char t[((sizeof (int_pointer) * 8) + 6) / 7];
+    unsigned int n = 0;
+
+    while (u > 0x7f)
+    {
+        t[n] = (char)((u & 0x7f) | 0x80);
+        u >>= 7;
+        n++;
+    }
+
+    t[n] = (char)u;
+
+    sx_builder_append_l (f, t, n + 1);
+}
+
+static void sxb_signed (struct sexpr_string_builder *f, int_pointer_s i)
+{
+    /* zigzag, so that small negative numbers stay short as well */
+    sxb_varint (f, (i < 0) ? ((((int_pointer)(-(i + 1))) << 1) | 1)
+                           : (((int_pointer)i) << 1));
+}
+
+static void sxb_characters
+        (struct sexpr_string_builder *f, enum sx_binary_tag t, sexpr sx)
+{
+    struct sexpr_string_or_symbol *s =
+        (struct sexpr_string_or_symbol *)sx_pointer (sx);
+
+    sxb_tag (f, t);
+    sxb_varint (f, s->length);
+    sx_builder_append_l (f, s->character_data, s->length);
+}
+
+static void sxb_write_symbol
+        (struct sexpr_io *io, struct sexpr_string_builder *f, sexpr sx)
+{
+    struct sexpr_binary *b = sx_get_binary (io);
+    struct tree_node *n = tree_get_node (b->out_index, (int_pointer)sx);
+
+    if (n != (struct tree_node *)0)
+    {
+        sxb_tag (f, sxb_symbol_reference);
+        sxb_varint (f, (int_pointer)node_get_value (n) - 1);
+    }
+    else if (b->out_count < SX_BINARY_SYMBOLS)
+    {
+        b->out_count++;
+        tree_add_node_value
+            (b->out_index, (int_pointer)sx, (void *)(int_pointer)b->out_count);
+        b->out_symbols = cons (sx, b->out_symbols);
+
+        sxb_characters (f, sxb_symbol_define, sx);
+    }
+    else
+    {
+        sxb_characters (f, sxb_symbol, sx);
+    }
+}
+
+static void sxb_encode
+        (struct sexpr_io *io, struct sexpr_string_builder *f, sexpr sx)
+{
+    if (consp (sx))
+    {
+        int_pointer count = 0;
+        sexpr c;
+
+        for (c = sx; consp (c); c = cdr (c))
+        {
+            count++;
+        }
+
+        sxb_tag (f, sxb_list);
+        sxb_varint (f, count);
+
+        for (c = sx; consp (c); c = cdr (c))
+        {
+            sxb_encode (io, f, car (c));
+        }
+
+        sxb_encode (io, f, c);
+    }
+    else if (symbolp (sx))
+    {
+        sxb_write_symbol (io, f, sx);
+    }
+    else if (stringp (sx))
+    {
+        sxb_characters (f, sxb_string, sx);
+    }
+    else if (integerp (sx))
+    {
+        int_pointer_s i = sx_integer (sx);
+
+        if ((i >= 0) && (i < 0x80))
+        {
+            sxb_tag (f, (enum sx_binary_tag)(sxb_small_integer | i));
+        }
+        else
+        {
+            sxb_tag (f, sxb_integer);
+            sxb_signed (f, i);
+        }
+    }
+    else if (rationalp (sx))
+    {
+        sxb_tag (f, sxb_rational);
+        sxb_signed (f, (int_pointer_s)sx_numerator (sx));
+        sxb_signed (f, (int_pointer_s)sx_denominator (sx));
+    }
+    else if (eolp (sx) || emptyp (sx))
+    {
+        sxb_tag (f, sxb_end_of_list);
+    }
+    else if (truep (sx))
+    {
+        sxb_tag (f, sxb_true);
+    }
+    else if (falsep (sx))
+    {
+        sxb_tag (f, sxb_false);
+    }
+    else if (eofp (sx))
+    {
+        sxb_tag (f, sxb_end_of_file);
+    }
+    else if (nexp (sx))
+    {
+        sxb_tag (f, sxb_nonexistent);
+    }
+    else if (nanp (sx))
+    {
+        sxb_tag (f, sxb_not_a_number);
+    }
+    else if (pinfp (sx))
+    {
+        sxb_tag (f, sxb_positive_infinity);
+    }
+    else if (ninfp (sx))
+    {
+        sxb_tag (f, sxb_negative_infinity);
+    }
+    else if (dotp (sx))
+    {
+        sxb_tag (f, sxb_dot);
+    }
+    else if (quotep (sx))
+    {
+        sxb_tag (f, sxb_quote);
+    }
+    else if (qqp (sx))
+    {
+        sxb_tag (f, sxb_quasiquote);
+    }
+    else if (unquotep (sx))
+    {
+        sxb_tag (f, sxb_unquote);
+    }
+    else if (splicep (sx))
+    {
+        sxb_tag (f, sxb_splice);
+    }
+    else if (customp (sx))
+    {
+        int type = sx_type (sx);
+        struct sexpr_type_descriptor *d = sx_get_descriptor (type);
+
+        if ((d != (struct sexpr_type_descriptor *)0) &&
+             (d->serialise != (void *)0))
+        {
+            sxb_encode (io, f, cons (make_special (type), d->serialise (sx)));
+        }
+        else
+        {
+            sxb_tag (f, sxb_nil);
+        }
+    }
+    else if (specialp (sx))
+    {
+        sxb_tag (f, sxb_special);
+        sxb_varint (f, (int_pointer)sx_integer (sx));
+    }
+    else
+    {
+        sxb_tag (f, sxb_nil);
+    }
+}
+
+void sx_write_binary (struct sexpr_io *io, sexpr sx)
+{
+    struct sexpr_string_builder body, header;
+
+    sx_builder_initialise (&body);
+    sx_builder_initialise (&header);
+
+    sxb_encode (io, &body, sx);
+
+    sxb_tag (&header, (enum sx_binary_tag)SX_BINARY_FRAME);
+    sxb_varint (&header, (int_pointer)body.length);
+
+    (void)io_collect (io->out, header.buffer, header.length);
+    (void)io_write   (io->out, body.buffer, body.length);
+
+    sx_builder_release (&body);
+}
+
+/* --- reading -------------------------------------------------------------- */
+
+static int_pointer sxb_read_varint (struct sx_binary_cursor *c)
+{
+    int_pointer u = 0;
+    unsigned int shift = 0;
+
+    while (c->p < c->end)
+    {
+        unsigned char b = *(c->p);
+
+        c->p++;
+
+        if (shift < (sizeof (int_pointer) * 8))
+        {
+            u |= ((int_pointer)(b & 0x7f)) << shift;
+        }
+
+        if ((b & 0x80) == 0)
+        {
+            return u;
+        }
+
+        shift += 7;
+    }
+
+    c->broken = (char)1;
+
+    return 0;
+}
+
+static int_pointer_s sxb_read_signed (struct sx_binary_cursor *c)
+{
+    int_pointer u = sxb_read_varint (c);
+
+    return (u & 1) ? -((int_pointer_s)(u >> 1)) - 1 : (int_pointer_s)(u >> 1);
+}
+
+static sexpr sxb_read_characters
+        (struct sx_binary_cursor *c, enum sx_binary_tag t)
+{
+    int_pointer length = sxb_read_varint (c);
+    const char *s = (const char *)c->p;
+
+    if (c->broken || (length > (int_pointer)(c->end - c->p)))
+    {
+        c->broken = (char)1;
+        return sx_nonexistent;
+    }
+
+    c->p += length;
+
+    return (t == sxb_string) ? make_string_l (s, (unsigned int)length)
+                             : make_symbol_l (s, (unsigned int)length);
+}
+
+static sexpr sxb_decode (struct sexpr_io *io, struct sx_binary_cursor *c)
+{
+    unsigned char t;
+
+    if (c->p >= c->end)
+    {
+        c->broken = (char)1;
+        return sx_nonexistent;
+    }
+
+    t = *(c->p);
+    c->p++;
+
+    if (t & sxb_small_integer)
+    {
+        return make_integer (t & 0x7f);
+    }
+
+    switch ((enum sx_binary_tag)t)
+    {
+        case sxb_end_of_list:       return sx_end_of_list;
+        case sxb_true:              return sx_true;
+        case sxb_false:             return sx_false;
+        case sxb_nil:               return sx_nil;
+        case sxb_end_of_file:       return sx_end_of_file;
+        case sxb_nonexistent:       return sx_nonexistent;
+        case sxb_not_a_number:      return sx_not_a_number;
+        case sxb_positive_infinity: return sx_positive_infinity;
+        case sxb_negative_infinity: return sx_negative_infinity;
+        case sxb_dot:               return sx_dot;
+        case sxb_quote:             return sx_quote;
+        case sxb_quasiquote:        return sx_quasiquote;
+        case sxb_unquote:           return sx_unquote;
+        case sxb_splice:            return sx_splice;
+
+        case sxb_integer:
+            return make_integer (sxb_read_signed (c));
+
+        case sxb_rational:
+        {
+            int_pointer_s n = sxb_read_signed (c), d = sxb_read_signed (c);
+
+            if (d == 0)
+            {
+                c->broken = (char)1;
+                return sx_nonexistent;
+            }
+
+            return make_rational (n, d);
+        }
+
+        case sxb_string:
+        case sxb_symbol:
+            return sxb_read_characters (c, (enum sx_binary_tag)t);
+
+        case sxb_symbol_define:
+        {
+            struct sexpr_binary *b = sx_get_binary (io);
+            sexpr sx = sxb_read_characters (c, sxb_symbol);
+
+            if (c->broken || (b->in_count >= SX_BINARY_SYMBOLS))
+            {
+                c->broken = (char)1;
+                return sx_nonexistent;
+            }
+
+            b->in[b->in_count] = sx;
+            b->in_count++;
+            b->in_symbols = cons (sx, b->in_symbols);
+
+            return sx;
+        }
+
+        case sxb_symbol_reference:
+        {
+            struct sexpr_binary *b = sx_get_binary (io);
+            int_pointer i = sxb_read_varint (c);
+
+            if (i >= b->in_count)
+            {
+                c->broken = (char)1;
+                return sx_nonexistent;
+            }
+
+            return b->in[i];
+        }
+
+        case sxb_special:
+            return make_special (sxb_read_varint (c));
+
+        case sxb_list:
+        {
+            int_pointer count = sxb_read_varint (c);
+            struct sexpr_list_builder list;
+            sexpr tail;
+
+            /* every element takes at least one byte */
+            if ((count > (int_pointer)(c->end - c->p)) ||
+                (c->depth >= SX_BINARY_DEPTH))
+            {
+                c->broken = (char)1;
+                return sx_nonexistent;
+            }
+
+            c->depth++;
+
+            sx_list_builder_initialise (&list);
+
+            for (; (count > 0) && !(c->broken); count--)
+            {
+                sx_list_builder_append (&list, sxb_decode (io, c));
+            }
+
+            tail = sxb_decode (io, c);
+
+            c->depth--;
+
+            if (c->broken)
+            {
+                sx_list_builder_release (&list);
+                return sx_nonexistent;
+            }
+
+            return sx_unserialise (sx_list_builder_finish (&list, tail));
+        }
+
+        default:
+            c->broken = (char)1;
+            return sx_nonexistent;
+    }
+}
+
+sexpr sx_read_binary
+        (struct sexpr_io *io, unsigned int *i, const char *buf,
+         unsigned int length)
+{
+    struct sx_binary_cursor c =
+        { (const unsigned char *)buf + *i + 1,
+          (const unsigned char *)buf + length, (char)0, 0 };
+    int_pointer size = sxb_read_varint (&c);
+    sexpr rv;
+
+    if (c.broken || (size > (int_pointer)(c.end - c.p)))
+    {
+        /* not all of it is here yet */
+        return sx_nonexistent;
+    }
+
+    c.end = c.p + size;
+
+    rv = sxb_decode (io, &c);
+
+    *i = (unsigned int)(c.end - (const unsigned char *)buf);
+
+    return ((c.broken) || (c.p != c.end)) ? sx_nonexistent : rv;
+}
@@ -0,0 +1,70 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+
+#include <curie/sexpr.h>
+#include <curie/sexpr-internal.h>
+#include <curie/memory.h>
+#include <curie/io-system.h>
+
+/* without a portable way to map files, the image is simply read into regular
+   memory; that's never at the right address, but it's always writable. */
+
+void *a_map_image (const char *path, void *address, unsigned long length)
+{
+    unsigned long have = 0;
+    char *rv;
+    int fd, r;
+
+    if ((fd = a_open_read (path)) < 0)
+    {
+        return (void *)0;
+    }
+
+    rv = get_mem (length);
+
+    while ((have < length) &&
+           ((r = a_read (fd, rv + have, (unsigned int)(length - have))) > 0))
+    {
+        have += r;
+    }
+
+    (void)a_close (fd);
+
+    if (have < length)
+    {
+        free_mem (length, rv);
+        return (void *)0;
+    }
+
+    return rv;
+}
+
+void a_unmap_image (void *image, unsigned long length)
+{
+    free_mem (length, image);
+}
@@ -0,0 +1,711 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+
+#include <curie/sexpr.h>
+#include <curie/sexpr-internal.h>
+#include <curie/internal-constants.h>
+#include <curie/memory.h>
+#include <curie/io.h>
+#include <curie/io-system.h>
+#include <curie/tree.h>
+#include <curie/hash.h>
+
+/* an image is a header, followed by the objects in their usual in-memory
+   layout and an open addressing table per type, which the constructors use
+   to find the image's objects by their hashes. all pointers in the image are
+   as they'd be with the image mapped at its base address. */
+
+#define SX_IMAGE_VERSION 2
+#define SX_IMAGE_FORMAT\
+    (((int_pointer)SX_IMAGE_VERSION << 8) | sizeof (int_pointer))
+
+static const char sx_image_magic[8] = "curie-i";
+
+enum sx_image_index
+{
+    sxi_cons     = 0,
+    sxi_string   = 1,
+    sxi_symbol   = 2,
+    sxi_rational = 3,
+    sxi_count    = 4
+};
+
+struct sx_image_table
+{
+    int_pointer offset;
+    int_pointer mask;
+};
+
+struct sx_image_header
+{
+    char        magic[8];
+    int_pointer format;
+    int_pointer base;
+    int_pointer length;
+    int_pointer objects;
+    int_pointer objects_end;
+    sexpr       roots;
+    struct sx_image_table index[sxi_count];
+};
+
+#define sx_image_align(n)\
+    (((n) + sizeof (int_pointer) - 1) & ~(int_pointer)(sizeof (int_pointer) - 1))
+
+#define sx_image_table(h,i)\
+    ((sexpr *)(((char *)(h)) + (h)->index[(i)].offset))
+
+static struct sx_image_header *sx_image[SX_MAX_IMAGES];
+unsigned int sx_images = 0;
+
+static unsigned long sx_image_object_size (sexpr sx)
+{
+    if (consp (sx))
+    {
+        return sx_image_align (sizeof (struct sexpr_cons));
+    }
+    else if (rationalp (sx))
+    {
+        return sx_image_align (sizeof (struct sexpr_rational));
+    }
+    else
+    {
+        struct sexpr_string_or_symbol *s
+            = (struct sexpr_string_or_symbol *)sx_pointer (sx);
+
+        return sx_image_align
+            (sizeof (struct sexpr_string_or_symbol) + s->length + 1);
+    }
+}
+
+static enum sx_image_index sx_image_kind (sexpr sx)
+{
+    return consp (sx)   ? sxi_cons
+         : stringp (sx) ? sxi_string
+         : symbolp (sx) ? sxi_symbol
+         :                sxi_rational;
+}
+
+static int_pointer sx_image_cons_hash (sexpr sx_car, sexpr sx_cdr)
+{
+    sexpr t[2];
+
+    t[0] = sx_car;
+    t[1] = sx_cdr;
+
+    return hash_murmur2_pt (t, sizeof(t), 0);
+}
+
+static int_pointer sx_image_rational_hash (int_pointer p, int_pointer_s q)
+{
+    int_pointer t[2];
+
+    t[0] = p;
+    t[1] = q;
+
+    return hash_murmur2_pt (t, sizeof(t), 0);
+}
+
+static void sx_image_insert (sexpr *table, int_pointer mask, int_pointer hash,
+                             sexpr sx)
+{
+    int_pointer i;
+
+    for (i = hash & mask; table[i] != (sexpr)0; i = (i + 1) & mask);
+
+    table[i] = sx;
+}
+
+/* saving */
+
+struct sx_image_writer
+{
+    struct tree *offsets;
+    struct sexpr_list_builder objects;
+    unsigned long length;
+    unsigned long count[sxi_count];
+    char broken;
+};
+
+static void sx_image_collect (struct sx_image_writer *w, sexpr sx)
+{
+    /* conses are followed along the cdr iteratively, like in gc_tag() */
+    while (pointerp (sx) &&
+           (tree_get_node (w->offsets, (int_pointer)sx)
+                == (struct tree_node *)0))
+    {
+        if (!consp (sx) && !stringp (sx) && !symbolp (sx) && !rationalp (sx))
+        {
+            w->broken = (char)1;
+            return;
+        }
+
+        tree_add_node_value (w->offsets, (int_pointer)sx, (void *)w->length);
+        sx_list_builder_append (&(w->objects), sx);
+
+        w->length += sx_image_object_size (sx);
+        w->count[sx_image_kind (sx)]++;
+
+        if (!consp (sx))
+        {
+            return;
+        }
+
+        sx_image_collect (w, car (sx));
+
+        sx = cdr (sx);
+    }
+}
+
+static sexpr sx_image_translate
+    (struct sx_image_writer *w, int_pointer base, sexpr sx)
+{
+    if (!pointerp (sx))
+    {
+        return sx;
+    }
+
+    return (sexpr)(base + (int_pointer)node_get_value
+                              (tree_get_node (w->offsets, (int_pointer)sx)));
+}
+
+char sx_image_save (const char *path, sexpr roots)
+{
+    struct sx_image_writer w;
+    struct sx_image_header *h;
+    struct sx_image_table index[sxi_count];
+    struct io *out;
+    int_pointer base = SX_IMAGE_BASE, length, i, objects;
+    char *image;
+    sexpr *table;
+    unsigned int k;
+    unsigned long j;
+    enum io_result r;
+
+    w.offsets = tree_create ();
+    w.length  = sx_image_align (sizeof (struct sx_image_header));
+    w.broken  = (char)0;
+
+    for (k = 0; k < sxi_count; k++)
+    {
+        w.count[k] = 0;
+    }
+
+    sx_list_builder_initialise (&(w.objects));
+
+    sx_image_collect (&w, roots);
+
+    if (w.broken)
+    {
+        sx_list_builder_release (&(w.objects));
+        tree_destroy (w.offsets);
+        return (char)0;
+    }
+
+    objects = w.length;
+    length  = w.length;
+
+    for (k = 0; k < sxi_count; k++)
+    {
+        /* keep the load factor of the tables below one half */
+        for (i = 2; i < (int_pointer)(w.count[k] * 2); i *= 2);
+
+        index[k].offset = length;
+        index[k].mask   = i - 1;
+
+        length += i * sizeof (sexpr);
+    }
+
+    image = get_mem (length);
+    h     = (struct sx_image_header *)image;
+
+    for (k = 0; k < sxi_count; k++)
+    {
+        h->index[k] = index[k];
+    }
+
+    for (i = 0; i < 8; i++)
+    {
+        h->magic[i] = sx_image_magic[i];
+    }
+
+    h->format      = SX_IMAGE_FORMAT;
+    h->base        = base;
+    h->length      = length;
+    h->objects     = sx_image_align (sizeof (struct sx_image_header));
+    h->objects_end = objects;
+    h->roots       = sx_image_translate (&w, base, roots);
+
+    for (i = objects; i < length; i++)
+    {
+        image[i] = (char)0;
+    }
+
+    for (j = 0, i = h->objects; j < w.objects.length; j++)
+    {
+        sexpr sx = w.objects.elements[j];
+        enum sx_image_index kind = sx_image_kind (sx);
+        int_pointer hash;
+
+        table = sx_image_table (h, kind);
+
+        if (kind == sxi_cons)
+        {
+            struct sexpr_cons *c = (struct sexpr_cons *)(image + i);
+
+            c->type = sxt_cons;
+            c->car  = sx_image_translate (&w, base, car (sx));
+            c->cdr  = sx_image_translate (&w, base, cdr (sx));
+
+            hash = sx_image_cons_hash (c->car, c->cdr);
+        }
+        else if (kind == sxi_rational)
+        {
+            struct sexpr_rational *s = (struct sexpr_rational *)sx_pointer (sx),
+                                  *c = (struct sexpr_rational *)(image + i);
+
+            c->type        = sxt_rational;
+            c->numerator   = s->numerator;
+            c->denominator = s->denominator;
+
+            hash = sx_image_rational_hash (s->numerator, s->denominator);
+        }
+        else
+        {
+            struct sexpr_string_or_symbol
+                *s = (struct sexpr_string_or_symbol *)sx_pointer (sx),
+                *c = (struct sexpr_string_or_symbol *)(image + i);
+            unsigned int l;
+
+            hash = sx_string_or_symbol_hash (s);
+
+            c->type   = s->type;
+            c->length = s->length;
+            c->hash   = hash;
+
+            for (l = 0; l <= s->length; l++)
+            {
+                c->character_data[l] = s->character_data[l];
+            }
+        }
+
+        sx_image_insert (table, h->index[kind].mask, hash, (sexpr)(base + i));
+
+        i += sx_image_object_size (sx);
+    }
+
+    sx_list_builder_release (&(w.objects));
+    tree_destroy (w.offsets);
+
+    out = io_open_create (path, 0644);
+
+    r = (out->fd >= 0) ? io_collect (out, image, (unsigned int)length)
+                       : io_unrecoverable_error;
+
+    io_close (out);
+
+    free_mem (length, image);
+
+    return (r == io_unrecoverable_error) ? (char)0 : (char)1;
+}
+
+/* loading */
+
+static char sx_image_validp (struct sx_image_header *h)
+{
+    unsigned int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        if (h->magic[i] != sx_image_magic[i])
+        {
+            return (char)0;
+        }
+    }
+
+    if ((h->format != SX_IMAGE_FORMAT) ||
+        (h->objects < (int_pointer)sizeof (struct sx_image_header)) ||
+        (h->objects > h->objects_end) || (h->objects_end > h->length) ||
+        (h->objects != sx_image_align (h->objects)) ||
+        (h->objects_end != sx_image_align (h->objects_end)))
+    {
+        return (char)0;
+    }
+
+    /* the masks need to be one less than a power of two, and the tables have
+       to fit without the size calculation wrapping around */
+    for (i = 0; i < sxi_count; i++)
+    {
+        int_pointer offset = h->index[i].offset, mask = h->index[i].mask;
+
+        if ((offset < h->objects_end) || (offset > h->length) ||
+            (offset != sx_image_align (offset)) ||
+            ((mask & (mask + 1)) != 0) ||
+            (mask >= (h->length - offset) / sizeof (sexpr)))
+        {
+            return (char)0;
+        }
+    }
+
+    return (char)1;
+}
+
+static unsigned long sx_image_object_at
+    (struct sx_image_header *h, int_pointer i)
+{
+    char *image = (char *)h;
+    unsigned long room = h->objects_end - i, size;
+    struct sexpr_string_or_symbol *s;
+
+    switch (((struct sexpr_cons *)(image + i))->type)
+    {
+        case sxt_cons:
+            size = sx_image_align (sizeof (struct sexpr_cons));
+            break;
+        case sxt_rational:
+            size = sx_image_align (sizeof (struct sexpr_rational));
+            break;
+        case sxt_string:
+        case sxt_symbol:
+            s = (struct sexpr_string_or_symbol *)(image + i);
+
+            if ((room < sizeof (struct sexpr_string_or_symbol)) ||
+                (s->length >= room))
+            {
+                return 0;
+            }
+
+            size = sx_image_align
+                (sizeof (struct sexpr_string_or_symbol) + s->length + 1);
+            break;
+        default:
+            return 0;
+    }
+
+    return (size <= room) ? size : 0;
+}
+
+#define sx_image_slot(h,o) (((o) - (h)->objects) / sizeof (int_pointer))
+
+/* sx is a pointer into the image as saved, i.e. relative to h->base; it has
+   to point at the start of one of the objects that were found while walking
+   the image, and if kind isn't sxi_count it has to be of that kind */
+static char sx_image_pointer_validp
+    (struct sx_image_header *h, const unsigned char *starts, sexpr sx,
+     enum sx_image_index kind)
+{
+    int_pointer o = (int_pointer)sx - h->base, n;
+
+    if (!pointerp (sx))
+    {
+        return (char)1;
+    }
+
+    if (((int_pointer)sx < h->base) || (o < h->objects) ||
+        (o >= h->objects_end) || (o != sx_image_align (o)))
+    {
+        return (char)0;
+    }
+
+    n = sx_image_slot (h, o);
+
+    if (!(starts[n / 8] & (1 << (n % 8))))
+    {
+        return (char)0;
+    }
+
+    return (kind == sxi_count) ||
+           (sx_image_kind ((sexpr)(((char *)h) + o)) == kind);
+}
+
+/* the header only says where things are; this makes sure that the objects
+   and everything that points at them stays inside the image, and that every
+   table has an empty slot for the lookups to stop at. */
+static char sx_image_contentsp (struct sx_image_header *h)
+{
+    char *image = (char *)h;
+    unsigned long bytes = sx_image_slot (h, h->objects_end) / 8 + 1, size;
+    unsigned char *starts = get_mem (bytes);
+    char rv = (char)0;
+    int_pointer i, n;
+    sexpr *table;
+    unsigned int k;
+
+    for (i = 0; i < (int_pointer)bytes; i++)
+    {
+        starts[i] = 0;
+    }
+
+    for (i = h->objects; i < h->objects_end; i += size)
+    {
+        if ((size = sx_image_object_at (h, i)) == 0)
+        {
+            goto done;
+        }
+
+        n = sx_image_slot (h, i);
+        starts[n / 8] |= (unsigned char)(1 << (n % 8));
+    }
+
+    for (i = h->objects; i < h->objects_end;
+         i += sx_image_object_at (h, i))
+    {
+        struct sexpr_cons *c = (struct sexpr_cons *)(image + i);
+
+        if ((c->type == sxt_cons) &&
+            (!sx_image_pointer_validp (h, starts, c->car, sxi_count) ||
+             !sx_image_pointer_validp (h, starts, c->cdr, sxi_count)))
+        {
+            goto done;
+        }
+    }
+
+    for (k = 0; k < sxi_count; k++)
+    {
+        char emptyp = (char)0;
+
+        table = sx_image_table (h, k);
+
+        for (i = 0; i <= h->index[k].mask; i++)
+        {
+            if (table[i] == (sexpr)0)
+            {
+                emptyp = (char)1;
+            }
+            else if (!pointerp (table[i]) ||
+                     !sx_image_pointer_validp (h, starts, table[i], k))
+            {
+                goto done;
+            }
+        }
+
+        if (!emptyp)
+        {
+            goto done;
+        }
+    }
+
+    rv = sx_image_pointer_validp (h, starts, h->roots, sxi_count);
+
+  done:
+    free_mem (bytes, starts);
+
+    return rv;
+}
+
+#define sx_image_relocate(sx,delta)\
+    if (pointerp (sx)) (sx) = (sexpr)((int_pointer)(sx) + (delta))
+
+/* the image didn't end up at its base address, so all the pointers in it are
+   off by the same amount; the conses' hashes depend on what they point to, so
+   their table needs to be redone from scratch. */
+static void sx_image_relocate_all (struct sx_image_header *h)
+{
+    char *image = (char *)h;
+    int_pointer delta = (int_pointer)h - h->base, i;
+    sexpr *table;
+    unsigned int k;
+
+    sx_image_relocate (h->roots, delta);
+
+    for (k = 0; k < sxi_count; k++)
+    {
+        table = sx_image_table (h, k);
+
+        for (i = 0; i <= h->index[k].mask; i++)
+        {
+            table[i] = (k == sxi_cons) ? (sexpr)0
+                     : (table[i] == (sexpr)0) ? (sexpr)0
+                     : (sexpr)((int_pointer)table[i] + delta);
+        }
+    }
+
+    table = sx_image_table (h, sxi_cons);
+
+    for (i = h->objects; i < h->objects_end;)
+    {
+        sexpr sx = (sexpr)(image + i);
+
+        if (consp (sx))
+        {
+            struct sexpr_cons *c = (struct sexpr_cons *)(image + i);
+
+            sx_image_relocate (c->car, delta);
+            sx_image_relocate (c->cdr, delta);
+
+            sx_image_insert (table, h->index[sxi_cons].mask,
+                             sx_image_cons_hash (c->car, c->cdr), sx);
+        }
+
+        i += sx_image_object_size (sx);
+    }
+
+    h->base = (int_pointer)h;
+}
+
+sexpr sx_image_load (const char *path)
+{
+    struct sx_image_header header, *h;
+    unsigned int have = 0;
+    int fd, r;
+
+    if (sx_images >= SX_MAX_IMAGES)
+    {
+        return sx_nonexistent;
+    }
+
+    if ((fd = a_open_read (path)) < 0)
+    {
+        return sx_nonexistent;
+    }
+
+    while ((have < sizeof (header)) &&
+           ((r = a_read (fd, ((char *)&header) + have,
+                         sizeof (header) - have)) > 0))
+    {
+        have += r;
+    }
+
+    (void)a_close (fd);
+
+    if ((have < sizeof (header)) || !sx_image_validp (&header))
+    {
+        return sx_nonexistent;
+    }
+
+    h = a_map_image (path, (void *)header.base, header.length);
+
+    if (h == (struct sx_image_header *)0)
+    {
+        return sx_nonexistent;
+    }
+
+    if (!sx_image_validp (h) || (h->length != header.length) ||
+        !sx_image_contentsp (h))
+    {
+        a_unmap_image (h, header.length);
+        return sx_nonexistent;
+    }
+
+    if ((int_pointer)h != h->base)
+    {
+        sx_image_relocate_all (h);
+    }
+
+    sx_image[sx_images] = h;
+    sx_images++;
+
+    return h->roots;
+}
+
+/* lookups */
+
+sexpr sx_image_cons (sexpr sx_car, sexpr sx_cdr, int_pointer hash)
+{
+    unsigned int k;
+
+    for (k = 0; k < sx_images; k++)
+    {
+        struct sx_image_header *h = sx_image[k];
+        sexpr *table = sx_image_table (h, sxi_cons);
+        int_pointer mask = h->index[sxi_cons].mask, i;
+
+        for (i = hash & mask; table[i] != (sexpr)0; i = (i + 1) & mask)
+        {
+            struct sexpr_cons *c = (struct sexpr_cons *)sx_pointer (table[i]);
+
+            if ((c->car == sx_car) && (c->cdr == sx_cdr))
+            {
+                return table[i];
+            }
+        }
+    }
+
+    return sx_nonexistent;
+}
+
+sexpr sx_image_string_or_symbol
+    (enum sx_type type, const char *string, unsigned long length,
+     int_pointer hash)
+{
+    enum sx_image_index index = (type == sxt_symbol) ? sxi_symbol : sxi_string;
+    unsigned int k;
+
+    for (k = 0; k < sx_images; k++)
+    {
+        struct sx_image_header *h = sx_image[k];
+        sexpr *table = sx_image_table (h, index);
+        int_pointer mask = h->index[index].mask, i;
+
+        for (i = hash & mask; table[i] != (sexpr)0; i = (i + 1) & mask)
+        {
+            struct sexpr_string_or_symbol *s
+                = (struct sexpr_string_or_symbol *)sx_pointer (table[i]);
+            unsigned long l;
+
+            if ((s->hash != hash) || (s->length != length))
+            {
+                continue;
+            }
+
+            for (l = 0; (l < length) && (s->character_data[l] == string[l]);
+                 l++);
+
+            if (l == length)
+            {
+                return table[i];
+            }
+        }
+    }
+
+    return sx_nonexistent;
+}
+
+sexpr sx_image_rational (int_pointer p, int_pointer_s q, int_pointer hash)
+{
+    unsigned int k;
+
+    for (k = 0; k < sx_images; k++)
+    {
+        struct sx_image_header *h = sx_image[k];
+        sexpr *table = sx_image_table (h, sxi_rational);
+        int_pointer mask = h->index[sxi_rational].mask, i;
+
+        for (i = hash & mask; table[i] != (sexpr)0; i = (i + 1) & mask)
+        {
+            struct sexpr_rational *r
+                = (struct sexpr_rational *)sx_pointer (table[i]);
+
+            if ((r->numerator == p) && (r->denominator == q))
+            {
+                return table[i];
+            }
+        }
+    }
+
+    return sx_nonexistent;
+}
@@ -41,10 +41,17 @@ sexpr equalp (sexpr a, sexpr b)
         struct sexpr_string_or_symbol
                 *sa = (struct sexpr_string_or_symbol *)sx_pointer(a),
                 *sb = (struct sexpr_string_or_symbol *)sx_pointer(b);
-        unsigned long i;
 
-        return (str_hash(sa->character_data, &i) ==
-                str_hash(sb->character_data, &i))
+        return ((sa->length == sb->length) &&
+                (sx_string_or_symbol_hash (sa) ==
+                 sx_string_or_symbol_hash (sb)))
+                ? sx_true : sx_false;
+    }
+    else if (rationalp(a) && rationalp(b))
+    {
+        /* heap images may have their own copies */
+        return ((sx_numerator(a) == sx_numerator(b)) &&
+                (sx_denominator(a) == sx_denominator(b)))
                 ? sx_true : sx_false;
     }
     else if (consp(a) && consp(b))
@@ -72,94 +79,278 @@ sexpr equalp (sexpr a, sexpr b)
     return sx_false;
 }
 
-static sexpr sx_join_work (sexpr a, sexpr b, sexpr c, char *g)
+void sx_builder_initialise (struct sexpr_string_builder *b)
 {
-    const char *s;
-    int i = 0, j = 0;
+    b->buffer = b->stack;
+    b->length = 0;
+    b->size   = STACK_BUFFER_SIZE;
+}
 
-    s = stringp (a) ? sx_string (a) : sx_symbol(a);
-    for (j = 0; s[j]; j++) {
-        g[i] = s[j];
-        i++;
+static void sx_builder_reserve (struct sexpr_string_builder *b,
+                                unsigned long length)
+{
+    unsigned long size = b->size, i;
+    char *n;
+
+    if ((b->length + length) < size)
+    {
+        return;
     }
-    if (stringp (b) || symbolp(b))
+
+    do
     {
-        s = stringp (b) ? sx_string (b) : sx_symbol(b);
-        for (j = 0; s[j]; j++) {
-            g[i] = s[j];
-            i++;
+        size *= 2;
+    }
+    while ((b->length + length) >= size);
+
+    if (b->buffer == b->stack)
+    {
+        n = get_mem (size);
+
+        for (i = 0; i < b->length; i++)
+        {
+            n[i] = b->stack[i];
         }
     }
-    if (stringp (c) || symbolp(c))
+    else
     {
-        s = stringp (c) ? sx_string (c) : sx_symbol(c);
-        for (j = 0; s[j]; j++) {
-            g[i] = s[j];
-            i++;
+        n = resize_mem (b->size, b->buffer, size);
+    }
+
+    b->buffer = n;
+    b->size   = size;
+}
+
+void sx_builder_append_l
+        (struct sexpr_string_builder *b, const char *s, unsigned long length)
+{
+    unsigned long i;
+    char *t;
+
+    sx_builder_reserve (b, length);
+
+    t = b->buffer + b->length;
+
+    for (i = 0; i < length; i++)
+    {
+        t[i] = s[i];
+    }
+
+    b->length += length;
+}
+
+void sx_builder_append_c (struct sexpr_string_builder *b, const char *s)
+{
+    unsigned long i = b->length;
+
+    for (; *s != (char)0; s++)
+    {
+        if (i >= (b->size - 1))
+        {
+            b->length = i;
+            sx_builder_reserve (b, b->size);
         }
+
+        b->buffer[i] = *s;
+        i++;
     }
-    g[i] = 0;
 
-    return stringp(a) ? make_string (g) : make_symbol (g);
+    b->length = i;
 }
 
-sexpr sx_join (sexpr a, sexpr b, sexpr c)
+static void sx_builder_append_integer
+        (struct sexpr_string_builder *b, int_pointer_s i)
 {
-    unsigned int j = 0, k = 0;
-    const char *s;
+    /* negated after the conversion, which is also fine for the most negative
+       value */
+    int_pointer u = (i < 0) ? ((int_pointer)0 - (int_pointer)i)
+                            : (int_pointer)i;
+    char *c;
+    unsigned int n = 1;
+    int_pointer t;
 
-    if (integerp (a))
+    for (t = u / 10; t != 0; t /= 10)
     {
-        a = sx_to_string (a);
+        n++;
     }
-    if (integerp (b))
+
+    if (i < 0)
     {
-        b = sx_to_string (b);
+        n++;
     }
-    if (integerp (c))
+
+    sx_builder_reserve (b, n);
+
+    c = b->buffer + b->length + n;
+    b->length += n;
+
+    do
     {
-        c = sx_to_string (c);
+        c--;
+        *c = '0' + (char)(u % 10);
+        u /= 10;
     }
+    while (u != 0);
 
-    if (stringp (a) || symbolp(a))
+    if (i < 0)
     {
-        s = stringp (a) ? sx_string (a) : sx_symbol(a);
-        for (j = 0; s[j]; j++) k++;
+        c--;
+        *c = '-';
     }
-    else
+}
+
+void sx_builder_append (struct sexpr_string_builder *b, sexpr sx)
+{
+    if (stringp (sx) || symbolp (sx))
+    {
+        struct sexpr_string_or_symbol *s
+                = (struct sexpr_string_or_symbol *)sx_pointer (sx);
+
+        sx_builder_append_l (b, s->character_data, s->length);
+    }
+    else if (integerp (sx))
+    {
+        sx_builder_append_integer (b, sx_integer (sx));
+    }
+}
+
+void sx_builder_release (struct sexpr_string_builder *b)
+{
+    if (b->buffer != b->stack)
+    {
+        free_mem (b->size, b->buffer);
+        b->buffer = b->stack;
+    }
+}
+
+sexpr sx_builder_string (struct sexpr_string_builder *b)
+{
+    sexpr rv;
+
+    b->buffer[b->length] = (char)0;
+    rv = make_string_l (b->buffer, b->length);
+    sx_builder_release (b);
+
+    return rv;
+}
+
+sexpr sx_builder_symbol (struct sexpr_string_builder *b)
+{
+    sexpr rv;
+
+    b->buffer[b->length] = (char)0;
+    rv = make_symbol_l (b->buffer, b->length);
+    sx_builder_release (b);
+
+    return rv;
+}
+
+sexpr sx_join (sexpr a, sexpr b, sexpr c)
+{
+    struct sexpr_string_builder g;
+
+    if (!stringp (a) && !symbolp (a) && !integerp (a))
     {
         return sx_nil;
     }
-    if (stringp (b) || symbolp(b))
+
+    sx_builder_initialise (&g);
+    sx_builder_append (&g, a);
+    sx_builder_append (&g, b);
+    sx_builder_append (&g, c);
+
+    return symbolp (a) ? sx_builder_symbol (&g) : sx_builder_string (&g);
+}
+
+sexpr sx_join_list (sexpr list)
+{
+    struct sexpr_string_builder g;
+    sexpr a;
+
+    if (!consp (list))
     {
-        s = stringp (b) ? sx_string (b) : sx_symbol(b);
-        for (j = 0; s[j]; j++) k++;
+        return sx_nil;
     }
-    if (stringp (c) || symbolp(c))
+
+    a = car (list);
+
+    if (!stringp (a) && !symbolp (a) && !integerp (a))
     {
-        s = stringp (c) ? sx_string (c) : sx_symbol(c);
-        for (j = 0; s[j]; j++) k++;
+        return sx_nil;
     }
 
-    k++;
+    sx_builder_initialise (&g);
 
-    if (k < STACK_BUFFER_SIZE)
+    for (; consp (list); list = cdr (list))
     {
-        char buf[STACK_BUFFER_SIZE];
+        sx_builder_append (&g, car (list));
+    }
 
-        return sx_join_work (a, b, c, buf);
+    return symbolp (a) ? sx_builder_symbol (&g) : sx_builder_string (&g);
+}
+
+void sx_list_builder_initialise (struct sexpr_list_builder *b)
+{
+    b->elements = b->stack;
+    b->length   = 0;
+    b->size     = SX_LIST_BUILDER_SIZE;
+}
+
+void sx_list_builder_append (struct sexpr_list_builder *b, sexpr sx)
+{
+    if (b->length >= b->size)
+    {
+        unsigned long size = b->size * 2, i;
+        sexpr *n;
+
+        if (b->elements == b->stack)
+        {
+            n = get_mem (size * sizeof (sexpr));
+
+            for (i = 0; i < b->length; i++)
+            {
+                n[i] = b->stack[i];
+            }
+        }
+        else
+        {
+            n = resize_mem (b->size * sizeof (sexpr), b->elements,
+                            size * sizeof (sexpr));
+        }
+
+        b->elements = n;
+        b->size     = size;
     }
-    else
+
+    b->elements[b->length] = sx;
+    b->length++;
+}
+
+void sx_list_builder_release (struct sexpr_list_builder *b)
+{
+    if (b->elements != b->stack)
     {
-        char *g = get_mem (k);
-        sexpr rv;
+        free_mem (b->size * sizeof (sexpr), b->elements);
+        b->elements = b->stack;
+        b->size     = SX_LIST_BUILDER_SIZE;
+    }
 
-        rv = sx_join_work (a, b, c, g);
+    b->length = 0;
+}
 
-        free_mem (k, g);
+sexpr sx_list_builder_finish (struct sexpr_list_builder *b, sexpr tail)
+{
+    unsigned long i = b->length;
 
-        return rv;
+    while (i > 0)
+    {
+        i--;
+        tail = cons (b->elements[i], tail);
     }
+
+    sx_list_builder_release (b);
+
+    return tail;
 }
 
 sexpr sx_reverse (sexpr sx)
@@ -36,6 +36,21 @@
 static sexpr sx_read_dispatch (unsigned int *i, char *buf, unsigned int length);
 static unsigned int sx_write_dispatch (struct sexpr_io *io, sexpr sx);
 
+const unsigned char sx_character_classes[256] =
+{
+    [0]    = SX_CLASS_SPACE,
+    ['\t'] = SX_CLASS_SPACE,
+    ['\n'] = SX_CLASS_SPACE | SX_CLASS_NEWLINE,
+    ['\v'] = SX_CLASS_SPACE,
+    ['\r'] = SX_CLASS_SPACE,
+    [' ']  = SX_CLASS_SPACE,
+    [';']  = SX_CLASS_COMMENT,
+    ['(']  = SX_CLASS_PAREN,
+    [')']  = SX_CLASS_PAREN,
+    ['"']  = SX_CLASS_STRING,
+    ['\\'] = SX_CLASS_STRING
+};
+
 struct sexpr_io *sx_open_io(struct io *in, struct io *out)
 {
     static struct memory_pool pool
@@ -44,6 +59,8 @@ struct sexpr_io *sx_open_io(struct io *in, struct io *out)
 
     rv->in = in;
     rv->out = out;
+    rv->flags = 0;
+    rv->binary = (struct sexpr_binary *)0;
 
     if ((in != (struct io *)0) &&
         (in->type != iot_read) &&
@@ -77,6 +94,8 @@ void sx_close_io (struct sexpr_io *io)
         io_close (io->out);
     }
 
+    sx_release_binary (io);
+
     free_pool_mem (io);
 }
 
@@ -113,7 +132,12 @@ static sexpr sx_read_string
     char had_escapes = (char)0;
 
     do {
-        if (buf[j] == '"') {
+        /* skip straight to the next quote or escape */
+        j = sx_scan (buf, j, length, SX_CLASS_STRING);
+
+        if (j >= length) {
+            break;
+        } else if (buf[j] == '"') {
             /* closing ", end of string */
 
             unsigned int k = j - jo;
@@ -240,24 +264,21 @@ static sexpr sx_read_number
                             }
                             else if (rationalp (r))
                             {
-                                struct sexpr_rational *rval =
-                                    (struct sexpr_rational *)r;
-                                int_pointer_s denom = rval->numerator;
+                                int_pointer_s denom = sx_numerator (r),
+                                              rden  = sx_denominator (r);
 
                                 if (number_is_negative == (char)1)
                                 {
                                     denom *= -1;
                                 }
 
-                                if (rval->denominator < 0)
+                                if (rden < 0)
                                 {
                                     return make_rational
-                                        (number * (rval->denominator * -1),
-                                         denom);
+                                        (number * (rden * -1), denom);
                                 }
 
-                                return make_rational
-                                    (number * rval->denominator, denom);
+                                return make_rational (number * rden, denom);
                             }
                         }
                     }
@@ -297,53 +318,38 @@ static sexpr sx_read_number
 static sexpr sx_read_symbol
         (unsigned int *i, char *buf, int unsigned length)
 {
-    unsigned int j = *i, k = 0;
-    char newsymbol [SX_MAX_SYMBOL_LENGTH];
+    unsigned int jo = *i, j, k;
+    int_32 c;
 
-    do {
-        switch (buf[j]) {
-            case '\n':
-            case '\r':
-            case '\t':
-            case '\v':
-            case ' ':
-            case ';': /* beginning a comment will also end the symbol */
-            case 0:
-            case ')': /* this is also a terminating character for a symbol */
-            case '(': /* starting a new cons will also end a symbol */
-                /* end of symbol */
+    /* whitespace, comments and parentheses all end the symbol */
+    j = sx_scan (buf, jo, length, SX_CLASS_DELIMITER);
 
-                *i = j;
-                newsymbol[k] = (char)0;
+    if (j >= length)
+    {
+        return sx_nonexistent;
+    }
 
-                if (utf8_get_character ((int_8*)newsymbol, 0, &j) == k)
-                {
-                    if (j > 127)
-                    {
-                        return make_special (j);
-                    }
-                }
+    *i = j;
+    k  = j - jo;
 
-                /* return the newly created string */
-                return make_symbol (newsymbol);
-            default:
-                if (k < (SX_MAX_SYMBOL_LENGTH - 2)) {
-                    /* make sure we still have enough room, then add the
-                       character */
-                    newsymbol[k] = buf[j];
-                    k++;
-                }
-        }
+    if (k > (SX_MAX_SYMBOL_LENGTH - 2))
+    {
+        k = (SX_MAX_SYMBOL_LENGTH - 2);
+    }
 
-        j++;
-    } while (j < length);
+    /* a lone multi-byte character is a special type marker */
+    if (((unsigned char)buf[jo] >= 0xc0) &&
+        (utf8_get_character ((int_8*)(buf + jo), 0, &c) == k) && (c > 127))
+    {
+        return make_special (c);
+    }
 
-    return sx_nonexistent;
+    /* return the newly created symbol */
+    return make_symbol_l (buf + jo, k);
 }
 
-static sexpr sx_read_cons_finalise (sexpr oreverse)
+sexpr sx_unserialise (sexpr result)
 {
-    sexpr result = sx_reverse (oreverse);
     sexpr reverse = car (result);
 
     if (specialp (reverse))
@@ -367,63 +373,60 @@ static sexpr sx_read_cons_finalise (sexpr oreverse)
     return result;
 }
 
+static sexpr sx_read_cons_finalise (struct sexpr_list_builder *list)
+{
+    sexpr tail = sx_end_of_list;
+
+    /* (a b . c) */
+    if ((list->length >= 2) && dotp (list->elements[(list->length - 2)]))
+    {
+        tail          = list->elements[(list->length - 1)];
+        list->length -= 2;
+    }
+
+    return sx_unserialise (sx_list_builder_finish (list, tail));
+}
+
 static sexpr sx_read_cons
         (unsigned int *i, char *buf, unsigned int length)
 {
-    /* i think the best we can do here, is to construct the list in reverse
-       order using cons(), then once it's done we simply reverse it. */
+    /* collect the elements in order and only cons them together once the
+       closing paren shows up. */
     unsigned int j = *i;
-    sexpr result = sx_end_of_list, next;
+    struct sexpr_list_builder list;
+    sexpr next;
+
+    sx_list_builder_initialise (&list);
 
     do {
-        char comment = (char)0;
-         /* skip all currently-leading whitespace */
-        retry:
-        while (comment == (char)1) {
-            j++;
-            if (j >= length) return sx_nonexistent;
+        /* skip all currently-leading whitespace and comments */
+        j = sx_skip (buf, j, length, SX_CLASS_SPACE);
 
-            if (buf[j] == '\n') {
-                comment = (char)0;
-                break;
-            }
+        while ((j < length) && (buf[j] == ';')) {
+            j = sx_scan (buf, j, length, SX_CLASS_NEWLINE);
+            j = sx_skip (buf, j, length, SX_CLASS_SPACE);
         }
 
-        switch (buf[j]) {
-            case '\n':
-            case '\r':
-            case '\t':
-            case '\v':
-            case ' ':
-            case 0:
-                j++;
-                if (j >= length) return sx_nonexistent;
-                goto retry;
-
-            case ';':
-                comment = (char)1;
-                goto retry;
-
-            default:
-                break;
-        }
+        if (j >= length) break;
 
         switch (buf[j]) {
             case ')':
                 /* end of list */
                 j++;
                 *i = j;
-                return sx_read_cons_finalise (result);
+                return sx_read_cons_finalise (&list);
 
             default:
                 next = sx_read_dispatch (&j, buf, length);
         }
 
-        if (next == sx_nonexistent) return sx_nonexistent;
+        if (next == sx_nonexistent) break;
 
-        result = cons (next, result);
+        sx_list_builder_append (&list, next);
     } while (j < length);
 
+    sx_list_builder_release (&list);
+
     return sx_nonexistent;
 }
 
@@ -524,8 +527,8 @@ sexpr sx_read(struct sexpr_io *io) {
         char *buf;
         unsigned int i, length;
         sexpr result = sx_nonexistent;
-        char comment = (char)0;
 
+        retry:
         do {
             r = io_read (io->in);
             i = io->in->position;
@@ -545,38 +548,35 @@ sexpr sx_read(struct sexpr_io *io) {
 
         /* remove leading whitespace */
         do {
-            if (comment == (char)1) {
-                if (buf[i] == '\n') {
-                    comment = (char)0;
+            i = sx_skip (buf, i, length, SX_CLASS_SPACE);
+
+            if (i >= length) {
+                break;
+            } else if (buf[i] == ';') {
+                i = sx_scan (buf, i, length, SX_CLASS_NEWLINE);
+            } else if (buf[i] == ')') {
+                /* stray closing parentheses are also ignored, yarr; unless
+                   they're followed by a NUL byte, which makes them the
+                   peer's offer to use the binary encoding */
+                if ((i + 1) >= length) {
+                    if ((io->in->status != io_end_of_file) &&
+                        (io->in->status != io_unrecoverable_error)) {
+                        io->in->position = i;
+                        return sx_nonexistent;
+                    }
+                } else if (buf[i + 1] == (char)0) {
+                    io->flags |= SX_IO_BINARY_PEER;
+                    i++;
                 }
                 i++;
-                continue;
-            }
-
-            switch (buf[i]) {
-                case '\n':
-                case '\r':
-                case '\t':
-                case '\v':
-                case ' ':
-                case 0:
-                    /* whitespace characters */
-                case ')': /* stray closing parentheses are also ignored, yarr */
-                    break;
-                case ';':
-                    comment = (char)1;
-                    break;
-                default:
-                    /* update current position, so the whitespace will be removed
-                    next time around. */
-                    io->in->position = i;
-                    goto done_skipping_whitespace;
+            } else {
+                /* update current position, so the whitespace will be removed
+                   next time around. */
+                io->in->position = i;
+                break;
             }
-            i++;
         } while (i < length);
 
-        done_skipping_whitespace:
-
         /* check that there actually /is/ something to parse, bail if not */
         if (i == length) {
             no_data:
@@ -592,6 +592,20 @@ sexpr sx_read(struct sexpr_io *io) {
             }
         }
 
+        if (buf[i] == (char)SX_BINARY_FRAME) {
+            unsigned int start = i;
+
+            result = sx_read_binary (io, &i, buf, length);
+            io->in->position = i;
+
+            /* broken frames are skipped; try whatever comes after them */
+            if (nexp (result) && (i != start)) {
+                goto retry;
+            }
+
+            return result;
+        }
+
         result = sx_read_dispatch (&i, buf, length);
 
         if (result != sx_nonexistent) {
@@ -603,20 +617,23 @@ sexpr sx_read(struct sexpr_io *io) {
 }
 
 static void sx_write_string_or_symbol (struct io *io, struct sexpr_string_or_symbol *sexpr) {
-    unsigned int i, j;
-
-    for (i = 0; sexpr->character_data[i] != (char)0; i++);
+    unsigned int i = sexpr->length, j, k;
 
     if (i != 0) {
         if (sexpr->type == sxt_string) {
             (void)io_collect (io, "\"", 1);
-            /* TODO: this is actually super-inefficient... but it works */
-            for (j = 0; j < i; j++) {
+            /* write everything between characters that need escaping in one
+               go */
+            for (j = 0, k = 0; j < i; j++) {
                 if ((sexpr->character_data[j] == '"') || (sexpr->character_data[j] == '\\')) {
+                    if (j > k) {
+                        (void)io_collect (io, sexpr->character_data + k, j - k);
+                    }
                     (void)io_collect (io, "\\", 1);
+                    k = j;
                 }
-                (void)io_collect (io, sexpr->character_data + j, 1);
             }
+            (void)io_collect (io, sexpr->character_data + k, i - k);
             (void)io_collect (io, "\"", 1);
         } else
             (void)io_collect (io, sexpr->character_data, i);
@@ -653,16 +670,29 @@ static void sx_write_cons (struct sexpr_io *io, struct sexpr_cons *sx) {
 
 static void sx_write_integer (struct io *io, int_pointer_s i)
 {
-    sexpr s = sx_to_string (make_integer (i));
-    const char *sx = sx_string (s);
-    int c = 0;
+    char num [SX_MAX_NUMBER_LENGTH];
+    /* negated after the conversion, which is also fine for the most negative
+       value */
+    int_pointer u = (i < 0) ? ((int_pointer)0 - (int_pointer)i)
+                            : (int_pointer)i;
+    int c = SX_MAX_NUMBER_LENGTH;
+
+    /* formatted in place, so that writing integers doesn't create strings */
+    do
+    {
+        c--;
+        num[c] = '0' + (char)(u % 10);
+        u /= 10;
+    }
+    while ((u != 0) && (c > 1));
 
-    while (sx[c])
+    if (i < 0)
     {
-        c++;
+        c--;
+        num[c] = '-';
     }
 
-    (void)io_collect (io, sx, c);
+    (void)io_collect (io, num + c, SX_MAX_NUMBER_LENGTH - c);
 }
 
 static unsigned int sx_write_dispatch (struct sexpr_io *io, sexpr sx)
@@ -797,6 +827,12 @@ void sx_write(struct sexpr_io *io, sexpr sx)
         return;
     }
 
+    if ((io->flags & SX_IO_BINARY) == SX_IO_BINARY)
+    {
+        sx_write_binary (io, sx);
+        return;
+    }
+
     if (sx_write_dispatch(io, sx) == 1)
     {
         (void)io_write (io->out, "\n", 1);
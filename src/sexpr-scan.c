@@ -0,0 +1,57 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/sexpr.h>
+#include <curie/sexpr-internal.h>
+
+unsigned int sx_scan
+    (const char *buf, unsigned int i, unsigned int length,
+     unsigned char classes)
+{
+    const unsigned char *b = (const unsigned char *)buf;
+
+    while ((i < length) && ((sx_character_classes[b[i]] & classes) == 0))
+    {
+        i++;
+    }
+
+    return i;
+}
+
+unsigned int sx_skip
+    (const char *buf, unsigned int i, unsigned int length,
+     unsigned char classes)
+{
+    const unsigned char *b = (const unsigned char *)buf;
+
+    while ((i < length) && ((sx_character_classes[b[i]] & classes) != 0))
+    {
+        i++;
+    }
+
+    return i;
+}
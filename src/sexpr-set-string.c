@@ -82,45 +82,71 @@ sexpr sx_split (sexpr item, sexpr separator)
     return sx_end_of_list;
 }
 
-sexpr sx_merge (sexpr set, sexpr glue)
+static const char *sx_merge_text (sexpr t)
 {
-    sexpr t;
-    const char *s;
-    char **sset = (char **)0;
+    return stringp (t) ? sx_string (t)
+         : symbolp (t) ? sx_symbol (t)
+         : (const char *)0;
+}
 
-    while (consp (set))
-    {
-        t = car (set);
+static char sx_merge_seen (sexpr set, sexpr cursor, const char *s)
+{
+    const char *p, *q;
 
-        if (stringp (t))
-        {
-            sset = str_set_add (sset, sx_string (t));
-        }
-        else if (symbolp (t))
+    for (; set != cursor; set = cdr (set))
+    {
+        if ((p = sx_merge_text (car (set))) != (const char *)0)
         {
-            sset = str_set_add (sset, sx_symbol (t));
-        }
+            for (q = s; (*p == *q) && (*p != (char)0); p++, q++);
 
-        set = cdr (set);
+            if (*p == *q)
+            {
+                return (char)1;
+            }
+        }
     }
 
-    if (sset == (char **)0)
+    return (char)0;
+}
+
+sexpr sx_merge (sexpr set, sexpr glue)
+{
+    struct sexpr_string_builder b;
+    sexpr cursor;
+    const char *s;
+    char g[2] = { (char)0, (char)0 }, have = (char)0;
+
+    if (stringp (glue) || symbolp (glue))
     {
-        return sx_nil;
+        g[0] = sx_merge_text (glue)[0];
+    }
+    else
+    {
+        g[0] = (char)sx_integer (glue);
     }
 
-    if (stringp (glue))
+    sx_builder_initialise (&b);
+
+    /* same as a set of strings would do: duplicates only appear once */
+    for (cursor = set; consp (cursor); cursor = cdr (cursor))
     {
-        s = sx_string (glue);
+        if (((s = sx_merge_text (car (cursor))) != (const char *)0) &&
+            !sx_merge_seen (set, cursor, s))
+        {
+            if (have)
+            {
+                sx_builder_append_c (&b, g);
+            }
 
-        return make_string (str_merge (sset, (int)(s[0])));
+            sx_builder_append_c (&b, s);
+            have = (char)1;
+        }
     }
-    else if (symbolp (glue))
-    {
-        s = sx_symbol (glue);
 
-        return make_symbol (str_merge (sset, (int)(s[0])));
+    if (!have)
+    {
+        return sx_nil;
     }
 
-    return make_string (str_merge (sset, sx_integer(glue)));
+    return symbolp (glue) ? sx_builder_symbol (&b) : sx_builder_string (&b);
 }
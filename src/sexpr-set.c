@@ -46,7 +46,10 @@ sexpr sx_set_add (sexpr set, sexpr item)
 
 sexpr sx_set_remove (sexpr set, sexpr item)
 {
-    sexpr rv = sx_end_of_list, c = set, t;
+    struct sexpr_list_builder rv;
+    sexpr c = set, t;
+
+    sx_list_builder_initialise (&rv);
 
     while (consp (c))
     {
@@ -54,13 +57,13 @@ sexpr sx_set_remove (sexpr set, sexpr item)
 
         if (falsep (equalp (t, item)))
         {
-            rv = cons (t, rv);
+            sx_list_builder_append (&rv, t);
         }
 
         c = cdr (c);
     }
 
-    return rv;
+    return sx_list_builder_finish (&rv, sx_end_of_list);
 }
 
 sexpr sx_set_merge (sexpr a, sexpr b)
@@ -93,7 +96,10 @@ sexpr sx_set_merge (sexpr a, sexpr b)
 
 sexpr sx_set_intersect (sexpr a, sexpr b)
 {
-    sexpr rv = sx_end_of_list, c, t;
+    struct sexpr_list_builder rv;
+    sexpr c, t;
+
+    sx_list_builder_initialise (&rv);
 
     while (consp (b))
     {
@@ -104,7 +110,7 @@ sexpr sx_set_intersect (sexpr a, sexpr b)
         {
             if (truep (equalp (car (c), t)))
             {
-                rv = cons (t, rv);
+                sx_list_builder_append (&rv, t);
                 goto next;
             }
 
@@ -115,12 +121,15 @@ sexpr sx_set_intersect (sexpr a, sexpr b)
         b = cdr (b);
     }
 
-    return rv;
+    return sx_list_builder_finish (&rv, sx_end_of_list);
 }
 
 sexpr sx_set_difference (sexpr a, sexpr b)
 {
-    sexpr rv = sx_end_of_list, c, t, ob = b;
+    struct sexpr_list_builder rv;
+    sexpr c, t, ob = b;
+
+    sx_list_builder_initialise (&rv);
 
     while (consp (b))
     {
@@ -137,7 +146,7 @@ sexpr sx_set_difference (sexpr a, sexpr b)
             c = cdr (c);
         }
 
-        rv = cons (t, rv);
+        sx_list_builder_append (&rv, t);
 
       next_a:
         b = cdr (b);
@@ -158,13 +167,13 @@ sexpr sx_set_difference (sexpr a, sexpr b)
             c = cdr (c);
         }
 
-        rv = cons (t, rv);
+        sx_list_builder_append (&rv, t);
 
       next_b:
         a = cdr (a);
     }
 
-    return rv;
+    return sx_list_builder_finish (&rv, sx_end_of_list);
 }
 
 sexpr sx_set_memberp (sexpr set, sexpr item)
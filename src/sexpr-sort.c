@@ -26,73 +26,80 @@
 */
 
 #include <sievert/sexpr.h>
+#include <curie/memory.h>
 
 sexpr sx_set_sort_merge
     (sexpr set, sexpr (*gtp)(sexpr, sexpr, void *), void *aux)
 {
-    sexpr a = sx_end_of_list, b = sx_end_of_list, c = set;
+    struct sexpr_list_builder list;
+    sexpr stack[SX_LIST_BUILDER_SIZE], *from, *to, *t;
+    unsigned long n, width, lo, mid, hi, l, r, k;
 
-    while (consp (c))
-    {
-        a = cons (car (c), a);
-
-        c = cdr (c);
+    sx_list_builder_initialise (&list);
 
-        if (consp (c))
-        {
-            b = cons (car (c), b);
-            
-            c = cdr (c);
-        }
-        else
-        {
-            break;
-        }
+    for (; consp (set); set = cdr (set))
+    {
+        sx_list_builder_append (&list, car (set));
     }
 
-    if (eolp (b)) /* one or no elements in the list, since b wasnt touched */
+    n = list.length;
+
+    if (n < 2)
     {
-        return a;
+        return sx_list_builder_finish (&list, sx_end_of_list);
     }
-    else
-    {
-        sexpr rv = sx_end_of_list, aa, ba;
 
-        a = sx_set_sort_merge (a, gtp, aux);
-        b = sx_set_sort_merge (b, gtp, aux);
+    /* bottom-up merge sort, bouncing between the builder's elements and a
+       scratch buffer of the same size */
+    from = list.elements;
+    to   = (n <= SX_LIST_BUILDER_SIZE) ? stack
+                                       : get_mem (n * sizeof (sexpr));
 
-        aa = car (a);
-        ba = car (b);
-
-        while (consp (a) && consp (b))
+    for (width = 1; width < n; width *= 2)
+    {
+        for (lo = 0; lo < n; lo += 2 * width)
         {
-            if (truep (gtp (ba, aa, aux)))
-            {
-                rv = cons (aa, rv);
-                a  = cdr (a);
-                aa = car (a);
-            }
-            else
+            mid = lo + width;
+            hi  = mid + width;
+
+            if (mid > n) mid = n;
+            if (hi  > n) hi  = n;
+
+            for (l = lo, r = mid, k = lo; k < hi; k++)
             {
-                rv = cons (ba, rv);
-                b  = cdr (b);
-                ba = car (b);
+                if ((l < mid) &&
+                    ((r >= hi) || !truep (gtp (from[l], from[r], aux))))
+                {
+                    to[k] = from[l];
+                    l++;
+                }
+                else
+                {
+                    to[k] = from[r];
+                    r++;
+                }
             }
         }
 
-        while (consp (a))
-        {
-            rv = cons (car (a), rv);
-            a  = cdr (a);
-        }
+        t    = from;
+        from = to;
+        to   = t;
+    }
 
-        while (consp (b))
+    if (from != list.elements)
+    {
+        for (k = 0; k < n; k++)
         {
-            rv = cons (car (b), rv);
-            b  = cdr (b);
+            list.elements[k] = from[k];
         }
 
-        return sx_reverse (rv);
+        to = from;
+    }
+
+    if (to != stack)
+    {
+        free_mem (n * sizeof (sexpr), to);
     }
-}
 
+    return sx_list_builder_finish (&list, sx_end_of_list);
+}
@@ -33,6 +33,24 @@
 #include <curie/tree.h>
 #include <curie/hash.h>
 #include <curie/math.h>
+#include <curie/internal-constants.h>
+
+/* hand out an s-expression that was already around; if a lazy sweep is in
+   progress then it may have been declared dead already */
+static sexpr sx_reuse (struct tree_node *n)
+{
+    sexpr sx = (sexpr)node_get_value (n);
+
+    if (gc_sweeping)
+    {
+        gc_keep (sx);
+    }
+
+    return sx;
+}
+
+#define sx_sweep_some()\
+    if (gc_sweeping) (void)gc_sweep (GC_SWEEP_STEP)
 
 static struct tree sx_cons_tree     = TREE_INITIALISER;
 static struct tree sx_string_tree   = TREE_INITIALISER;
@@ -46,7 +64,7 @@ sexpr cons(sexpr sx_car, sexpr sx_cdr)
             MEMORY_POOL_INITIALISER(sizeof (struct sexpr_cons));
     struct sexpr_cons *rv;
     struct tree_node *n;
-    sexpr t[2];
+    sexpr t[2], i;
     int_pointer hash;
 
     t[0] = sx_car;
@@ -54,11 +72,19 @@ sexpr cons(sexpr sx_car, sexpr sx_cdr)
 
     hash = hash_murmur2_pt (t, sizeof(t), 0);
 
+    if ((sx_images > 0) &&
+        !nexp (i = sx_image_cons (sx_car, sx_cdr, hash)))
+    {
+        return i;
+    }
+
     if ((n = tree_get_node (&sx_cons_tree, (int_pointer)hash)))
     {
-        return (sexpr)node_get_value (n);
+        return sx_reuse (n);
     }
 
+    sx_sweep_some ();
+
     rv = get_pool_mem (&pool);
 
     rv->type = sxt_cons;
@@ -80,6 +106,7 @@ sexpr make_rational(int_pointer p, int_pointer_s q)
     struct tree_node *n;
     int_64 g = gcd (p, q >= 0 ? q : (q * -1));
     int_pointer t[2], hash;
+    sexpr i;
 
     p /= g;
     q /= g;
@@ -93,15 +120,28 @@ sexpr make_rational(int_pointer p, int_pointer_s q)
         return make_integer (p * -1);
     }
 
+    if (sx_rational_fitsp (p, q))
+    {
+        return make_immediate_rational (p, q);
+    }
+
     t[0] = p;
     t[1] = q;
     hash = hash_murmur2_pt (t, sizeof(t), 0);
 
+    if ((sx_images > 0) &&
+        !nexp (i = sx_image_rational (p, q, hash)))
+    {
+        return i;
+    }
+
     if ((n = tree_get_node (&sx_rational_tree, (int_pointer)hash)))
     {
-        return (sexpr)node_get_value (n);
+        return sx_reuse (n);
     }
 
+    sx_sweep_some ();
+
     rv = get_pool_mem (&pool);
 
     rv->type        = sxt_rational;
@@ -121,14 +161,25 @@ static sexpr make_string_or_symbol_lh
     struct sexpr_string_or_symbol *s;
     unsigned int i;
     struct tree_node *n;
+    sexpr rv;
+
+    if ((sx_images > 0) &&
+        !nexp (rv = sx_image_string_or_symbol
+                        ((symbol == (char)1) ? sxt_symbol : sxt_string,
+                         string, len, hash)))
+    {
+        return rv;
+    }
 
     if ((n = tree_get_node ((symbol == (char)1) ? &sx_symbol_tree
                                                 : &sx_string_tree,
                             (int_pointer)hash)))
     {
-        return (sexpr)node_get_value (n);
+        return sx_reuse (n);
     }
 
+    sx_sweep_some ();
+
     s = aalloc (sizeof (struct sexpr_string_or_symbol) + len + 1);
 
     tree_add_node_value ((symbol == (char)1) ? &sx_symbol_tree
@@ -141,18 +192,103 @@ static sexpr make_string_or_symbol_lh
     }
     s->character_data[i] = (char)0;
 
-    s->type = (symbol == (char)1) ? sxt_symbol : sxt_string;
+    s->type   = (symbol == (char)1) ? sxt_symbol : sxt_string;
+    s->length = (unsigned int)len;
+    s->hash   = hash;
 
     gc_base_items++;
 
     return (sexpr)s;
 }
 
+/* strings and symbols of up to 7 characters are kept in this table for good;
+   finding them in there is cheaper than hash-consing them, and since they
+   aren't in the trees, the gc never looks at them. The entries look just like
+   any other struct sexpr_string_or_symbol. */
+struct sx_short_string
+{
+    enum sx_type type;
+    unsigned int length;
+    int_pointer hash;
+    char character_data[8];
+};
+
+static struct sx_short_string sx_short_strings[SX_SHORT_STRINGS];
+static int_64 sx_short_keys[SX_SHORT_STRINGS];
+static unsigned int sx_short_strings_used = 0;
+
+static sexpr make_short_string_or_symbol
+    (const char *string, char symbol, unsigned long len)
+{
+    int_64 key = ((int_64)1 << 63) | ((int_64)symbol << 59) |
+                 ((int_64)len << 56);
+    unsigned int i, j;
+    sexpr rv;
+
+    /* heap images come first, same as for all other strings */
+    if ((sx_images > 0) &&
+        !nexp (rv = sx_image_string_or_symbol
+                        ((symbol == (char)1) ? sxt_symbol : sxt_string,
+                         string, len, str_hash_l (string, len))))
+    {
+        return rv;
+    }
+
+    for (i = 0; i < len; i++)
+    {
+        key |= ((int_64)(unsigned char)string[i]) << (i * 8);
+    }
+
+    for (i = (unsigned int)((key * 0x9e3779b97f4a7c15ULL)
+                            >> (64 - SX_SHORT_STRINGS_BITS));
+         sx_short_keys[i] != 0;
+         i = (i + 1) & (SX_SHORT_STRINGS - 1))
+    {
+        if (sx_short_keys[i] == key)
+        {
+            return (sexpr)&(sx_short_strings[i]);
+        }
+    }
+
+    if (sx_short_strings_used >= ((SX_SHORT_STRINGS / 4) * 3))
+    {
+        /* full; these go through the trees like all other strings */
+        return sx_nonexistent;
+    }
+
+    sx_short_keys[i] = key;
+    sx_short_strings_used++;
+
+    sx_short_strings[i].type   = (symbol == (char)1) ? sxt_symbol : sxt_string;
+    sx_short_strings[i].length = (unsigned int)len;
+    sx_short_strings[i].hash   = str_hash_l (string, len);
+
+    for (j = 0; j < len; j++)
+    {
+        sx_short_strings[i].character_data[j] = string[j];
+    }
+    sx_short_strings[i].character_data[j] = (char)0;
+
+    return (sexpr)&(sx_short_strings[i]);
+}
+
 static sexpr make_string_or_symbol
     (const char *string, char symbol)
 {
     unsigned long len;
-    int_pointer hash = str_hash (string, &len);
+    int_pointer hash;
+    sexpr rv;
+
+    for (len = 0; (len < 8) && (string[len] != (char)0); len++);
+
+    if ((len < 8) &&
+        ((rv = make_short_string_or_symbol (string, symbol, len))
+             != sx_nonexistent))
+    {
+        return rv;
+    }
+
+    hash = str_hash (string, &len);
 
     return make_string_or_symbol_lh (string, symbol, hash, len);
 }
@@ -160,7 +296,17 @@ static sexpr make_string_or_symbol
 static sexpr make_string_or_symbol_l
     (const char *string, char symbol, unsigned long len)
 {
-    int_pointer hash = hash_murmur2_pt (string, len, 0);
+    int_pointer hash;
+    sexpr rv;
+
+    if ((len < 8) &&
+        ((rv = make_short_string_or_symbol (string, symbol, len))
+             != sx_nonexistent))
+    {
+        return rv;
+    }
+
+    hash = str_hash_l (string, len);
 
     return make_string_or_symbol_lh (string, symbol, hash, len);
 }
@@ -189,6 +335,12 @@ sexpr make_symbol_l
     return make_string_or_symbol_l (symbol, (char)1, length);
 }
 
+int_pointer sx_string_or_symbol_hash (struct sexpr_string_or_symbol *s)
+{
+    return (s->hash != 0) ? s->hash
+                          : str_hash_l (s->character_data, s->length);
+}
+
 void sx_destroy(sexpr sxx)
 {
     if (!pointerp(sxx)) return;
@@ -198,16 +350,16 @@ void sx_destroy(sexpr sxx)
         struct sexpr_string_or_symbol *sx
                 = (struct sexpr_string_or_symbol *)sx_pointer(sxx);
 
-        unsigned long length = 0;
-        int_32 hash;
+        unsigned long length = sx->length;
+        int_pointer hash = sx_string_or_symbol_hash (sx);
         struct tree_node *n;
 
-        hash = str_hash (((struct sexpr_string_or_symbol *)sx)->character_data,
-                         &length);
-
+        /* static strings aren't in the trees, but may have the same hash as
+           one that is */
         if ((n = tree_get_node ((sx->type == sxt_string) ? &sx_string_tree
                                                          : &sx_symbol_tree,
-                                (int_pointer)hash)))
+                                (int_pointer)hash)) &&
+            (node_get_value (n) == (void *)sx))
         {
             tree_remove_node ((sx->type == sxt_string) ? &sx_string_tree
                                                        : &sx_symbol_tree,
@@ -29,12 +29,21 @@
 
 #include <curie/sexpr.h>
 #include <curie/filesystem.h>
+#include <curie/tree.h>
+#include <curie/gc.h>
 #include <sievert/shell.h>
+#include <sievert/shell-system.h>
 
-sexpr ewhich (char **environment, sexpr programme)
+static struct directory_watch *cache_watch = (struct directory_watch *)0;
+static struct tree *cache_entries = (struct tree *)0;
+static sexpr cache_path    = sx_nil;
+static sexpr cache_missing = sx_nil;
+static sexpr cache_keep    = sx_nil;
+static char cache_initialised = (char)0;
+
+static const char *get_path (char **environment)
 {
-    define_string (str_slash, "/");
-    char *x = (char *)0, *y, buffer[BUFFERSIZE];
+    char *y;
 
     for (int i = 0; environment[i]; i++)
     {
@@ -42,15 +51,16 @@ sexpr ewhich (char **environment, sexpr programme)
         if ((y[0] == 'P') && (y[1] == 'A') && (y[2] == 'T') && (y[3] == 'H') &&
             (y[4] == '='))
         {
-            x = y + 5;
-            break;
+            return y + 5;
         }
     }
 
-    if (x == (char *)0)
-    {
-        x = "/bin:/sbin:/usr/bin:/usr/sbin:/usr/local/bin:/usr/local/sbin";
-    }
+    return "/bin:/sbin:/usr/bin:/usr/sbin:/usr/local/bin:/usr/local/sbin";
+}
+
+static sexpr resolve (const char *x, sexpr programme)
+{
+    char *y, buffer[BUFFERSIZE];
 
     y = buffer;
 
@@ -62,8 +72,14 @@ sexpr ewhich (char **environment, sexpr programme)
             {
                 *y = 0;
                 y = buffer;
-                sexpr b = make_string (buffer);
-                sexpr f = sx_join (b, str_slash, programme);
+                struct sexpr_string_builder b;
+                sexpr f;
+
+                sx_builder_initialise (&b);
+                sx_builder_append_c (&b, buffer);
+                sx_builder_append_c (&b, "/");
+                sx_builder_append (&b, programme);
+                f = sx_builder_string (&b);
 
                 if (truep (filep (f)))
                 {
@@ -87,3 +103,173 @@ sexpr ewhich (char **environment, sexpr programme)
 
     return sx_false;
 }
+
+/* relative components resolve against the current directory, which may
+   change without touching any of the watched directories */
+static char path_relativep (const char *x)
+{
+    char start = (char)1;
+
+    for (; *x != 0; x++)
+    {
+        if (*x == ':')
+        {
+            start = (char)1;
+        }
+        else if (start)
+        {
+            if (*x != '/')
+            {
+                return (char)1;
+            }
+
+            start = (char)0;
+        }
+    }
+
+    return (char)0;
+}
+
+static void cache_reset (const char *x)
+{
+    char *y, buffer[BUFFERSIZE];
+
+    if (cache_watch != (struct directory_watch *)0)
+    {
+        directory_watch_destroy (cache_watch);
+    }
+
+    if (cache_entries != (struct tree *)0)
+    {
+        tree_destroy (cache_entries);
+    }
+
+    cache_path    = make_string (x);
+    cache_missing = sx_end_of_list;
+    cache_keep    = sx_end_of_list;
+    cache_entries = tree_create ();
+    cache_watch   = directory_watch_create ();
+
+    if (cache_watch == (struct directory_watch *)0)
+    {
+        return;
+    }
+
+    y = buffer;
+
+    while (y < (buffer + BUFFERSIZE - 1))
+    {
+        if ((*x == ':') || ((*x) == 0))
+        {
+            if (y != buffer)
+            {
+                *y = 0;
+                y = buffer;
+
+                if (!directory_watch_add (cache_watch, buffer))
+                {
+                    /* retried on every lookup; once it succeeds, the
+                       directory has appeared and the cache is stale */
+                    cache_missing = cons (make_string (buffer), cache_missing);
+                }
+            }
+
+            if ((*x) == 0)
+            {
+                return;
+            }
+        }
+        else
+        {
+            *y = *x;
+            y++;
+        }
+
+        x++;
+    }
+}
+
+static char cache_validate (const char *x)
+{
+    sexpr c;
+
+    if (path_relativep (x))
+    {
+        return (char)0;
+    }
+
+    if (!cache_initialised)
+    {
+        gc_add_root (&cache_path);
+        gc_add_root (&cache_missing);
+        gc_add_root (&cache_keep);
+        cache_initialised = (char)1;
+
+        cache_reset (x);
+    }
+    else if (make_string (x) != cache_path)
+    {
+        cache_reset (x);
+    }
+    else if (cache_watch != (struct directory_watch *)0)
+    {
+        if (directory_watch_changed (cache_watch))
+        {
+            cache_reset (x);
+        }
+        else
+        {
+            for (c = cache_missing; consp (c); c = cdr (c))
+            {
+                if (directory_watch_add (cache_watch, sx_string (car (c))))
+                {
+                    cache_reset (x);
+                    break;
+                }
+            }
+        }
+    }
+
+    return (cache_watch != (struct directory_watch *)0);
+}
+
+sexpr ewhich (char **environment, sexpr programme)
+{
+    const char *x = get_path (environment);
+    struct tree_node *n;
+    sexpr f;
+
+    if (!cache_validate (x))
+    {
+        return resolve (x, programme);
+    }
+
+    if ((n = tree_get_node (cache_entries, (int_pointer)programme))
+          != (struct tree_node *)0)
+    {
+        return (sexpr)node_get_value (n);
+    }
+
+    f = resolve (x, programme);
+
+    /* keeping the programme alive also keeps its address from being reused
+       by some other string while it's still a key in the cache */
+    cache_keep = cons (cons (programme, f), cache_keep);
+    tree_add_node_value (cache_entries, (int_pointer)programme, (void *)f);
+
+    return f;
+}
+
+sexpr ewhich_batch (char **environment, sexpr programmes)
+{
+    struct sexpr_list_builder rv;
+
+    sx_list_builder_initialise (&rv);
+
+    for (; consp (programmes); programmes = cdr (programmes))
+    {
+        sx_list_builder_append (&rv, ewhich (environment, car (programmes)));
+    }
+
+    return sx_list_builder_finish (&rv, sx_end_of_list);
+}
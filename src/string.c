@@ -27,6 +27,7 @@
 
 #include <curie/string.h>
 #include <curie/hash.h>
+#include <curie/constants.h>
 
 int_pointer str_hash(const char *data, unsigned long *len)
 {
@@ -39,5 +40,11 @@ int_pointer str_hash(const char *data, unsigned long *len)
 
     *len = l;
 
-    return hash_murmur2_pt (data, l, 0);
+    return str_hash_l (data, l);
+}
+
+int_pointer str_hash_l(const char *data, unsigned long len)
+{
+    return (len < STR_HASH_LONG) ? hash_murmur2_pt (data, (int)len, 0)
+                                 : hash_wyhash_pt (data, len, 0);
 }
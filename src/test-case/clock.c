@@ -0,0 +1,142 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/main.h>
+#include <curie/sexpr.h>
+#include <curie/time.h>
+#include <curie/constants.h>
+#include <syscall/syscall.h>
+
+#define CALLS 1000000
+
+struct timespec_k
+{
+    long tv_sec;
+    long tv_nsec;
+};
+
+static int_64 calls_per_second (int_64 start, int_64 end)
+{
+    return (end > start) ? ((int_64)CALLS * 1000000000) / (end - start)
+                         : (int_64)0;
+}
+
+static sexpr benchmark (void)
+{
+    int_64 start, end, sum = 0, library, system;
+    unsigned long i;
+
+    start = dt_get_nanoseconds (dtc_monotonic);
+
+    for (i = 0; i < CALLS; i++)
+    {
+        sum += dt_get_nanoseconds (dtc_monotonic);
+    }
+
+    end     = dt_get_nanoseconds (dtc_monotonic);
+    library = calls_per_second (start, end);
+
+    start = dt_get_nanoseconds (dtc_monotonic);
+
+    for (i = 0; i < CALLS; i++)
+    {
+#if defined(have_sys_clock_gettime)
+        struct timespec_k ts;
+
+        (void)sys_clock_gettime (1, &ts);
+        sum += ts.tv_nsec;
+#else
+        sum += sys_time (0);
+#endif
+    }
+
+    end    = dt_get_nanoseconds (dtc_monotonic);
+    system = calls_per_second (start, end);
+
+    if (sum == 0)
+    {
+        return sx_false;
+    }
+
+    return cons (make_symbol ("clock-benchmark"),
+             cons (cons (make_symbol ("library-calls-per-second"),
+                     cons (make_integer (library), sx_end_of_list)),
+               cons (cons (make_symbol ("syscall-calls-per-second"),
+                       cons (make_integer (system), sx_end_of_list)),
+                 sx_end_of_list)));
+}
+
+int cmain (void)
+{
+    struct sexpr_io *stdio = sx_open_stdout ();
+    int_64 a, b;
+    struct datetime d;
+    sexpr r;
+    int i;
+
+    a = dt_get_nanoseconds (dtc_monotonic);
+
+    for (i = 0; i < 1000; i++)
+    {
+        b = dt_get_nanoseconds (dtc_monotonic);
+
+        if (b < a)
+        {
+            return 1;
+        }
+
+        a = b;
+    }
+
+    a = dt_get_nanoseconds (dtc_boot_time);
+    b = dt_get_nanoseconds (dtc_boot_time);
+
+    if (b < a)
+    {
+        return 2;
+    }
+
+    d = dt_get ();
+    a = dt_get_nanoseconds (dtc_realtime) / 1000000000;
+    b = ((int_64)(d.date - UNIX_EPOCH) * SECONDS_PER_DAY) + d.time;
+
+    if ((d.nanoseconds >= 1000000000) || (a < b) || (a > (b + 2)))
+    {
+        return 3;
+    }
+
+    r = benchmark ();
+
+    if (falsep (r))
+    {
+        return 4;
+    }
+
+    sx_write (stdio, r);
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/main.h>
+#include <curie/directory.h>
+#include <curie/gc.h>
+#include <curie/time.h>
+#include <sievert/sexpr.h>
+
+#define PATTERN "../src/.*/.*\\.c"
+
+static sexpr reference;
+static unsigned long mismatches;
+
+static void check (const char *path, void *aux)
+{
+    sexpr p = make_string (path), c;
+
+    for (c = reference; consp (c); c = cdr (c))
+    {
+        if (truep (equalp (car (c), p)))
+        {
+            return;
+        }
+    }
+
+    mismatches++;
+}
+
+static void count (const char *path, void *aux)
+{
+    (*((unsigned long *)aux))++;
+}
+
+/* scans per second, for either the list or the callback interface */
+static unsigned long benchmark (char glob)
+{
+    unsigned long scans = 0, n = 0;
+    unsigned int t;
+
+    t = dt_get_time ();
+    while (dt_get_time () == t);
+
+    t = dt_get_time ();
+
+    do
+    {
+        if (glob)
+        {
+            (void)read_directory_glob (PATTERN, count, (void *)&n);
+        }
+        else
+        {
+            (void)read_directory (PATTERN);
+            (void)gc_invoke ();
+        }
+
+        scans++;
+    }
+    while ((dt_get_time () - t) < 2);
+
+    return scans / 2;
+}
+
+int cmain (void)
+{
+    struct sexpr_io *stdio = sx_open_stdout ();
+    unsigned long n = 0, l = 0, list, glob;
+    sexpr c;
+
+    reference = read_directory (PATTERN);
+    gc_add_root (&reference);
+
+    for (c = reference; consp (c); c = cdr (c))
+    {
+        l++;
+    }
+
+    if (l == 0)
+    {
+        return 1;
+    }
+
+    if (read_directory_glob (PATTERN, check, (void *)0) != l)
+    {
+        return 2;
+    }
+
+    if (mismatches != 0)
+    {
+        return 3;
+    }
+
+    if (read_directory_glob ("../src/test-case/directory-glob.c", count,
+                             (void *)&n) != 1)
+    {
+        return 4;
+    }
+
+    if ((n != 1) ||
+        (read_directory_glob ("../src/test-case/no-such-file", count,
+                              (void *)&n) != 0) ||
+        (read_directory_glob ("../src/no-such-directory/.*", count,
+                              (void *)&n) != 0))
+    {
+        return 5;
+    }
+
+    list = benchmark (0);
+    glob = benchmark (1);
+
+    sx_write (stdio,
+        cons (make_symbol ("directory-glob-benchmark"),
+          cons (cons (make_symbol ("entries"),
+                  cons (make_integer (l), sx_end_of_list)),
+            cons (cons (make_symbol ("list-scans-per-second"),
+                    cons (make_integer (list), sx_end_of_list)),
+              cons (cons (make_symbol ("glob-scans-per-second"),
+                      cons (make_integer (glob), sx_end_of_list)),
+                    sx_end_of_list)))));
+
+    return 0;
+}
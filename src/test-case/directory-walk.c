@@ -0,0 +1,124 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/main.h>
+#include <curie/multiplex.h>
+#include <curie/directory.h>
+#include <sievert/directory-walk.h>
+
+static unsigned long entries, with_metadata, mismatches;
+static char done;
+
+static void on_entry (sexpr path, struct metadata *metadata, void *aux)
+{
+    const char *s = sx_string (path), *p = "../src/";
+    unsigned int i;
+
+    for (i = 0; p[i]; i++)
+    {
+        if (s[i] != p[i])
+        {
+            mismatches++;
+        }
+    }
+
+    entries++;
+
+    if (metadata != (struct metadata *)0)
+    {
+        with_metadata++;
+    }
+}
+
+static void on_done (void *aux)
+{
+    done = (char)1;
+}
+
+static void count (const char *path, void *aux)
+{
+    (*((unsigned long *)aux))++;
+}
+
+static char run (const char *root, unsigned int threads, char metadata)
+{
+    entries       = 0;
+    with_metadata = 0;
+    done          = (char)0;
+
+    multiplex_add_directory_walk
+        (root, threads, metadata, on_entry, on_done, (void *)0);
+
+    while (!done && (multiplex () != mx_nothing_to_do));
+
+    return done;
+}
+
+int cmain (void)
+{
+    unsigned long expected = 0;
+
+    /* the source tree is one level deep; both globs also see . and .. */
+    (void)read_directory_glob ("../src/.*", count, (void *)&expected);
+    (void)read_directory_glob ("../src/test-case/.*", count,
+                               (void *)&expected);
+    expected -= 4;
+
+    multiplex_directory_walk ();
+
+    if (!run ("../src", 0, (char)1))
+    {
+        return 1;
+    }
+
+    if ((entries != expected) || (with_metadata != expected))
+    {
+        return 2;
+    }
+
+    if (!run ("../src", 1, (char)0))
+    {
+        return 3;
+    }
+
+    if ((entries != expected) || (with_metadata != 0))
+    {
+        return 4;
+    }
+
+    if (mismatches != 0)
+    {
+        return 5;
+    }
+
+    if (!run ("../src/no-such-directory", 2, (char)0) || (entries != 0))
+    {
+        return 6;
+    }
+
+    return 0;
+}
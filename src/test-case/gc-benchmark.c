@@ -0,0 +1,109 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/sexpr.h>
+#include <curie/gc.h>
+#include <curie/time.h>
+
+/* measure gc pauses with this many live conses, in a single list that is kept
+   alive through a root; the list is extended for each run, so that nothing is
+   actually collected */
+static const unsigned long live_conses[] = { 1000000, 10000000 };
+
+static sexpr list;
+
+static sexpr benchmark (unsigned long n)
+{
+    unsigned long collections = 0, seconds = 0, freed = 0;
+    unsigned int t;
+
+    /* get rid of whatever garbage is left over from the last run */
+    (void)gc_invoke ();
+
+    t = dt_get_time ();
+    while (dt_get_time () == t);
+
+    t = dt_get_time ();
+
+    /* time collections for at least two seconds */
+    do
+    {
+        freed += gc_invoke ();
+        collections++;
+        seconds = dt_get_time () - t;
+    }
+    while (seconds < 2);
+
+    if (freed != 0)
+    {
+        return sx_false;
+    }
+
+    return cons (make_symbol ("gc-benchmark"),
+             cons (cons (make_symbol ("live"),
+                     cons (make_integer (n), sx_end_of_list)),
+               cons (cons (make_symbol ("pause-milliseconds"),
+                       cons (make_integer ((seconds * 1000) / collections),
+                             sx_end_of_list)),
+                     sx_end_of_list)));
+}
+
+int cmain (void)
+{
+    struct sexpr_io *stdio = sx_open_stdout ();
+    unsigned long i, n = 0;
+    unsigned int j;
+    sexpr r;
+
+    list = sx_end_of_list;
+
+    gc_register_root (&list);
+    gc_scan_stack = (char)0;
+
+    for (j = 0; j < (sizeof (live_conses) / sizeof (live_conses[0])); j++)
+    {
+        for (i = n; i < live_conses[j]; i++)
+        {
+            list = cons (make_integer (i), list);
+        }
+
+        n = live_conses[j];
+
+        r = benchmark (n);
+
+        if (falsep (r))
+        {
+            return 1;
+        }
+
+        sx_write (stdio, r);
+    }
+
+    sx_close_io (stdio);
+
+    return 0;
+}
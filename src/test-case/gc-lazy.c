@@ -0,0 +1,99 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/sexpr.h>
+#include <curie/gc.h>
+
+#define LIVE    1000
+#define GARBAGE 1000
+
+static sexpr live;
+
+static sexpr make_list (long base, long length)
+{
+    sexpr rv = sx_end_of_list;
+    long i;
+
+    for (i = 0; i < length; i++)
+    {
+        rv = cons (make_integer (base + i), rv);
+    }
+
+    return rv;
+}
+
+int cmain (void)
+{
+    sexpr dead, again;
+    unsigned long rv, freed;
+
+    live = make_list (0, LIVE);
+
+    gc_register_root (&live);
+    gc_scan_stack = (char)0;
+    gc_lazy_sweep = (char)1;
+
+    (void)make_list (LIVE, GARBAGE);
+    dead = cons (make_integer (-1), sx_end_of_list);
+
+    rv = gc_invoke ();
+
+    if (rv != (GARBAGE + 1)) return 1;
+    if (!gc_sweeping)        return 2;
+
+    /* this is still around, so it should be reused and kept */
+    again = cons (make_integer (-1), sx_end_of_list);
+
+    if (again != dead) return 3;
+
+    freed = gc_sweep (0);
+
+    if (freed != GARBAGE) return 4;
+    if (gc_sweeping)      return 5;
+    if (gc_tidy ())       return 11;
+
+    if (!consp (again) || (car (again) != make_integer (-1))) return 6;
+
+    /* the resurrected cons is garbage again */
+    rv = gc_invoke ();
+
+    if (rv != 1) return 7;
+
+    /* creating new s-expressions should finish off the sweep eventually */
+    for (freed = 0; gc_sweeping && (freed < 100000); freed++)
+    {
+        (void)cons (make_integer (LIVE + GARBAGE + freed), sx_end_of_list);
+    }
+
+    if (gc_sweeping) return 8;
+
+    /* ... but without also optimising all the pools in the process */
+    if (!gc_tidy ()) return 9;
+    if (gc_tidy ())  return 10;
+
+    return 0;
+}
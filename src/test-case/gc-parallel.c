@@ -0,0 +1,201 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/sexpr.h>
+#include <curie/gc.h>
+#include <curie/time.h>
+#include <curie/memory.h>
+
+#define LISTS       500
+#define LIST_LENGTH 1000
+#define GARBAGE     1000
+
+static const unsigned int threads[] = { 1, 2, 4, 8, 16 };
+
+static sexpr data;
+
+/* a custom type whose tag function hands a deeply nested list to gc_tag(),
+   which a mark thread mustn't follow on its own stack */
+#define BOX_TYPE 0x0b0c
+#define NESTING  50000
+
+struct box
+{
+    unsigned int type;
+    sexpr contents;
+};
+
+static sexpr boxed;
+
+static void box_tag (sexpr sx)
+{
+    gc_tag (((struct box *)sx_pointer (sx))->contents);
+}
+
+static void box_call ()
+{
+    gc_call (boxed);
+}
+
+static sexpr make_box (void)
+{
+    struct box *b = aalloc (sizeof (struct box));
+    unsigned long i;
+
+    sx_register_type (BOX_TYPE, (void *)0, (void *)0, box_tag, (void *)0,
+                      box_call, (void *)0);
+
+    b->type     = BOX_TYPE;
+    b->contents = sx_end_of_list;
+
+    for (i = 0; i < NESTING; i++)
+    {
+        b->contents = cons (b->contents, sx_end_of_list);
+    }
+
+    return (sexpr)b;
+}
+
+static char box_intactp (void)
+{
+    sexpr sx = ((struct box *)sx_pointer (boxed))->contents;
+    unsigned long i;
+
+    for (i = 0; i < NESTING; i++)
+    {
+        if (!consp (sx) || (cdr (sx) != sx_end_of_list))
+        {
+            return (char)0;
+        }
+
+        sx = car (sx);
+    }
+
+    return sx == sx_end_of_list;
+}
+
+static sexpr make_list (unsigned long base, unsigned long length)
+{
+    sexpr rv = sx_end_of_list;
+    unsigned long i;
+
+    for (i = 0; i < length; i++)
+    {
+        rv = cons (make_integer (base + i), rv);
+    }
+
+    return rv;
+}
+
+static sexpr benchmark (unsigned int n)
+{
+    unsigned long collections = 0, seconds = 0, freed = 0;
+    unsigned int t;
+
+    gc_mark_threads = n;
+
+    (void)gc_invoke ();
+
+    t = dt_get_time ();
+    while (dt_get_time () == t);
+
+    t = dt_get_time ();
+
+    do
+    {
+        freed += gc_invoke ();
+        collections++;
+        seconds = dt_get_time () - t;
+    }
+    while (seconds < 2);
+
+    if (freed != 0)
+    {
+        return sx_false;
+    }
+
+    return cons (make_symbol ("gc-parallel-benchmark"),
+             cons (cons (make_symbol ("threads"),
+                     cons (make_integer (n), sx_end_of_list)),
+               cons (cons (make_symbol ("pause-milliseconds"),
+                       cons (make_integer ((seconds * 1000) / collections),
+                             sx_end_of_list)),
+                     sx_end_of_list)));
+}
+
+int cmain (void)
+{
+    struct sexpr_io *stdio = sx_open_stdout ();
+    unsigned long i;
+    unsigned int j;
+    sexpr r;
+
+    data = sx_end_of_list;
+
+    gc_register_root (&data);
+    gc_scan_stack = (char)0;
+
+    boxed = make_box ();
+    gc_register_root (&boxed);
+
+    for (i = 0; i < LISTS; i++)
+    {
+        data = cons (make_list (i * LIST_LENGTH, LIST_LENGTH), data);
+    }
+
+    /* only the garbage list should be collected, no matter how many threads
+       are doing the marking */
+    gc_mark_threads = 4;
+
+    (void)make_list (LISTS * LIST_LENGTH, GARBAGE);
+
+    if (gc_invoke () != GARBAGE)
+    {
+        return 1;
+    }
+
+    if (!box_intactp ())
+    {
+        return 3;
+    }
+
+    for (j = 0; j < (sizeof (threads) / sizeof (threads[0])); j++)
+    {
+        r = benchmark (threads[j]);
+
+        if (falsep (r))
+        {
+            return 2;
+        }
+
+        sx_write (stdio, r);
+    }
+
+    sx_close_io (stdio);
+
+    return 0;
+}
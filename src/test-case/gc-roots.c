@@ -0,0 +1,77 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/sexpr.h>
+#include <curie/gc.h>
+
+int cmain (void) {
+    sexpr rooted, other, locals[1];
+    struct gc_frame frame;
+    gc_root r, s;
+    unsigned long rv;
+
+    r = gc_register_root (&rooted);
+    s = gc_register_root (&other);
+    gc_unregister_root (r);
+
+    /* the slot should get reused */
+    if (gc_register_root (&rooted) != r) return 1;
+
+    gc_unregister_root (s);
+
+    gc_scan_stack = (char)0;
+
+    /* strings this short would be kept for good, so these are longer */
+    rooted    = cons (make_integer (1), make_string ("rooted string"));
+    locals[0] = make_string ("local string");
+    other     = cons (make_string ("garbage string"), sx_end_of_list);
+
+    gc_push_frame (&frame, locals, 1);
+
+    /* only the two "other" expressions are garbage */
+    rv = gc_invoke ();
+
+    if (rv != 2) return 2;
+
+    if (!stringp (cdr (rooted)) || !truep (equalp (car (rooted),
+                                                   make_integer (1))))
+    {
+        return 3;
+    }
+
+    gc_pop_frame (&frame);
+    gc_unregister_root (r);
+
+    /* now the rest should be gone as well */
+    rv = gc_invoke ();
+
+    if (rv != 3) return 4;
+
+    if (gc_frames != (struct gc_frame *)0) return 5;
+
+    return 0;
+}
@@ -0,0 +1,278 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+
+#include <curie/main.h>
+#include <curie/hash.h>
+#include <curie/memory.h>
+#include <curie/time.h>
+#include <curie/sexpr.h>
+
+#define AVALANCHE_KEYS 2000
+#define BUCKETS        4096
+#define BUCKET_KEYS    65536
+#define VOLUME         0x2000000
+
+static const unsigned long sizes[] = { 8, 16, 64, 256, 4096, 65536 };
+
+static unsigned char *data;
+static unsigned int seed = 1;
+
+static unsigned int random (void)
+{
+    seed = (seed * 1103515245U) + 12345U;
+
+    return seed >> 8;
+}
+
+static int_64 murmur2 (const void *key, unsigned long len)
+{
+    return hash_murmur2_64 (key, (int)len, 0);
+}
+
+static int_64 wyhash (const void *key, unsigned long len)
+{
+    return hash_wyhash_64 (key, len, 0);
+}
+
+/* worst deviation from flipping half of the output bits when one input bit is
+   flipped, over all input and output bits, in 1/1000 */
+static int_64 avalanche (int_64 (*hash)(const void *, unsigned long))
+{
+    static unsigned int flips[128][64];
+    unsigned char key[16];
+    unsigned int i, j, k;
+    int_64 h, d, worst = 0, bias;
+
+    for (i = 0; i < 128; i++)
+    {
+        for (j = 0; j < 64; j++)
+        {
+            flips[i][j] = 0;
+        }
+    }
+
+    for (k = 0; k < AVALANCHE_KEYS; k++)
+    {
+        for (i = 0; i < 16; i++)
+        {
+            key[i] = (unsigned char)random ();
+        }
+
+        h = hash (key, 16);
+
+        for (i = 0; i < 128; i++)
+        {
+            key[i / 8] ^= (1 << (i % 8));
+            d = h ^ hash (key, 16);
+            key[i / 8] ^= (1 << (i % 8));
+
+            for (j = 0; j < 64; j++)
+            {
+                flips[i][j] += (unsigned int)((d >> j) & 1);
+            }
+        }
+    }
+
+    for (i = 0; i < 128; i++)
+    {
+        for (j = 0; j < 64; j++)
+        {
+            bias = ((int_64)flips[i][j] * 2000) / AVALANCHE_KEYS;
+            bias = (bias > 1000) ? (bias - 1000) : (1000 - bias);
+            bias /= 2;
+
+            if (bias > worst)
+            {
+                worst = bias;
+            }
+        }
+    }
+
+    return worst;
+}
+
+/* keys that look like cons cells allocated one after the other, hashed into
+   a power-of-two table like the ones in sexpr.c */
+static int_64 max_bucket (int_64 (*hash)(const void *, unsigned long))
+{
+    static unsigned int load[BUCKETS];
+    int_pointer key[2];
+    unsigned int i, worst = 0, b;
+
+    for (i = 0; i < BUCKETS; i++)
+    {
+        load[i] = 0;
+    }
+
+    for (i = 0; i < BUCKET_KEYS; i++)
+    {
+        key[0] = (int_pointer)0x7f0000001000ULL + (i * 32);
+        key[1] = (int_pointer)0x7f0000001000ULL + (i * 32) + 16;
+
+        b = (unsigned int)(hash (key, sizeof (key)) & (BUCKETS - 1));
+
+        if ((++load[b]) > worst)
+        {
+            worst = load[b];
+        }
+    }
+
+    return worst;
+}
+
+static sexpr throughput (int_64 (*hash)(const void *, unsigned long))
+{
+    struct sexpr_list_builder b;
+    unsigned long i, j, n;
+    int_64 start, end, sum = 0;
+
+    sx_list_builder_initialise (&b);
+
+    for (i = 0; i < (sizeof (sizes) / sizeof (sizes[0])); i++)
+    {
+        n = VOLUME / sizes[i];
+
+        start = dt_get_nanoseconds (dtc_monotonic);
+
+        for (j = 0; j < n; j++)
+        {
+            sum += hash (data + (j % 64), sizes[i]);
+        }
+
+        end = dt_get_nanoseconds (dtc_monotonic);
+
+        if (end <= start)
+        {
+            end = start + 1;
+        }
+
+        sx_list_builder_append
+            (&b, cons (make_integer (sizes[i]),
+                       cons (make_integer (((int_64)VOLUME * 1000) /
+                                           (end - start)),
+                             sx_end_of_list)));
+    }
+
+    return cons (make_symbol ("mb-per-second"),
+                 sx_list_builder_finish
+                     (&b, (sum == 0) ? cons (sx_false, sx_end_of_list)
+                                     : sx_end_of_list));
+}
+
+static sexpr evaluate
+    (const char *name, int_64 (*hash)(const void *, unsigned long))
+{
+    return cons (make_symbol (name),
+             cons (cons (make_symbol ("avalanche-bias-per-mille"),
+                     cons (make_integer (avalanche (hash)), sx_end_of_list)),
+               cons (cons (make_symbol ("max-bucket"),
+                       cons (make_integer (max_bucket (hash)),
+                             sx_end_of_list)),
+                 cons (throughput (hash), sx_end_of_list))));
+}
+
+/* the streaming interface must not care how the data is split up */
+static int streaming (void)
+{
+    struct hash_state state;
+    unsigned long len, split, step, p, n;
+    int_64 h;
+
+    for (len = 0; len < 300; len++)
+    {
+        h = hash_wyhash_64 (data, len, 42);
+
+        for (split = 1; split <= 97; split += 8)
+        {
+            hash_wyhash_begin (&state, 42);
+
+            for (p = 0, step = split; p < len; p += n, step = (step * 7) % 61 + 1)
+            {
+                n = ((len - p) < step) ? (len - p) : step;
+                hash_wyhash_update (&state, data + p, n);
+            }
+
+            if (hash_wyhash_finish (&state) != h)
+            {
+                return 0;
+            }
+        }
+
+        hash_wyhash_begin (&state, 42);
+        hash_wyhash_update (&state, data, len);
+
+        if (hash_wyhash_finish (&state) != h)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int cmain (void)
+{
+    struct sexpr_io *stdio = sx_open_stdout ();
+    sexpr murmur, wy;
+    unsigned long i;
+
+    data = get_mem (65536 + 64);
+
+    for (i = 0; i < (65536 + 64); i++)
+    {
+        data[i] = (unsigned char)random ();
+    }
+
+    if (!streaming ())
+    {
+        return 1;
+    }
+
+    /* different seeds and lengths must give different hashes */
+    if ((hash_wyhash_64 (data, 16, 0) == hash_wyhash_64 (data, 16, 1)) ||
+        (hash_wyhash_64 (data, 16, 0) == hash_wyhash_64 (data, 15, 0)) ||
+        (hash_wyhash_64 (data, 0, 0) == hash_wyhash_64 (data, 0, 1)))
+    {
+        return 2;
+    }
+
+    murmur = evaluate ("murmur2", murmur2);
+    wy     = evaluate ("wyhash",  wyhash);
+
+    if ((car (cdr (car (cdr (wy)))) == make_integer (0)) ||
+        (sx_integer (car (cdr (car (cdr (wy))))) > 100) ||
+        (sx_integer (car (cdr (car (cdr (cdr (wy)))))) > 64))
+    {
+        return 3;
+    }
+
+    sx_write (stdio, cons (make_symbol ("hash-benchmark"),
+                           cons (murmur, cons (wy, sx_end_of_list))));
+
+    return 0;
+}
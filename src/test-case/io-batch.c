@@ -0,0 +1,113 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include "curie/io.h"
+#include "curie/multiplex.h"
+#include "curie/network.h"
+#include "curie/io-system.h"
+
+#define PAIRS 64
+#define MESSAGE_SIZE 100
+
+static int received[PAIRS];
+
+static void mx_on_read(struct io *io, void *aux) {
+    int n = (int)(long)aux, i;
+
+    while ((io->length - io->position) >= MESSAGE_SIZE)
+    {
+        for (i = 0; i < MESSAGE_SIZE; i++)
+        {
+            if (io->buffer[(io->position + i)] != (char)(n + i)) return;
+        }
+
+        io->position += MESSAGE_SIZE;
+        received[n]++;
+    }
+}
+
+/* a lot of structures becoming ready at once is where batching the requests
+   kicks in; the data must still end up where it belongs */
+int cmain(void) {
+    struct io *in[PAIRS], *out[PAIRS];
+    char message[MESSAGE_SIZE];
+    int n, i, ticks;
+    unsigned long syscalls;
+
+    multiplex_io();
+
+    for (n = 0; n < PAIRS; n++)
+    {
+        net_open_loop (&(in[n]), &(out[n]));
+        multiplex_add_io (in[n], mx_on_read, (void *)0, (void *)(long)n);
+        multiplex_add_io_no_callback (out[n]);
+
+        received[n] = 0;
+    }
+
+    /* first round: written directly, second round: written by the
+       multiplexer */
+    for (n = 0; n < PAIRS; n++)
+    {
+        for (i = 0; i < MESSAGE_SIZE; i++) message[i] = (char)(n + i);
+
+        io_write   (out[n], message, MESSAGE_SIZE);
+        io_collect (out[n], message, MESSAGE_SIZE);
+    }
+
+    syscalls = a_batch_syscalls ();
+
+    for (ticks = 0, n = 0; n < PAIRS; ticks++)
+    {
+        if (ticks > 10) return 4;
+
+        multiplex ();
+
+        for (n = 0; (n < PAIRS) && (received[n] == 2); n++);
+    }
+
+    for (n = 0; n < PAIRS; n++)
+    {
+        if (received[n] != 2) return 1;
+        if (out[n]->length != 0) return 2;
+        if (in[n]->statistics.bytes != (2 * MESSAGE_SIZE)) return 3;
+    }
+
+    /* at least one read per pair, plus the writes; with the ring, each tick
+       only takes a syscall or two for all of them */
+    syscalls = a_batch_syscalls () - syscalls;
+
+    if (a_batch_ringp () ? (syscalls >= PAIRS) : (syscalls < PAIRS)) return 5;
+
+    for (n = 0; n < PAIRS; n++)
+    {
+        multiplex_del_io (in[n]);
+        multiplex_del_io (out[n]);
+    }
+
+    return 0;
+}
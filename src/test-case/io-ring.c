@@ -0,0 +1,106 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include "curie/io.h"
+#include "curie/memory.h"
+#include "curie/network.h"
+
+#define RING_SIZE IO_CHUNKSIZE
+
+static char data[(3 * RING_SIZE)];
+
+static int check (struct io *io, unsigned int offset, unsigned int length) {
+    unsigned int i;
+
+    if ((io->length - io->position) != length) return 0;
+
+    for (i = 0; i < length; i++)
+    {
+        if (io->buffer[(io->position + i)] != data[(offset + i)]) return 0;
+    }
+
+    return 1;
+}
+
+int cmain(void) {
+    struct io *in, *out;
+    unsigned long syscalls;
+    unsigned int i;
+
+    for (i = 0; i < (3 * RING_SIZE); i++)
+    {
+        data[i] = (char)(i % 251);
+    }
+
+    net_open_loop (&in, &out);
+
+    if (io_ring (in, RING_SIZE) == iobm_linear) return 1;
+    if (in->buffersize != RING_SIZE)            return 2;
+
+    io_write (out, data, 3000);
+    if (io_read (in) != io_changes)             return 3;
+    if (!check (in, 0, 3000))                   return 4;
+
+    /* consume some of the data, then read past the end of the ring */
+    in->position = 2000;
+    io_write (out, data + 3000, 3000);
+    if (io_read (in) != io_changes)             return 5;
+    if (!check (in, 2000, 4000))                return 6;
+
+    /* fill the ring up; further reads must not do anything */
+    io_write (out, data + 6000, 1000);
+    if (io_read (in) != io_changes)             return 7;
+    if (!check (in, 2000, RING_SIZE))           return 8;
+
+    syscalls = in->statistics.syscalls;
+    if (io_read (in) != io_no_change)           return 9;
+    if (in->statistics.syscalls != syscalls)    return 10;
+
+    /* once everything is processed, the remaining data comes in again */
+    in->position = in->length;
+    if (io_read (in) != io_changes)             return 11;
+    if (!check (in, 2000 + RING_SIZE, 7000 - 2000 - RING_SIZE))
+                                                return 12;
+
+    /* writing to a full ring is rejected */
+    io_close (in);
+    net_open_loop (&in, &out);
+
+    if (io_ring (out, RING_SIZE) == iobm_linear) return 13;
+    if (io_collect (out, data, RING_SIZE) != io_incomplete)
+                                                return 14;
+    if (io_collect (out, data, 1) != io_no_change)
+                                                return 15;
+    if (io_commit (out) != io_complete)         return 16;
+    if (io_read (in) != io_changes)             return 17;
+    if (!check (in, 0, RING_SIZE))              return 18;
+
+    io_close (in);
+    io_close (out);
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/constants.h>
+#include <curie/memory.h>
+#include <curie/memory-statistics.h>
+
+#define ENTITIES 100
+#define CHURN    4096
+
+static void *churn[CHURN];
+
+int cmain(void) {
+    struct memory_statistics s;
+    void *entities[ENTITIES];
+    void *large;
+    unsigned int i, round;
+    unsigned long frames;
+    sexpr sx;
+
+    memory_statistics_start ();
+
+    for (i = 0; i < ENTITIES; i++) {
+        entities[i] = aalloc (24);
+    }
+
+    memory_statistics (24, &s);
+
+    if (s.allocations != ENTITIES) return 1;
+    if (s.frees != 0)              return 2;
+    if (s.frames == 0)             return 3;
+    if (s.live < ENTITIES)         return 4;
+
+    for (i = 0; i < ENTITIES; i += 2) {
+        afree (24, entities[i]);
+    }
+
+    memory_statistics (24, &s);
+
+    if (s.frees != (ENTITIES / 2)) return 5;
+    if (s.fragmentation < (ENTITIES / 2)) return 6;
+
+    large = aalloc (LIBCURIE_PAGE_SIZE * 4);
+
+    memory_statistics (0, &s);
+
+    if (s.allocations != 1)                    return 7;
+    if (s.live != (LIBCURIE_PAGE_SIZE * 4))    return 8;
+
+    afree (LIBCURIE_PAGE_SIZE * 4, large);
+
+    memory_statistics (0, &s);
+
+    if (s.frees != 1) return 9;
+    if (s.live != 0)  return 10;
+
+    sx = sx_memory_statistics ();
+
+    if (!consp (sx)) return 11;
+
+    for (i = 1; i < ENTITIES; i += 2) {
+        afree (24, entities[i]);
+    }
+
+    /* entities freed all over the pool need to be found again, rather than
+       getting more and more frames */
+    for (i = 0; i < CHURN; i++) {
+        churn[i] = aalloc (40);
+    }
+
+    memory_statistics (40, &s);
+    frames = s.frames;
+
+    for (round = 0; round < 64; round++) {
+        for (i = round % 7; i < CHURN; i += 7) {
+            afree (40, churn[i]);
+        }
+
+        for (i = round % 7; i < CHURN; i += 7) {
+            churn[i] = aalloc (40);
+        }
+    }
+
+    memory_statistics (40, &s);
+
+    if (s.frames > (frames + 1)) return 12;
+
+    for (i = 0; i < CHURN; i++) {
+        afree (40, churn[i]);
+    }
+
+    return 0;
+}
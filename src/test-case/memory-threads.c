@@ -0,0 +1,320 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+
+#include <curie/main.h>
+#include <curie/memory.h>
+#include <curie/thread.h>
+#include <curie/time.h>
+#include <curie/sexpr.h>
+
+#define THREADS    32
+#define OPERATIONS 0x10000
+#define SLOTS      64
+
+#if defined(__GNUC__)
+#define cas(p,o,n) __sync_bool_compare_and_swap ((p), (o), (n))
+#else
+#define cas(p,o,n) ((*(p) = (n)), 1)
+#endif
+
+static const unsigned int threads[] = { 1, 2, 4, 8, 16, 32 };
+
+static const unsigned long sizes[] =
+    { 8, 16, 24, 32, 40, 64, 96, 128, 200, 256, 512, 1000, 2048 };
+
+struct worker
+{
+    unsigned int id;
+    unsigned int count;
+    volatile char failed;
+};
+
+static struct worker workers[THREADS];
+
+/* every thread hands some of its blocks to the next one, to be freed there */
+static unsigned long * volatile mailboxes[THREADS];
+
+static unsigned long *allocate (unsigned long size, unsigned int id)
+{
+    unsigned long *p = aalloc (size);
+
+    p[0] = size;
+
+    if (size >= (2 * sizeof (unsigned long)))
+    {
+        p[1] = id;
+    }
+
+    return p;
+}
+
+static void release (struct worker *w, unsigned long *p)
+{
+    if ((p[0] < 8) || (p[0] > 2048))
+    {
+        w->failed = (char)1;
+        return;
+    }
+
+    afree (p[0], p);
+}
+
+static void collect (struct worker *w)
+{
+    unsigned long *p;
+
+    do
+    {
+        p = mailboxes[w->id];
+    }
+    while (!cas (&(mailboxes[w->id]), p, (unsigned long *)0));
+
+    if (p != (unsigned long *)0)
+    {
+        release (w, p);
+    }
+}
+
+static void run (void *aux)
+{
+    struct worker *w = (struct worker *)aux;
+    unsigned long *slot[SLOTS];
+    unsigned int i, s, seed = (w->id * 2654435761U) + 1, next;
+
+    next = (w->id + 1) % w->count;
+
+    for (s = 0; s < SLOTS; s++)
+    {
+        slot[s] = (unsigned long *)0;
+    }
+
+    for (i = 0; i < OPERATIONS; i++)
+    {
+        seed = (seed * 1103515245U) + 12345U;
+        s    = (seed >> 16) % SLOTS;
+
+        if (slot[s] != (unsigned long *)0)
+        {
+            if ((slot[s][0] >= (2 * sizeof (unsigned long))) &&
+                (slot[s][1] != w->id))
+            {
+                w->failed = (char)1;
+            }
+
+            if (((i % 4) != 0) ||
+                !cas (&(mailboxes[next]), (unsigned long *)0, slot[s]))
+            {
+                release (w, slot[s]);
+            }
+        }
+
+        slot[s] = allocate
+            (sizes[(seed >> 8) % (sizeof (sizes) / sizeof (sizes[0]))], w->id);
+
+        if ((i % 8) == 0)
+        {
+            collect (w);
+        }
+    }
+
+    for (s = 0; s < SLOTS; s++)
+    {
+        if (slot[s] != (unsigned long *)0)
+        {
+            release (w, slot[s]);
+        }
+    }
+
+    collect (w);
+}
+
+/* a pool that one thread creates and hands to another to allocate from, with
+   the entities freed by yet another thread */
+#define HANDED_OVER 2000
+
+static struct memory_pool * volatile handed_over_pool;
+static unsigned long *handed_over[HANDED_OVER];
+
+static void create_handed_over (void *aux)
+{
+    handed_over_pool = create_memory_pool (48);
+}
+
+static void free_handed_over (void *aux)
+{
+    unsigned int i;
+
+    for (i = 0; i < HANDED_OVER; i++)
+    {
+        free_pool_mem (handed_over[i]);
+    }
+}
+
+static void in_thread (void (*f)(void *))
+{
+    struct thread *t = thread_create (f, (void *)0);
+
+    if (t == (struct thread *)0)
+    {
+        f ((void *)0);
+    }
+    else
+    {
+        thread_join (t);
+    }
+}
+
+static char hand_over (void)
+{
+    unsigned int round, i;
+
+    in_thread (create_handed_over);
+
+    if (handed_over_pool == (struct memory_pool *)0)
+    {
+        return (char)0;
+    }
+
+    for (round = 0; round < 4; round++)
+    {
+        for (i = 0; i < HANDED_OVER; i++)
+        {
+            handed_over[i]    = get_pool_mem (handed_over_pool);
+            handed_over[i][0] = i;
+        }
+
+        for (i = 0; i < HANDED_OVER; i++)
+        {
+            if (handed_over[i][0] != i)
+            {
+                return (char)0;
+            }
+        }
+
+        in_thread (free_handed_over);
+    }
+
+    free_memory_pool (handed_over_pool);
+
+    return (char)1;
+}
+
+static sexpr benchmark (unsigned int n)
+{
+    struct thread *t[THREADS];
+    unsigned int i;
+    int_64 start, end;
+
+    for (i = 0; i < n; i++)
+    {
+        workers[i].id     = i;
+        workers[i].count  = n;
+        workers[i].failed = (char)0;
+        mailboxes[i]      = (unsigned long *)0;
+    }
+
+    start = dt_get_nanoseconds (dtc_monotonic);
+
+    for (i = 0; i < n; i++)
+    {
+        if ((t[i] = thread_create (run, (void *)(workers + i)))
+                == (struct thread *)0)
+        {
+            /* no threads on this platform */
+            run ((void *)(workers + i));
+        }
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        if (t[i] != (struct thread *)0)
+        {
+            thread_join (t[i]);
+        }
+    }
+
+    end = dt_get_nanoseconds (dtc_monotonic);
+
+    for (i = 0; i < n; i++)
+    {
+        collect (workers + i);
+
+        if (workers[i].failed)
+        {
+            return sx_false;
+        }
+    }
+
+    if (end <= start)
+    {
+        end = start + 1;
+    }
+
+    return cons (make_symbol ("threads"),
+             cons (make_integer (n),
+               cons (cons (make_symbol ("operations-per-second"),
+                       cons (make_integer ((int_64)n * OPERATIONS * 1000000 /
+                                           ((end - start + 999) / 1000)),
+                             sx_end_of_list)),
+                     sx_end_of_list)));
+}
+
+int cmain (void)
+{
+    struct sexpr_io *stdio = sx_open_stdout ();
+    struct sexpr_list_builder results;
+    unsigned int i;
+    sexpr r;
+
+    memory_thread_safe = (char)1;
+
+    if (!hand_over ())
+    {
+        return 2;
+    }
+
+    sx_list_builder_initialise (&results);
+
+    for (i = 0; i < (sizeof (threads) / sizeof (threads[0])); i++)
+    {
+        r = benchmark (threads[i]);
+
+        if (falsep (r))
+        {
+            sx_list_builder_release (&results);
+            return 1;
+        }
+
+        sx_list_builder_append (&results, r);
+    }
+
+    sx_write (stdio, cons (make_symbol ("memory-threads-benchmark"),
+                           sx_list_builder_finish (&results, sx_end_of_list)));
+
+    return 0;
+}
@@ -0,0 +1,291 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+
+#include <curie/main.h>
+#include <curie/multiplex.h>
+#include <curie/message-queue.h>
+#include <curie/thread.h>
+#include <curie/time.h>
+#include <curie/sexpr.h>
+
+#define PRODUCERS 8
+#define MESSAGES  0x8000
+#define SLOTS     256
+
+static const unsigned int producers[] = { 1, 2, 4, 8 };
+
+struct message
+{
+    unsigned int producer;
+    unsigned int sequence;
+    char payload[24];
+};
+
+struct producer
+{
+    struct message_queue *queue;
+    unsigned int id;
+    char threaded;
+};
+
+static struct producer workers[PRODUCERS];
+static unsigned int next_sequence[PRODUCERS];
+static unsigned long received;
+static char failed;
+
+static void produce (void *aux)
+{
+    struct producer *p = (struct producer *)aux;
+    struct message m;
+    unsigned int i;
+
+    m.producer = p->id;
+
+    for (i = 0; i < (sizeof (m.payload)); i++)
+    {
+        m.payload[i] = (char)('a' + p->id);
+    }
+
+    for (i = 0; i < MESSAGES; i++)
+    {
+        m.sequence = i;
+
+        while (message_queue_post (p->queue, (const char *)&m, sizeof (m))
+                   == io_no_change)
+        {
+            if (p->threaded)
+            {
+                thread_yield ();
+            }
+            else
+            {
+                /* no threads: we're the one that needs to make room */
+                (void)multiplex ();
+            }
+        }
+    }
+}
+
+static void on_read (struct io *io, void *aux)
+{
+    struct message *m;
+
+    while ((io->length - io->position) >= sizeof (struct message))
+    {
+        m = (struct message *)(io->buffer + io->position);
+
+        if ((m->producer >= PRODUCERS) ||
+            (m->sequence != next_sequence[m->producer]) ||
+            (m->payload[0] != (char)('a' + m->producer)) ||
+            (m->payload[sizeof (m->payload) - 1] != m->payload[0]))
+        {
+            failed = (char)1;
+        }
+        else
+        {
+            next_sequence[m->producer]++;
+        }
+
+        received++;
+        io->position += sizeof (struct message);
+    }
+}
+
+static sexpr benchmark (unsigned int n)
+{
+    struct thread *t[PRODUCERS];
+    struct message_queue *queue;
+    struct io *io;
+    unsigned int i;
+    int_64 start, end;
+
+    if ((io = io_open_message_queue (SLOTS, &queue)) == (struct io *)0)
+    {
+        return sx_false;
+    }
+
+    multiplex_add_io (io, on_read, (void *)0, (void *)0);
+
+    received = 0;
+    failed   = (char)0;
+
+    for (i = 0; i < n; i++)
+    {
+        workers[i].queue    = queue;
+        workers[i].id       = i;
+        workers[i].threaded = (char)1;
+        next_sequence[i]    = 0;
+    }
+
+    start = dt_get_nanoseconds (dtc_monotonic);
+
+    for (i = 0; i < n; i++)
+    {
+        if ((t[i] = thread_create (produce, (void *)(workers + i)))
+                == (struct thread *)0)
+        {
+            workers[i].threaded = (char)0;
+            produce ((void *)(workers + i));
+        }
+    }
+
+    while (received < ((unsigned long)n * MESSAGES))
+    {
+        (void)multiplex ();
+    }
+
+    end = dt_get_nanoseconds (dtc_monotonic);
+
+    for (i = 0; i < n; i++)
+    {
+        if (t[i] != (struct thread *)0)
+        {
+            thread_join (t[i]);
+        }
+    }
+
+    message_queue_close (queue);
+    multiplex_del_io (io);
+
+    for (i = 0; i < n; i++)
+    {
+        if (next_sequence[i] != MESSAGES)
+        {
+            failed = (char)1;
+        }
+    }
+
+    if (failed)
+    {
+        return sx_false;
+    }
+
+    if (end <= start)
+    {
+        end = start + 1;
+    }
+
+    return cons (make_symbol ("producers"),
+             cons (make_integer (n),
+               cons (cons (make_symbol ("messages-per-second"),
+                       cons (make_integer ((int_64)n * MESSAGES * 1000000 /
+                                           ((end - start + 999) / 1000)),
+                             sx_end_of_list)),
+                     sx_end_of_list)));
+}
+
+/* messages that don't fit into a slot take a detour through get_mem() */
+static int long_messages (void)
+{
+    struct message_queue *queue;
+    struct io *io;
+    char buffer[1000];
+    unsigned int i;
+
+    if ((io = io_open_message_queue (4, &queue)) == (struct io *)0)
+    {
+        return 2;
+    }
+
+    for (i = 0; i < sizeof (buffer); i++)
+    {
+        buffer[i] = (char)i;
+    }
+
+    if ((message_queue_post (queue, "x", 1) != io_complete) ||
+        (message_queue_post (queue, buffer, sizeof (buffer)) != io_complete) ||
+        (message_queue_post (queue, buffer, 10) != io_complete) ||
+        (message_queue_post (queue, buffer, 0) != io_complete))
+    {
+        return 3;
+    }
+
+    if (message_queue_post (queue, "y", 1) != io_no_change)
+    {
+        return 4;
+    }
+
+    message_queue_close (queue);
+
+    if (io_read (io) != io_changes)
+    {
+        return 5;
+    }
+
+    if ((io->length - io->position) != (1 + sizeof (buffer) + 10))
+    {
+        return 6;
+    }
+
+    if ((io->buffer[io->position] != 'x') ||
+        (io->buffer[io->position + 1 + 999] != (char)999) ||
+        (io->buffer[io->position + 1 + 1000 + 9] != (char)9))
+    {
+        return 7;
+    }
+
+    io_close (io);
+
+    return 0;
+}
+
+int cmain (void)
+{
+    struct sexpr_io *stdio = sx_open_stdout ();
+    struct sexpr_list_builder results;
+    unsigned int i;
+    int rv;
+    sexpr r;
+
+    multiplex_message_queue ();
+
+    if ((rv = long_messages ()) != 0)
+    {
+        return rv;
+    }
+
+    sx_list_builder_initialise (&results);
+
+    for (i = 0; i < (sizeof (producers) / sizeof (producers[0])); i++)
+    {
+        r = benchmark (producers[i]);
+
+        if (falsep (r))
+        {
+            sx_list_builder_release (&results);
+            return 1;
+        }
+
+        sx_list_builder_append (&results, r);
+    }
+
+    sx_write (stdio, cons (make_symbol ("message-queue-benchmark"),
+                           sx_list_builder_finish (&results, sx_end_of_list)));
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include "curie/io.h"
+#include "curie/multiplex.h"
+#include "curie/network.h"
+
+#define FLOOD_SIZE 0x10000
+#define SMALL      8
+
+static unsigned long flood_bytes = 0;
+static unsigned long light_bytes = 0;
+static int flood_calls = 0;
+static int light_calls = 0;
+static int small_calls = 0;
+
+static void mx_on_flood_read(struct io *io, void *aux) {
+    flood_bytes += (io->length - io->position);
+    flood_calls++;
+    io->position = io->length;
+}
+
+static void mx_on_light_read(struct io *io, void *aux) {
+    light_bytes += (io->length - io->position);
+    light_calls++;
+    io->position = io->length;
+}
+
+static void mx_on_small_read(struct io *io, void *aux) {
+    small_calls++;
+    io->position = io->length;
+}
+
+int cmain(void) {
+    static char data[FLOOD_SIZE];
+    struct io *flood_in, *flood_out, *light_in, *light_out,
+              *small_in[SMALL], *small_out[SMALL];
+    int rv = 0, flood_before, light_before, n;
+
+    multiplex_io();
+
+    net_open_loop (&flood_in, &flood_out);
+    net_open_loop (&light_in, &light_out);
+
+    flood_in->read_policy = iorp_drain;
+    flood_in->read_budget = 2 * IO_CHUNKSIZE;
+
+    multiplex_add_io (flood_in, mx_on_flood_read, (void *)0, (void *)0);
+    multiplex_add_io (light_in, mx_on_light_read, (void *)0, (void *)0);
+
+    io_write (flood_out, data, FLOOD_SIZE);
+    io_write (light_out, "x", 1);
+
+    multiplex ();
+
+    /* the flooded structure may only use up its budget, and the other one
+       still needs to be serviced in the same tick */
+    if (flood_bytes != (2 * IO_CHUNKSIZE))         rv |= 1 << 1;
+    if (light_bytes != 1)                          rv |= 1 << 2;
+    if (flood_in->statistics.syscalls != 2)        rv |= 1 << 3;
+    if (flood_in->statistics.bytes != flood_bytes) rv |= 1 << 4;
+
+    /* with a tick budget of one byte, only one of the two gets to read, and
+       the other one needs to go first in the next tick */
+    multiplex_io_budget (1);
+    io_write (light_out, "x", 1);
+
+    flood_before = flood_calls;
+    light_before = light_calls;
+
+    multiplex ();
+
+    if ((flood_in->statistics.starved + light_in->statistics.starved) != 1)
+                                                   rv |= 1 << 5;
+
+    if (flood_in->statistics.starved == 1)
+    {
+        if ((flood_calls != flood_before) || (light_calls == light_before))
+                                                   rv |= 1 << 6;
+        flood_before = flood_calls;
+
+        multiplex ();
+
+        if (flood_calls == flood_before)           rv |= 1 << 7;
+    }
+    else
+    {
+        if ((light_calls != light_before) || (flood_calls == flood_before))
+                                                   rv |= 1 << 6;
+        light_before = light_calls;
+
+        multiplex ();
+
+        if (light_calls == light_before)           rv |= 1 << 7;
+    }
+
+    multiplex_io_budget (0);
+
+    multiplex_del_io (flood_in);
+    multiplex_del_io (light_in);
+    io_close (flood_out);
+    io_close (light_out);
+
+    /* the tick budget counts what was actually read: reads that only return a
+       byte each mustn't use up a budget of more than a chunk */
+    multiplex_io_budget (2 * IO_CHUNKSIZE);
+
+    for (n = 0; n < SMALL; n++)
+    {
+        net_open_loop (&(small_in[n]), &(small_out[n]));
+        multiplex_add_io (small_in[n], mx_on_small_read, (void *)0, (void *)0);
+        io_write (small_out[n], "x", 1);
+    }
+
+    multiplex ();
+
+    if (small_calls != SMALL)                      rv |= 1;
+
+    for (n = 0; n < SMALL; n++)
+    {
+        if (small_in[n]->statistics.starved != 0)  rv |= 1;
+
+        multiplex_del_io (small_in[n]);
+        io_close (small_out[n]);
+    }
+
+    multiplex_io_budget (0);
+
+    return rv;
+}
@@ -26,7 +26,19 @@
 */
 
 #include "curie/io.h"
+#include "curie/io-system.h"
 #include "curie/multiplex.h"
+#include "curie/network.h"
+#include "curie/sexpr.h"
+#include "curie/time.h"
+
+/* number of idle descriptors to register for the benchmark; fewer are used if
+   the process runs out of descriptors first */
+#define IDLE_DESCRIPTORS 10000
+
+static struct io *idle[IDLE_DESCRIPTORS];
+static int idle_callbacks = 0;
+static unsigned long hot_messages = 0;
 
 static void mx_on_read(struct io *io, void *wx) {
     struct io *w = (struct io *)wx;
@@ -41,6 +53,105 @@ static void mx_on_close(struct io *io, void *wx) {
     multiplex_del_io (w);
 }
 
+static void mx_on_idle_read(struct io *io, void *aux) {
+    idle_callbacks++;
+    io->position = io->length;
+}
+
+static void mx_on_hot_read(struct io *io, void *aux) {
+    hot_messages += (io->length - io->position);
+    io->position = io->length;
+}
+
+/* one hot socket pair among a lot of idle descriptors: the time spent per
+   multiplex() pass should not depend on how many idle descriptors there are,
+   other than what the kernel needs for the poll itself. afterwards, all of the
+   idle descriptors see the end of file in the same pass, and they all need to
+   be removed and closed in that pass. */
+static int benchmark ( void ) {
+    struct io *hot_in, *hot_out, *idle_in, *idle_out;
+    struct sexpr_io *stdio = sx_open_stdout ();
+    unsigned int t, n = 0;
+    unsigned long messages;
+    int fd, first = -1, callbacks;
+    int_64 start, cleanup;
+
+    net_open_loop (&hot_in, &hot_out);
+    net_open_loop (&idle_in, &idle_out);
+
+    if ((hot_in->fd < 0) || (idle_in->fd < 0))
+    {
+        return 1;
+    }
+
+    while ((n < IDLE_DESCRIPTORS) && ((fd = a_dup_n (idle_in->fd)) >= 0))
+    {
+        idle[n] = io_open (fd);
+        idle[n]->type = iot_read;
+        multiplex_add_io (idle[n], mx_on_idle_read, (void *)0, (void *)0);
+        n++;
+
+        if (first < 0)
+        {
+            first = fd;
+        }
+    }
+
+    multiplex_add_io (hot_in, mx_on_hot_read, (void *)0, (void *)0);
+    multiplex_add_io_no_callback (hot_out);
+
+    t = dt_get_time ();
+    while (dt_get_time () == t);
+
+    t = dt_get_time ();
+    hot_messages = 0;
+
+    do
+    {
+        io_write (hot_out, "x", 1);
+        multiplex ();
+    }
+    while (dt_get_time () == t);
+
+    messages = hot_messages;
+    callbacks = idle_callbacks;
+
+    io_close (idle_out);
+
+    start = dt_get_nanoseconds (dtc_monotonic);
+    multiplex ();
+    cleanup = (dt_get_nanoseconds (dtc_monotonic) - start) / 1000;
+
+    /* the lowest free descriptor is the first of the idle ones again, unless
+       some of them were left open */
+    fd = a_dup_n (idle_in->fd);
+
+    if ((idle_callbacks != (callbacks + (int)n)) ||
+        ((first >= 0) && (fd > first)))
+    {
+        return 3;
+    }
+
+    (void)a_close (fd);
+
+    multiplex_del_io (hot_in);
+    multiplex_del_io (hot_out);
+    io_close (idle_in);
+
+    sx_write (stdio,
+              cons (make_symbol ("multiplex-io-benchmark"),
+                cons (cons (make_symbol ("idle"),
+                        cons (make_integer (n), sx_end_of_list)),
+                  cons (cons (make_symbol ("messages-per-second"),
+                          cons (make_integer (messages), sx_end_of_list)),
+                    cons (cons (make_symbol ("cleanup-microseconds"),
+                            cons (make_integer (cleanup), sx_end_of_list)),
+                          sx_end_of_list)))));
+    sx_close_io (stdio);
+
+    return ((callbacks == 0) && (messages > 0)) ? 0 : 2;
+}
+
 int cmain(void) {
     struct io *r = io_open_read("multiplexer-test-data.sx"),
               *w = io_open_write("to-multiplexer-test-data.sx");
@@ -52,5 +163,5 @@ int cmain(void) {
 
     while (multiplex() == mx_ok);
 
-    return 0;
+    return benchmark ();
 }
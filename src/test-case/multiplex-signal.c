@@ -0,0 +1,153 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+
+#include <curie/main.h>
+#include <curie/multiplex.h>
+#include <curie/signal.h>
+#include <curie/thread.h>
+#include <curie/time.h>
+#include <syscall/syscall.h>
+
+#if defined(have_sys_kill) && defined(have_sys_getpid) && \
+    (defined(__x86_64__) || defined(__i386__) || defined(__arm__))
+
+#define SIGUSR1 10
+#define SIGUSR2 12
+
+static unsigned int usr1 = 0, usr2_keep = 0, usr2_ditch = 0;
+
+static enum signal_callback_result on_usr1 (enum signal signal, void *aux)
+{
+    if (signal == sig_usr1)
+    {
+        usr1++;
+    }
+
+    return scr_keep;
+}
+
+static enum signal_callback_result on_usr2_keep (enum signal signal, void *aux)
+{
+    usr2_keep++;
+
+    return scr_keep;
+}
+
+static enum signal_callback_result on_usr2_ditch
+    (enum signal signal, void *aux)
+{
+    usr2_ditch++;
+
+    return scr_ditch;
+}
+
+static void raise (int signum)
+{
+    (void)sys_kill ((int)sys_getpid (), signum);
+}
+
+/* sends the signal a while after the main thread went to sleep in select() */
+static void delayed_raise (void *aux)
+{
+    int_64 until = dt_get_nanoseconds (dtc_monotonic) + 20000000;
+
+    while (dt_get_nanoseconds (dtc_monotonic) < until)
+    {
+        thread_yield ();
+    }
+
+    raise (SIGUSR1);
+}
+
+int cmain (void)
+{
+    struct thread *t;
+
+    multiplex_signal_primary ();
+
+    multiplex_add_signal (sig_usr1, on_usr1,       (void *)0);
+    multiplex_add_signal (sig_usr2, on_usr2_keep,  (void *)0);
+    multiplex_add_signal (sig_usr2, on_usr2_ditch, (void *)0);
+
+    /* repeated signals are only delivered once */
+    raise (SIGUSR1);
+    raise (SIGUSR1);
+    raise (SIGUSR1);
+
+    if (usr1 != 0)
+    {
+        return 1;
+    }
+
+    if (multiplex () != mx_ok)
+    {
+        return 2;
+    }
+
+    if (usr1 != 1)
+    {
+        return 3;
+    }
+
+    /* only the handlers for the signal that came in are run, and ditched
+       handlers are gone for good */
+    raise (SIGUSR2);
+    (void)multiplex ();
+    raise (SIGUSR2);
+    (void)multiplex ();
+
+    if ((usr1 != 1) || (usr2_keep != 2) || (usr2_ditch != 1))
+    {
+        return 4;
+    }
+
+    /* nothing else to wait for, so this only returns because of the wake-up
+       descriptor */
+    if ((t = thread_create (delayed_raise, (void *)0)) != (struct thread *)0)
+    {
+        (void)multiplex ();
+
+        thread_join (t);
+
+        if (usr1 != 2)
+        {
+            return 5;
+        }
+    }
+
+    return 0;
+}
+
+#else
+
+int cmain (void)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,299 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/main.h>
+#include <curie/io.h>
+#include <curie/gc.h>
+#include <curie/time.h>
+#include <curie/graph.h>
+#include <curie/sexpr.h>
+#include <sievert/sexpr.h>
+
+#define RUNS 20000
+
+/* nesting for the frame that goes deeper than the decoder will follow */
+#define DEEP 300
+
+/* number of broken frames that are fed in a row */
+#define BROKEN 4096
+
+/* what a typical exchange with one of our daemons looks like */
+static const char trace[] =
+    "(request (id 17) (method get) (path \"/status\") (load 3/4))\n"
+    "(reply (id 17) (status ok) (load 1/8) (body \"all systems nominal\"))\n"
+    "(event (type tick) (at 1337) (drift -5/16))\n"
+    "(request (id 18) (method put) (key \"user\") (value \"root\"))\n"
+    "(reply (id 18) (status error) (reason denied) (uptime 86400000))\n";
+
+static sexpr read_trace (void)
+{
+    struct sexpr_io *io =
+        sx_open_i (io_open_buffer ((void *)trace, sizeof (trace) - 1));
+    sexpr r, rv = sx_end_of_list;
+
+    while (!eofp (r = sx_read (io)))
+    {
+        if (!nexp (r))
+        {
+            rv = cons (r, rv);
+        }
+    }
+
+    sx_close_io (io);
+
+    return sx_reverse (rv);
+}
+
+static sexpr round_trip (struct sexpr_io *io, sexpr sx)
+{
+    sexpr r;
+
+    sx_write (io, sx);
+
+    do
+    {
+        r = sx_read (io);
+    }
+    while (nexp (r));
+
+    return r;
+}
+
+/* malformed frames need to be skipped without tripping up the reader */
+static int broken_frames (struct sexpr_io *io, struct io *q)
+{
+    static const char zero_denominator[] =
+        { (char)0xfe, 0x03, 0x11, 0x00, 0x00 };
+    static const char bad_tag[] = { (char)0xfe, 0x01, 0x7f };
+    static const char one[] = { (char)0xfe, 0x01, (char)0x81 };
+    char deep[(DEEP * 3) + 4];
+    unsigned int i, l = 0;
+    sexpr r;
+
+    (void)io_collect (q, zero_denominator, sizeof (zero_denominator));
+
+    deep[l++] = (char)0xfe;
+    deep[l++] = (char)(((DEEP * 3) + 1) & 0x7f) | (char)0x80;
+    deep[l++] = (char)(((DEEP * 3) + 1) >> 7);
+    for (i = 0; i < DEEP; i++)
+    {
+        deep[l++] = 0x17;
+        deep[l++] = 0x01;
+    }
+    deep[l++] = (char)0x81;
+    for (i = 0; i < DEEP; i++)
+    {
+        deep[l++] = 0x00;
+    }
+    (void)io_collect (q, deep, l);
+
+    for (i = 0; i < BROKEN; i++)
+    {
+        (void)io_collect (q, bad_tag, sizeof (bad_tag));
+    }
+
+    (void)io_collect (q, one, sizeof (one));
+
+    r = sx_read (io);
+
+    return integerp (r) && (sx_integer (r) == 1) && (q->position == q->length);
+}
+
+static sexpr benchmark (struct sexpr_io *io, sexpr messages, struct io *q)
+{
+    unsigned int i, bytes = 0, n = 0;
+    int_64 start, end;
+    sexpr c, r;
+
+    start = dt_get_nanoseconds (dtc_monotonic);
+
+    for (i = 0; i < RUNS; i++)
+    {
+        for (c = messages; consp (c); c = cdr (c))
+        {
+            sx_write (io, car (c));
+            bytes += q->length - q->position;
+
+            r = sx_read (io);
+
+            if (!consp (r))
+            {
+                return sx_false;
+            }
+
+            n++;
+        }
+
+        if ((i % 1000) == 0)
+        {
+            (void)gc_invoke ();
+        }
+    }
+
+    end = dt_get_nanoseconds (dtc_monotonic);
+
+    if (end <= start)
+    {
+        return sx_false;
+    }
+
+    return cons (cons (make_symbol ("messages-per-second"),
+                   cons (make_integer ((int_64)n * 1000000000 / (end - start)),
+                         sx_end_of_list)),
+             cons (cons (make_symbol ("bytes-per-message"),
+                     cons (make_rational (bytes, n), sx_end_of_list)),
+               sx_end_of_list));
+}
+
+int cmain (void)
+{
+    struct io *q = io_open_special ();
+    struct sexpr_io *io = sx_open_io (q, q), *text = sx_open_io (q, q),
+                    *stdio = sx_open_stdout ();
+    sexpr messages = read_trace (), text_result = sx_nil, values, c, r,
+          binary_result;
+    sexpr status = make_symbol ("status"), graph = graph_create ();
+    unsigned int before, first, second;
+
+    /* the benchmark collects garbage, so keep these around */
+    gc_add_root (&messages);
+    gc_add_root (&text_result);
+
+    (void)graph_add_node (graph, make_integer (1));
+
+    values = sx_list2 (sx_list5 (make_integer (0), make_integer (127),
+                                 make_integer (128), make_integer (-1),
+                                 make_integer (-1000000)),
+                       sx_list5 (make_integer ((int_pointer_s)1 << 30),
+                                 make_rational (1, 3),
+                                 make_rational (-12345678, 7),
+                                 make_string (""),
+                                 make_string ("\"quotes\", \\escapes\\")));
+    values = cons (cons (status, make_symbol ("improper")), values);
+    values = cons (sx_list5 (sx_true, sx_false, sx_end_of_list,
+                             sx_positive_infinity, sx_negative_infinity),
+                   values);
+    values = cons (sx_list4 (sx_quote, status, make_special (0x2200),
+                             make_string ("a rather long string, at least "
+                                          "long enough not to be one of the "
+                                          "short strings that are kept in "
+                                          "the sexpr word itself")),
+                   values);
+
+    if (sx_binary_negotiated (io))
+    {
+        return 1;
+    }
+
+    text_result = benchmark (io, messages, q);
+
+    if (falsep (text_result))
+    {
+        return 2;
+    }
+
+    /* we're talking to ourselves, so reading our own offer completes the
+       negotiation */
+    sx_offer_binary (io);
+
+    if (!nexp (sx_read (io)) || !sx_binary_negotiated (io))
+    {
+        return 3;
+    }
+
+    for (c = values; consp (c); c = cdr (c))
+    {
+        if (falsep (equalp (round_trip (io, car (c)), car (c))))
+        {
+            return 4;
+        }
+    }
+
+    r = round_trip (io, graph);
+
+    if (!graphp (r))
+    {
+        return 5;
+    }
+
+    /* symbols are spelled out the first time and sent as indices after */
+    c = sx_list3 (make_symbol ("first-time"), make_symbol ("first-time"),
+                  make_symbol ("first-time"));
+    before = q->length - q->position;
+    sx_write (io, c);
+    first = (q->length - q->position) - before;
+    if (falsep (equalp (sx_read (io), c)))
+    {
+        return 6;
+    }
+
+    before = q->length - q->position;
+    sx_write (io, c);
+    second = (q->length - q->position) - before;
+    if (falsep (equalp (sx_read (io), c)) || (second >= first))
+    {
+        return 7;
+    }
+
+    /* text and binary in the same stream */
+    sx_write (text, car (messages));
+    sx_write (io, car (messages));
+    sx_write (text, car (messages));
+
+    for (c = sx_list3 (sx_true, sx_true, sx_true); consp (c); c = cdr (c))
+    {
+        do
+        {
+            r = sx_read (io);
+        }
+        while (nexp (r));
+
+        if (falsep (equalp (r, car (messages))))
+        {
+            return 8;
+        }
+    }
+
+    if (!broken_frames (io, q))
+    {
+        return 9;
+    }
+
+    binary_result = benchmark (io, messages, q);
+
+    if (falsep (binary_result))
+    {
+        return 10;
+    }
+
+    sx_write (stdio, cons (make_symbol ("sexpr-binary-benchmark"),
+                           sx_list2 (cons (make_symbol ("text"), text_result),
+                                     cons (make_symbol ("binary"),
+                                           binary_result))));
+
+    return 0;
+}
@@ -0,0 +1,269 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+
+#include <curie/main.h>
+#include <curie/io.h>
+#include <curie/io-system.h>
+#include <curie/time.h>
+#include <curie/memory.h>
+#include <curie/sexpr.h>
+#include <sievert/sexpr.h>
+
+#define RECORDS 0x4000
+
+static const char record[][64] =
+{
+    "(record (id ",
+    ") (name \"a record with a reasonably long name, number ",
+    "\") (ratio 100000000007/",
+    ") (tags alpha beta gamma))\n"
+};
+
+static unsigned int append (char *buffer, unsigned int i, const char *s)
+{
+    while (*s != (char)0)
+    {
+        buffer[i] = *s;
+        i++;
+        s++;
+    }
+
+    return i;
+}
+
+static unsigned int append_number
+    (char *buffer, unsigned int i, unsigned int n)
+{
+    char digits[16];
+    unsigned int j = 0;
+
+    do
+    {
+        digits[j] = '0' + (n % 10);
+        n /= 10;
+        j++;
+    }
+    while (n > 0);
+
+    while (j > 0)
+    {
+        j--;
+        buffer[i] = digits[j];
+        i++;
+    }
+
+    return i;
+}
+
+static sexpr parse (char *buffer, unsigned int length)
+{
+    struct sexpr_io *io =
+        sx_open_io (io_open_buffer (buffer, length), (struct io *)0);
+    struct sexpr_list_builder list;
+    sexpr r;
+
+    sx_list_builder_initialise (&list);
+
+    for (r = sx_read (io); consp (r); r = sx_read (io))
+    {
+        sx_list_builder_append (&list, r);
+    }
+
+    sx_close_io (io);
+
+    return sx_list_builder_finish (&list, sx_end_of_list);
+}
+
+/* a copy of the second image, so it can be broken on purpose; the header is
+   made up of int_pointers, and the image's pointers are relative to the base
+   address in its third word. */
+static int_pointer broken[0x2000];
+static unsigned int broken_length = 0;
+
+#define broken_object(type,sx)\
+    ((type *)(((char *)broken) + ((int_pointer)(sx) - broken[2])))
+
+static char rejectedp (const char *path, unsigned int length)
+{
+    int fd = a_create (path, 0644);
+
+    if (fd < 0)
+    {
+        return (char)0;
+    }
+
+    (void)a_write (fd, broken, length);
+    (void)a_close (fd);
+
+    return sx_image_load (path) == sx_nonexistent;
+}
+
+static int load_broken_images (void)
+{
+    struct sexpr_cons *c;
+    struct sexpr_string_or_symbol *s;
+    int_pointer w, i;
+    int fd, r;
+
+    if ((fd = a_open_read ("sexpr-image-2.img")) < 0)            { return 19; }
+
+    while ((broken_length < sizeof (broken)) &&
+           ((r = a_read (fd, ((char *)broken) + broken_length,
+                         sizeof (broken) - broken_length)) > 0))
+    {
+        broken_length += r;
+    }
+
+    (void)a_close (fd);
+
+    if ((broken_length == 0) || (broken_length == sizeof (broken)))
+                                                                 { return 19; }
+
+    c = broken_object (struct sexpr_cons, broken[6]);
+    s = broken_object (struct sexpr_string_or_symbol,
+                       broken_object (struct sexpr_cons, c->cdr)->car);
+
+    /* string table masks that would wrap around, or that aren't one less
+       than a power of two */
+    w = broken[10];
+    broken[10] = ~(int_pointer)0;
+    if (!rejectedp ("sexpr-image-bad.img", broken_length))      { return 20; }
+    broken[10] = (w == 0) ? 2 : (w << 1);
+    if (!rejectedp ("sexpr-image-bad.img", broken_length))      { return 21; }
+    broken[10] = w;
+
+    /* a string that claims to run past the end of the objects */
+    w = s->length;
+    s->length = 0x7fffffff;
+    if (!rejectedp ("sexpr-image-bad.img", broken_length))      { return 22; }
+    s->length = w;
+
+    /* a pointer to just past the end of the image */
+    w = (int_pointer)c->car;
+    c->car = (sexpr)(broken[2] + broken[3]);
+    if (!rejectedp ("sexpr-image-bad.img", broken_length))      { return 23; }
+    c->car = (sexpr)w;
+
+    /* a symbol table without an empty slot would never end a lookup */
+    for (i = 0; i <= broken[12]; i++)
+    {
+        ((sexpr *)(((char *)broken) + broken[11]))[i] = c->car;
+    }
+    if (!rejectedp ("sexpr-image-bad.img", broken_length))      { return 24; }
+
+    /* and a file that's shorter than the header says */
+    if (!rejectedp ("sexpr-image-short.img", broken_length / 2)) { return 25; }
+
+    return 0;
+}
+
+int cmain (void)
+{
+    define_symbol (sym_record, "record");
+    define_symbol (sym_unique, "only-in-the-second-image");
+    unsigned int length = RECORDS * 256, i, n;
+    char *buffer = get_mem (length);
+    struct sexpr_io *stdio = sx_open_stdout ();
+    sexpr parsed, loaded, again, other, r;
+    int_64 start, parse_time, load_time;
+
+    for (i = 0, n = 0; n < RECORDS; n++)
+    {
+        i = append        (buffer, i, record[0]);
+        i = append_number (buffer, i, n);
+        i = append        (buffer, i, record[1]);
+        i = append_number (buffer, i, n);
+        i = append        (buffer, i, record[2]);
+        i = append_number (buffer, i, (n * 2) + 3);
+        i = append        (buffer, i, record[3]);
+    }
+
+    start      = dt_get_nanoseconds (dtc_monotonic);
+    parsed     = parse (buffer, i);
+    parse_time = dt_get_nanoseconds (dtc_monotonic) - start;
+
+    free_mem (length, buffer);
+
+    if (!sx_image_save ("sexpr-image.img", parsed))              { return 1; }
+
+    start     = dt_get_nanoseconds (dtc_monotonic);
+    loaded    = sx_image_load ("sexpr-image.img");
+    load_time = dt_get_nanoseconds (dtc_monotonic) - start;
+
+    if (!consp (loaded))                                         { return 2; }
+    if (loaded == parsed)                                        { return 3; }
+    if (falsep (equalp (loaded, parsed)))                        { return 4; }
+
+    /* the constructors now hand out the image's objects */
+    r = car (loaded);
+
+    if (make_symbol ("record") != car (r))                       { return 5; }
+    if (cons (car (r), cdr (r)) != r)                            { return 6; }
+    if (make_rational (100000000007LL, 3)
+          != car (cdr (car (cdr (cdr (cdr (r)))))))              { return 7; }
+    if (make_string
+          ("a record with a reasonably long name, number 0")
+          != car (cdr (car (cdr (cdr (r))))))                    { return 8; }
+    if (falsep (equalp (sym_record, car (r))))                   { return 9; }
+
+    /* a second copy can't go to the same address, so it's relocated */
+    again = sx_image_load ("sexpr-image.img");
+
+    if (!consp (again) || (again == loaded))                     { return 10; }
+    if (falsep (equalp (again, parsed)))                         { return 11; }
+
+    r = sx_list2 (sym_unique,
+                  make_string ("this string is only in the second image"));
+
+    if (!sx_image_save ("sexpr-image-2.img", r))                 { return 12; }
+
+    other = sx_image_load ("sexpr-image-2.img");
+
+    if (!consp (other) || (other == r))                          { return 13; }
+    if (falsep (equalp (other, r)))                              { return 14; }
+    if (make_symbol ("only-in-the-second-image") != car (other)) { return 15; }
+    if (cons (car (other), cdr (other)) != other)                { return 16; }
+
+    /* images without any objects in them work, too */
+    if (!sx_image_save ("sexpr-image-3.img", make_integer (42))) { return 17; }
+    if (sx_image_load ("sexpr-image-3.img") != make_integer (42)) { return 18; }
+
+    if ((i = load_broken_images ()) != 0)                        { return i; }
+
+    sx_write (stdio,
+      cons (make_symbol ("sexpr-image-benchmark"),
+        cons (cons (make_symbol ("records"),
+                cons (make_integer (RECORDS), sx_end_of_list)),
+          cons (cons (make_symbol ("parse-microseconds"),
+                  cons (make_integer (parse_time / 1000), sx_end_of_list)),
+            cons (cons (make_symbol ("load-microseconds"),
+                    cons (make_integer (load_time / 1000), sx_end_of_list)),
+              sx_end_of_list)))));
+
+    return 0;
+}
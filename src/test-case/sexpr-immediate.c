@@ -0,0 +1,169 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/main.h>
+#include <curie/io.h>
+#include <curie/gc.h>
+#include <curie/memory.h>
+#include <curie/memory-statistics.h>
+
+/* what a typical exchange with one of our daemons looks like */
+static const char trace[] =
+    "(request (id 17) (method get) (path \"/status\") (load 3/4))\n"
+    "(reply (id 17) (status ok) (load 1/8) (body \"all systems nominal\"))\n"
+    "(event (type tick) (at 1337) (drift -5/16))\n"
+    "(request (id 18) (method put) (key \"user\") (value \"root\"))\n"
+    "(reply (id 18) (status error) (reason denied))\n";
+
+#define RUNS 1000
+
+static unsigned long allocations (void)
+{
+    struct memory_statistics s;
+    unsigned long size, rv = 0;
+
+    for (size = 0; size <= LIBCURIE_PAGE_SIZE; size += ENTITY_ALIGNMENT)
+    {
+        memory_statistics (size, &s);
+        rv += s.allocations;
+    }
+
+    return rv;
+}
+
+static sexpr benchmark (void)
+{
+    unsigned long messages = 0, tracked = 0, i, a;
+    struct sexpr_io *io;
+    sexpr s;
+
+    memory_statistics_start ();
+
+    for (i = 0; i < RUNS; i++)
+    {
+        io = sx_open_i (io_open_buffer ((void *)trace, sizeof (trace) - 1));
+
+        while (((s = sx_read (io)) != sx_end_of_file) &&
+               (s != sx_nonexistent))
+        {
+            messages++;
+        }
+
+        sx_close_io (io);
+
+        tracked += gc_base_items;
+        (void)gc_invoke ();
+    }
+
+    a = allocations ();
+
+    if (messages != (5 * RUNS))
+    {
+        return sx_false;
+    }
+
+    return cons (make_symbol ("sexpr-immediate-benchmark"),
+             cons (cons (make_symbol ("messages"),
+                     cons (make_integer (messages), sx_end_of_list)),
+               cons (cons (make_symbol ("allocations-per-message"),
+                       cons (make_rational (a, messages), sx_end_of_list)),
+                 cons (cons (make_symbol ("tracked-per-message"),
+                         cons (make_rational (tracked, messages),
+                               sx_end_of_list)),
+                       sx_end_of_list))));
+}
+
+int cmain (void)
+{
+    define_string (str_long, "abcdefgh");
+    struct sexpr_io *stdio = sx_open_stdout ();
+    sexpr r, a, b;
+
+    r = make_rational (1, 3);
+
+    if (!rationalp (r) || !immediate_rationalp (r) ||
+        (sx_numerator (r) != 1) || (sx_denominator (r) != 3))
+    {
+        return 1;
+    }
+
+    r = make_rational (5, -7);
+
+    if (!immediate_rationalp (r) || ((int_pointer_s)sx_numerator (r) != 5) ||
+        (sx_denominator (r) != -7))
+    {
+        return 2;
+    }
+
+    r = make_rational ((int_pointer)1 << (sx_rational_bits + 1), 3);
+
+    if (!rationalp (r) || immediate_rationalp (r) ||
+        (sx_numerator (r) != ((int_pointer)1 << (sx_rational_bits + 1))) ||
+        (sx_denominator (r) != 3))
+    {
+        return 3;
+    }
+
+    if (make_rational (2, 6) != make_rational (1, 3))
+    {
+        return 4;
+    }
+
+    a = make_symbol ("status");
+    b = make_symbol_l ("status-line", 6);
+
+    if ((a != b) || !symbolp (a) || (sx_symbol_length (a) != 6))
+    {
+        return 5;
+    }
+
+    /* short strings are never collected */
+    (void)gc_invoke ();
+
+    if ((make_symbol ("status") != a) || (make_string ("status") == a))
+    {
+        return 6;
+    }
+
+    a = make_string ("abcdefgh");
+
+    if ((sx_string_length (a) != 8) || falsep (equalp (a, str_long)))
+    {
+        return 7;
+    }
+
+    r = benchmark ();
+
+    if (falsep (r))
+    {
+        return 8;
+    }
+
+    sx_write (stdio, r);
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include "curie/main.h"
+#include "curie/sexpr.h"
+
+int cmain ()
+{
+    define_string (str_a, "a");
+    define_string (str_slash, "/");
+    define_symbol (sym_b, "b");
+    define_string (str_joined, "a/-42");
+    define_string (str_list, "a/b12");
+    define_symbol (sym_list, "ba");
+    struct sexpr_string_builder b;
+    sexpr t;
+    const char *s;
+    int i;
+
+    if (falsep (equalp (sx_join (str_a, str_slash, make_integer (-42)),
+                        str_joined)))
+    {
+        return 1;
+    }
+
+    t = sx_join_list (cons (str_a, cons (str_slash, cons (sym_b,
+                      cons (make_integer (12), sx_end_of_list)))));
+
+    if (!stringp (t) || falsep (equalp (t, str_list)))
+    {
+        return 2;
+    }
+
+    t = sx_join_list (cons (sym_b, cons (str_a, sx_end_of_list)));
+
+    if (!symbolp (t) || falsep (equalp (t, sym_list)))
+    {
+        return 3;
+    }
+
+    if (!nilp (sx_join_list (sx_end_of_list)))
+    {
+        return 4;
+    }
+
+    /* long enough to spill out of the built-in buffer twice */
+    sx_builder_initialise (&b);
+
+    for (i = 0; i < (3 * STACK_BUFFER_SIZE); i++)
+    {
+        sx_builder_append_c (&b, "x");
+    }
+
+    sx_builder_append (&b, make_integer (7));
+
+    t = sx_builder_string (&b);
+    s = sx_string (t);
+
+    for (i = 0; s[i] == 'x'; i++);
+
+    if ((i != (3 * STACK_BUFFER_SIZE)) || (s[i] != '7') || (s[i+1] != 0))
+    {
+        return 5;
+    }
+
+    return 0;
+}
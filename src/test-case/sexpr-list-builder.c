@@ -0,0 +1,151 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+
+#include <curie/main.h>
+#include <curie/io.h>
+#include <curie/sexpr.h>
+#include <sievert/sexpr.h>
+
+#define ELEMENTS ((SX_LIST_BUILDER_SIZE * 4) + 3)
+
+static const char text[] = "(a b c) (a b . c) (1 (2 3) . 4) ()";
+
+static sexpr gtp (sexpr a, sexpr b, void *aux)
+{
+    return (sx_integer (car (a)) > sx_integer (car (b))) ? sx_true : sx_false;
+}
+
+int cmain(void)
+{
+    struct sexpr_list_builder b;
+    struct sexpr_io *io;
+    sexpr r, e, k, t;
+    unsigned int i;
+
+    /* order and tail, with and without spilling out of the struct */
+    sx_list_builder_initialise (&b);
+    r = sx_list_builder_finish (&b, sx_end_of_list);
+
+    if (!eolp (r))                                     { return 1; }
+
+    sx_list_builder_initialise (&b);
+
+    for (i = 0; i < ELEMENTS; i++)
+    {
+        sx_list_builder_append (&b, make_integer (i));
+    }
+
+    r = sx_list_builder_finish (&b, sx_true);
+
+    for (i = 0; i < ELEMENTS; i++, r = cdr (r))
+    {
+        if (!consp (r))                                { return 2; }
+        if (sx_integer (car (r)) != (int_pointer)i)    { return 3; }
+    }
+
+    if (!truep (r))                                    { return 4; }
+
+    sx_list_builder_initialise (&b);
+
+    for (i = 0; i < ELEMENTS; i++)
+    {
+        sx_list_builder_append (&b, make_integer (i));
+    }
+
+    sx_list_builder_release (&b);
+
+    /* the reader */
+    io = sx_open_io (io_open_buffer ((void *)text, sizeof (text) - 1),
+                     (struct io *)0);
+
+    r = sx_read (io);
+    e = sx_list3 (make_symbol ("a"), make_symbol ("b"), make_symbol ("c"));
+    if (falsep (equalp (r, e)))                        { return 5; }
+
+    r = sx_read (io);
+    e = cons (make_symbol ("a"), cons (make_symbol ("b"), make_symbol ("c")));
+    if (falsep (equalp (r, e)))                        { return 6; }
+
+    r = sx_read (io);
+    e = cons (make_integer (1),
+              cons (sx_list2 (make_integer (2), make_integer (3)),
+                    make_integer (4)));
+    if (falsep (equalp (r, e)))                        { return 7; }
+
+    r = sx_read (io);
+    if (!eolp (r))                                     { return 8; }
+
+    sx_close_io (io);
+
+    /* sorting keeps equal elements in their original order */
+    e = sx_end_of_list;
+
+    for (i = 0; i < ELEMENTS; i++)
+    {
+        e = cons (cons (make_integer (i % 7), make_integer (i)), e);
+    }
+
+    r = sx_set_sort_merge (e, gtp, (void *)0);
+
+    for (i = 0, t = sx_nonexistent; consp (r); r = cdr (r), i++)
+    {
+        k = car (r);
+
+        if (!nexp (t))
+        {
+            if (sx_integer (car (t)) > sx_integer (car (k)))
+                                                       { return 9; }
+            if ((sx_integer (car (t)) == sx_integer (car (k))) &&
+                (sx_integer (cdr (t)) < sx_integer (cdr (k))))
+                                                       { return 10; }
+        }
+
+        t = k;
+    }
+
+    if (i != ELEMENTS)                                 { return 11; }
+
+    /* alist removal keeps the order and shares the unaffected tail */
+    k = make_symbol ("k");
+    t = sx_list2 (cons (make_symbol ("x"), sx_true),
+                  cons (make_symbol ("y"), sx_false));
+    e = cons (cons (make_symbol ("w"), sx_true),
+              cons (cons (k, sx_true),
+                    cons (cons (make_symbol ("v"), sx_false),
+                          cons (cons (k, sx_false), t))));
+
+    r = sx_alist_remove (e, k);
+
+    if (falsep (equalp (car (r), car (e))))            { return 12; }
+    if (falsep (equalp (car (cdr (r)), car (cdr (cdr (e))))))
+                                                       { return 13; }
+    if (cdr (cdr (r)) != t)                            { return 14; }
+    if (sx_alist_remove (t, k) != t)                   { return 15; }
+
+    return 0;
+}
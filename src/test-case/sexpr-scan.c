@@ -0,0 +1,229 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/main.h>
+#include <curie/io.h>
+#include <curie/gc.h>
+#include <curie/time.h>
+#include <curie/memory.h>
+#include <curie/sexpr.h>
+#include <curie/sexpr-internal.h>
+#include <sievert/sexpr.h>
+
+#define SIZE 100
+
+/* a typical message from one of our RPC streams */
+static const char message[] =
+    "(reply (id 4711) (status ok) (service network-interface-monitor)\n"
+    "       (body \"link up on eth0, negotiated 1000baseT full duplex, "
+    "flow control rx/tx; carrier detected after 3 retries, autonegotiation "
+    "restarted twice due to a remote fault indication from the link partner, "
+    "see the interface statistics for details\") ; informational\n"
+    "       (counters (rx-packets 1833729) (tx-packets 1720385)))\n";
+
+#define MESSAGES 0x2000
+#define RUNS     8
+
+static unsigned int reference
+    (const char *buf, unsigned int i, unsigned int length,
+     unsigned char classes, char skip)
+{
+    while ((i < length) &&
+           (((sx_character_classes[(unsigned char)buf[i]] & classes) != 0)
+            == (skip == (char)1)))
+    {
+        i++;
+    }
+
+    return i;
+}
+
+static int check_scanner (void)
+{
+    static const char special[] = " \t\n\r\v;()\"\\x";
+    char buf[SIZE];
+    unsigned int p, s, i;
+
+    for (s = 0; special[s] != (char)0; s++)
+    {
+        for (p = 0; p < SIZE; p++)
+        {
+            for (i = 0; i < SIZE; i++)
+            {
+                buf[i] = 'a';
+            }
+
+            buf[p] = special[s];
+
+            for (i = 0; i <= p; i++)
+            {
+                if ((sx_scan (buf, i, SIZE, SX_CLASS_DELIMITER) !=
+                     reference (buf, i, SIZE, SX_CLASS_DELIMITER, (char)0)) ||
+                    (sx_scan (buf, i, SIZE, SX_CLASS_STRING) !=
+                     reference (buf, i, SIZE, SX_CLASS_STRING, (char)0)) ||
+                    (sx_scan (buf, i, SIZE, SX_CLASS_NEWLINE) !=
+                     reference (buf, i, SIZE, SX_CLASS_NEWLINE, (char)0)))
+                {
+                    return 0;
+                }
+            }
+
+            for (i = 0; i < SIZE; i++)
+            {
+                buf[i] = ' ';
+            }
+
+            buf[p] = special[s];
+
+            for (i = 0; i <= p; i++)
+            {
+                if (sx_skip (buf, i, SIZE, SX_CLASS_SPACE) !=
+                    reference (buf, i, SIZE, SX_CLASS_SPACE, (char)1))
+                {
+                    return 0;
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
+static sexpr read_all (const char *text, unsigned int length)
+{
+    struct sexpr_io *io =
+        sx_open_io (io_open_buffer ((void *)text, length), (struct io *)0);
+    sexpr r, rv = sx_end_of_list;
+
+    while (!eofp (r = sx_read (io)))
+    {
+        if (nexp (r))
+        {
+            break;
+        }
+
+        rv = cons (r, rv);
+    }
+
+    sx_close_io (io);
+
+    return sx_reverse (rv);
+}
+
+static sexpr benchmark (void)
+{
+    unsigned int length = (sizeof (message) - 1) * MESSAGES, i, n = 0;
+    char *buffer = get_mem (length);
+    int_64 start, end;
+
+    for (i = 0; i < length; i++)
+    {
+        buffer[i] = message[i % (sizeof (message) - 1)];
+    }
+
+    start = dt_get_nanoseconds (dtc_monotonic);
+
+    for (i = 0; i < RUNS; i++)
+    {
+        struct sexpr_io *io =
+            sx_open_io (io_open_buffer (buffer, length), (struct io *)0);
+
+        sexpr r;
+
+        for (r = sx_read (io); consp (r); r = sx_read (io))
+        {
+            n++;
+        }
+
+        sx_close_io (io);
+
+        (void)gc_invoke ();
+    }
+
+    end = dt_get_nanoseconds (dtc_monotonic);
+
+    free_mem (length, buffer);
+
+    if ((n != (MESSAGES * RUNS)) || (end <= start))
+    {
+        return sx_false;
+    }
+
+    return cons (make_symbol ("sexpr-scan-benchmark"),
+             cons (cons (make_symbol ("messages"),
+                     cons (make_integer (n), sx_end_of_list)),
+               cons (cons (make_symbol ("kilobytes-per-second"),
+                       cons (make_integer
+                               ((int_64)length * RUNS * 1000000 /
+                                ((end - start) / 1000) / 1024),
+                             sx_end_of_list)),
+                 sx_end_of_list)));
+}
+
+int cmain (void)
+{
+    static const char text[] =
+        "; leading comment\n"
+        "  ) (a-rather-long-symbol-name-that-spans-several-blocks\n"
+        "     \"str\\\"ing\"\n"
+        "   ; a comment inside a list\n"
+        "   \"a string that is well over thirty-two bytes long\")\n"
+        "\tsymbol\t(12 3/4)";
+    define_symbol (sym_long,
+                   "a-rather-long-symbol-name-that-spans-several-blocks");
+    define_string (str_escaped, "str\"ing");
+    define_string (str_long,
+                   "a string that is well over thirty-two bytes long");
+    define_symbol (sym_symbol, "symbol");
+    sexpr r, e;
+    struct sexpr_io *stdio = sx_open_stdout ();
+
+    if (!check_scanner ())
+    {
+        return 1;
+    }
+
+    r = read_all (text, sizeof (text) - 1);
+    e = sx_list3 (sx_list3 (sym_long, str_escaped, str_long), sym_symbol,
+                  sx_list2 (make_integer (12), make_rational (3, 4)));
+
+    if (falsep (equalp (r, e)))
+    {
+        return 2;
+    }
+
+    r = benchmark ();
+
+    if (falsep (r))
+    {
+        return 3;
+    }
+
+    sx_write (stdio, r);
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include "curie/main.h"
+#include "sievert/shell.h"
+
+int cmain ()
+{
+    define_string (str_sh, "sh");
+    define_string (str_none, "curie-test-no-such-programme");
+    char *environment[] = { "PATH=/nonexistent:/bin:/usr/bin", (char *)0 };
+    char *empty[]       = { "PATH=/nonexistent", (char *)0 };
+    sexpr a, b, l;
+
+    a = ewhich (environment, str_sh);
+    if (!stringp (a))
+    {
+        return 1;
+    }
+
+    b = ewhich (environment, str_sh);
+    if (truep (equalp (a, b)) == 0)
+    {
+        return 2;
+    }
+
+    if (!falsep (ewhich (environment, str_none)))
+    {
+        return 3;
+    }
+
+    /* a different PATH must not produce results from the old one */
+    if (!falsep (ewhich (empty, str_sh)))
+    {
+        return 4;
+    }
+
+    l = ewhich_batch (environment, cons (str_sh, cons (str_none, sx_end_of_list)));
+
+    if (!consp (l) || falsep (equalp (car (l), a)))
+    {
+        return 5;
+    }
+
+    l = cdr (l);
+
+    if (!consp (l) || !falsep (car (l)) || !eolp (cdr (l)))
+    {
+        return 6;
+    }
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/thread.h>
+
+#define THREADS 4
+
+static volatile int results[THREADS];
+
+static void run (void *aux)
+{
+    int i = *(int *)aux;
+
+    results[i] = i + 1;
+}
+
+int cmain (void)
+{
+    struct thread *t[THREADS];
+    int arguments[THREADS];
+    int i;
+
+    for (i = 0; i < THREADS; i++)
+    {
+        arguments[i] = i;
+        results[i]   = 0;
+        t[i]         = thread_create (run, (void *)&(arguments[i]));
+    }
+
+    for (i = 0; i < THREADS; i++)
+    {
+        if (t[i] == (struct thread *)0)
+        {
+            /* no threads on this platform */
+            continue;
+        }
+
+        thread_join (t[i]);
+
+        if (results[i] != (i + 1))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,307 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+
+#include <curie/main.h>
+#include <curie/utf-8.h>
+#include <curie/memory.h>
+#include <curie/time.h>
+#include <curie/sexpr.h>
+
+#define BUFFER_SIZE 0x100000
+#define ROUNDS      8
+
+static const char *ascii_text =
+    "(message (from \"worker\") (body \"the quick brown fox jumps over the "
+    "lazy dog, again and again\") (sequence 12345)) ";
+
+static int_8 *buffer;
+static int_32 *decoded;
+
+/* mostly ASCII with the odd two- and four-byte character thrown in, or
+   mostly three-byte CJK characters separated by the odd space */
+static unsigned long fill (char cjk)
+{
+    unsigned long p = 0, i = 0;
+    unsigned int c = 0x4e00;
+    const char *s;
+
+    while ((p + 128) < BUFFER_SIZE)
+    {
+        if (cjk)
+        {
+            p += utf8_encode (buffer + p, c);
+            c = (c >= 0x9fa0) ? 0x4e00 : (c + 7);
+
+            if ((++i % 16) == 0)
+            {
+                buffer[p] = ' ';
+                p++;
+            }
+        }
+        else
+        {
+            for (s = ascii_text; *s; s++, p++)
+            {
+                buffer[p] = *s;
+            }
+
+            if ((++i % 4) == 0)
+            {
+                p += utf8_encode (buffer + p, 0xe9);
+                p += utf8_encode (buffer + p, 0x1f600);
+            }
+        }
+    }
+
+    return p;
+}
+
+static int_64 megabytes_per_second (unsigned long bytes, int_64 start)
+{
+    int_64 end = dt_get_nanoseconds (dtc_monotonic);
+
+    if (end <= start)
+    {
+        end = start + 1;
+    }
+
+    return ((int_64)bytes * ROUNDS * 1000) / (end - start);
+}
+
+static sexpr benchmark (const char *name, char cjk)
+{
+    unsigned long length = fill (cjk), count, n, i, p, np;
+    int_64 start, per_character, validate, decode;
+    unsigned int r;
+    int_32 c;
+
+    count = utf8_count (buffer, length);
+
+    /* the old way: one call per character */
+    buffer[length] = 0;
+    start = dt_get_nanoseconds (dtc_monotonic);
+
+    for (r = 0; r < ROUNDS; r++)
+    {
+        for (p = 0, i = 0; (np = utf8_get_character (buffer, p, &c)), (c != 0);
+             p = np, i++)
+        {
+            decoded[i] = c;
+        }
+
+        if ((i != count) || (p != length))
+        {
+            return sx_false;
+        }
+    }
+
+    per_character = megabytes_per_second (length, start);
+
+    start = dt_get_nanoseconds (dtc_monotonic);
+
+    for (r = 0; r < ROUNDS; r++)
+    {
+        if (utf8_validate (buffer, length) != length)
+        {
+            return sx_false;
+        }
+    }
+
+    validate = megabytes_per_second (length, start);
+
+    start = dt_get_nanoseconds (dtc_monotonic);
+
+    for (r = 0; r < ROUNDS; r++)
+    {
+        if ((utf8_decode (buffer, length, decoded, &n) != length) ||
+            (n != count))
+        {
+            return sx_false;
+        }
+    }
+
+    decode = megabytes_per_second (length, start);
+
+    for (p = 0, i = 0; i < n; i++)
+    {
+        p = utf8_get_character (buffer, p, &c);
+
+        if (c != decoded[i])
+        {
+            return sx_false;
+        }
+    }
+
+    return cons (make_symbol (name),
+             cons (cons (make_symbol ("characters"),
+                     cons (make_integer (count), sx_end_of_list)),
+               cons (cons (make_symbol ("per-character-mb-per-second"),
+                       cons (make_integer (per_character), sx_end_of_list)),
+                 cons (cons (make_symbol ("validate-mb-per-second"),
+                         cons (make_integer (validate), sx_end_of_list)),
+                   cons (cons (make_symbol ("decode-mb-per-second"),
+                           cons (make_integer (decode), sx_end_of_list)),
+                         sx_end_of_list)))));
+}
+
+/* a single non-ASCII byte at every position around the block boundaries,
+   with starts at every alignment */
+static int skip_ok (void)
+{
+    unsigned long start, mark, length = 160;
+
+    for (mark = 0; mark <= length; mark++)
+    {
+        for (start = 0; start < length; start++)
+        {
+            buffer[start] = 'a';
+        }
+
+        if (mark < length)
+        {
+            buffer[mark] = (int_8)0xc3;
+        }
+
+        for (start = 0; start < 40; start++)
+        {
+            if (utf8_skip_ascii (buffer, start, length) !=
+                ((start > mark) ? length : mark))
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+struct sample
+{
+    const char *bytes;
+    unsigned long valid;
+};
+
+static const struct sample samples[] =
+{
+    { "plain",                         5 },
+    { "caf\xc3\xa9",                   5 },
+    { "\xe6\x97\xa5\xe6\x9c\xac",      6 },
+    { "\xf0\x9f\x98\x80!",             5 },
+    { "ab\xc0\x80",                    2 },  /* overlong NUL */
+    { "\xe0\x80\xaf",                  0 },  /* overlong '/' */
+    { "x\xed\xa0\x80",                 1 },  /* surrogate */
+    { "\xf4\x90\x80\x80",              0 },  /* above 0x10ffff */
+    { "\xf5\x80\x80\x80",              0 },
+    { "ok\x80",                        2 },  /* stray continuation byte */
+    { "\xe6\x97",                      0 },  /* truncated */
+    { "\xc3\xa9\xe6\x97\xa5x\xc3",     6 }
+};
+
+static int samples_ok (void)
+{
+    unsigned int i;
+    unsigned long length, n;
+    const char *s;
+    int_32 c[16];
+
+    for (i = 0; i < (sizeof (samples) / sizeof (samples[0])); i++)
+    {
+        for (s = samples[i].bytes, length = 0; s[length]; length++);
+
+        if (utf8_validate ((const int_8 *)s, length) != samples[i].valid)
+        {
+            return 0;
+        }
+
+        if (utf8_decode ((const int_8 *)s, length, c, &n) != samples[i].valid)
+        {
+            return 0;
+        }
+
+        if (n != utf8_count ((const int_8 *)s, samples[i].valid))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int cmain (void)
+{
+    struct sexpr_io *stdio = sx_open_stdout ();
+    sexpr ascii, cjk;
+    unsigned long n, i;
+    int_32 c[8];
+
+    if (!samples_ok ())
+    {
+        return 1;
+    }
+
+    if ((utf8_decode ((const int_8 *)"caf\xc3\xa9", 5, c, &n) != 5) ||
+        (n != 4) || (c[3] != 0xe9))
+    {
+        return 2;
+    }
+
+    buffer  = get_mem (BUFFER_SIZE);
+    decoded = get_mem (BUFFER_SIZE * sizeof (int_32));
+
+    /* unaligned starts and lengths */
+    fill ((char)0);
+
+    for (i = 0; i < 24; i++)
+    {
+        if (utf8_validate (buffer + i, 200 - i) !=
+            utf8_validate (buffer + i + 1, 199 - i) + 1)
+        {
+            return 3;
+        }
+    }
+
+    if (!skip_ok ())
+    {
+        return 4;
+    }
+
+    if (falsep (ascii = benchmark ("ascii", (char)0)))
+    {
+        return 5;
+    }
+
+    if (falsep (cjk = benchmark ("cjk", (char)1)))
+    {
+        return 6;
+    }
+
+    sx_write (stdio, cons (make_symbol ("utf-8-benchmark"),
+                           cons (ascii, cons (cjk, sx_end_of_list))));
+
+    return 0;
+}
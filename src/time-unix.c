@@ -32,7 +32,8 @@ struct datetime dt_from_unix (unsigned long long timestamp)
 {
     struct datetime date =
         { UNIX_EPOCH + (timestamp / SECONDS_PER_DAY),
-          timestamp % SECONDS_PER_DAY };
+          timestamp % SECONDS_PER_DAY,
+          0 };
 
     return date;
 }
@@ -25,13 +25,25 @@
  * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
 */
 
-#include <syscall/syscall.h>
 #include <curie/time.h>
+#include <curie/time-system.h>
 #include <curie/constants.h>
 
+static int_64_s dt_get_seconds (unsigned long *nanoseconds)
+{
+    int_64_s seconds = 0;
+
+    *nanoseconds = 0;
+    (void)a_clock (dtc_realtime, &seconds, nanoseconds);
+
+    return seconds;
+}
+
 int_date dt_get_kin (void)
 {
-    return UNIX_EPOCH + (sys_time(0) / SECONDS_PER_DAY);
+    unsigned long nanoseconds;
+
+    return UNIX_EPOCH + (dt_get_seconds (&nanoseconds) / SECONDS_PER_DAY);
 }
 
 int_date dt_make_kin (struct date date)
@@ -62,16 +74,29 @@ struct date dt_split_kin (int_date kin)
 
 unsigned int dt_get_time (void)
 {
-    return sys_time(0) % SECONDS_PER_DAY;
+    unsigned long nanoseconds;
+
+    return dt_get_seconds (&nanoseconds) % SECONDS_PER_DAY;
 }
 
 struct datetime dt_get ()
 {
-    int_64 utime = sys_time(0);
+    unsigned long nanoseconds;
+    int_64_s utime = dt_get_seconds (&nanoseconds);
     struct datetime date =
         { UNIX_EPOCH + (utime / SECONDS_PER_DAY),
-          utime % SECONDS_PER_DAY };
-
+          utime % SECONDS_PER_DAY,
+          (unsigned int)nanoseconds };
 
     return date;
 }
+
+int_64 dt_get_nanoseconds (enum dt_clock clock)
+{
+    int_64_s seconds = 0;
+    unsigned long nanoseconds = 0;
+
+    (void)a_clock (clock, &seconds, &nanoseconds);
+
+    return ((int_64)seconds * 1000000000) + nanoseconds;
+}
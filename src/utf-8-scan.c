@@ -0,0 +1,64 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/utf-8.h>
+
+/* the generic version looks at a pair of machine words at a time whenever it
+   can: a word that doesn't have any of its bytes' high bits set is plain
+   ASCII. */
+
+#define utf8_word_ones (((unsigned long)~0) / 0xff)
+#define utf8_word_high (utf8_word_ones * 0x80)
+#define utf8_word_size (sizeof (unsigned long))
+
+unsigned long utf8_skip_ascii
+        (const int_8 *b, unsigned long p, unsigned long length)
+{
+    const unsigned long *w;
+
+    while ((p < length) && ((((int_pointer)(b + p)) % utf8_word_size) != 0))
+    {
+        if (utf8_mbcp (b[p]))
+        {
+            return p;
+        }
+
+        p++;
+    }
+
+    for (w = (const unsigned long *)(b + p);
+         ((p + (2 * utf8_word_size)) <= length) &&
+         (((w[0] | w[1]) & utf8_word_high) == 0);
+         w += 2, p += (2 * utf8_word_size));
+
+    while ((p < length) && !utf8_mbcp (b[p]))
+    {
+        p++;
+    }
+
+    return p;
+}
@@ -118,3 +118,209 @@ unsigned int utf8_encode (int_8 *b, unsigned int c)
         return 4;
     }
 }
+
+/* utf8_count() looks at a machine word at a time whenever it can; runs of
+   ASCII are skipped with utf8_skip_ascii(), which lives in utf-8-scan.c so
+   that it can be replaced with a vectorised version. */
+
+#define utf8_word_ones (((unsigned long)~0) / 0xff)
+#define utf8_word_high (utf8_word_ones * 0x80)
+#define utf8_word_size (sizeof (unsigned long))
+
+/* returns the length of the valid multi-byte sequence at p, or 0 */
+static unsigned int utf8_sequence
+        (const int_8 *b, unsigned long p, unsigned long length, int_32 *c)
+{
+    unsigned char a = b[p], low = 0x80, high = 0xbf;
+    unsigned int n, i;
+    int_32 v;
+
+    if (a < 0xc2)
+    {
+        return 0;
+    }
+    else if (a < 0xe0)
+    {
+        n = 2;
+        v = a & 0x1f;
+    }
+    else if (a < 0xf0)
+    {
+        n = 3;
+        v = a & 0x0f;
+
+        if (a == 0xe0)
+        {
+            low = 0xa0;
+        }
+        else if (a == 0xed)
+        {
+            high = 0x9f;
+        }
+    }
+    else if (a < 0xf5)
+    {
+        n = 4;
+        v = a & 0x07;
+
+        if (a == 0xf0)
+        {
+            low = 0x90;
+        }
+        else if (a == 0xf4)
+        {
+            high = 0x8f;
+        }
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (((p + n) > length) || (b[p+1] < low) || (b[p+1] > high))
+    {
+        return 0;
+    }
+
+    v = (v << 6) | (b[p+1] & 0x3f);
+
+    for (i = 2; i < n; i++)
+    {
+        if (!utf8_mbmp (b[p+i]))
+        {
+            return 0;
+        }
+
+        v = (v << 6) | (b[p+i] & 0x3f);
+    }
+
+    *c = v;
+
+    return n;
+}
+
+/* two- and three-byte sequences that don't need the special cases for the
+   second byte are by far the most common, so they're checked for directly */
+#define utf8_plain2p(b,p,length,a)\
+    (((a) >= 0xc2) && ((a) <= 0xdf) && (((p) + 2) <= (length)) &&\
+     utf8_mbmp ((b)[(p)+1]))
+
+#define utf8_plain3p(b,p,length,a)\
+    (((a) >= 0xe1) && ((a) <= 0xef) && ((a) != 0xed) &&\
+     (((p) + 3) <= (length)) && utf8_mbmp ((b)[(p)+1]) &&\
+     utf8_mbmp ((b)[(p)+2]))
+
+unsigned long utf8_validate (const int_8 *b, unsigned long length)
+{
+    unsigned long p = 0;
+    unsigned int n;
+    unsigned char a;
+    int_32 c;
+
+    while (p < length)
+    {
+        a = b[p];
+
+        if (a < 0x80)
+        {
+            p = utf8_skip_ascii (b, p + 1, length);
+        }
+        else if (utf8_plain3p (b, p, length, a))
+        {
+            p += 3;
+        }
+        else if (utf8_plain2p (b, p, length, a))
+        {
+            p += 2;
+        }
+        else if ((n = utf8_sequence (b, p, length, &c)) != 0)
+        {
+            p += n;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return p;
+}
+
+unsigned long utf8_count (const int_8 *b, unsigned long length)
+{
+    unsigned long p = 0, tail = 0, w;
+    const unsigned long *wp;
+
+    while ((p < length) && ((((int_pointer)(b + p)) % utf8_word_size) != 0))
+    {
+        tail += utf8_mbmp (b[p]) ? 1 : 0;
+        p++;
+    }
+
+    /* a continuation byte has its high bit set and the next one clear; the
+       multiplication adds up the resulting 0/1 bytes in the topmost byte */
+    for (wp = (const unsigned long *)(b + p);
+         (p + utf8_word_size) <= length;
+         wp++, p += utf8_word_size)
+    {
+        w = *wp;
+        w = ((w & ~(w << 1)) & utf8_word_high) >> 7;
+
+        tail += (w * utf8_word_ones) >> ((utf8_word_size - 1) * 8);
+    }
+
+    while (p < length)
+    {
+        tail += utf8_mbmp (b[p]) ? 1 : 0;
+        p++;
+    }
+
+    return length - tail;
+}
+
+unsigned long utf8_decode
+        (const int_8 *b, unsigned long length, int_32 *c, unsigned long *n)
+{
+    unsigned long p = 0, q = 0, e;
+    unsigned int s;
+    unsigned char a;
+
+    while (p < length)
+    {
+        a = b[p];
+
+        if (a < 0x80)
+        {
+            for (e = utf8_skip_ascii (b, p + 1, length); p < e; p++, q++)
+            {
+                c[q] = b[p];
+            }
+        }
+        else if (utf8_plain3p (b, p, length, a))
+        {
+            c[q] = ((a & 0x0f) << 12) | ((b[p+1] & 0x3f) << 6)
+                 | (b[p+2] & 0x3f);
+            p += 3;
+            q++;
+        }
+        else if (utf8_plain2p (b, p, length, a))
+        {
+            c[q] = ((a & 0x1f) << 6) | (b[p+1] & 0x3f);
+            p += 2;
+            q++;
+        }
+        else if ((s = utf8_sequence (b, p, length, c + q)) != 0)
+        {
+            p += s;
+            q++;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    *n = q;
+
+    return p;
+}
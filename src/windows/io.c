@@ -344,11 +344,26 @@ enum io_result io_read(struct io *io)
 
         io->overlapped->Offset += readrv;
         io->length += readrv;
+        io->statistics.bytes += readrv;
 
         return io_changes;
     }
 }
 
+/* the overlapped I/O code moves buffers around on its own, so buffers always
+   stay linear for now. */
+enum io_buffer_mode io_ring (struct io *io, unsigned int capacity)
+{
+    return io->buffer_mode;
+}
+
+/* overlapped reads can't be chained up, so there's only ever one pending read
+   request per structure. */
+enum io_result io_read_scheduled (struct io *io)
+{
+    return io_read (io);
+}
+
 enum io_result io_commit (struct io *io)
 {
     DWORD rv = 0;
@@ -270,6 +270,12 @@ void multiplex_io () {
     }
 }
 
+/* overlapped I/O only ever has one read pending per handle, so there's nothing
+   to budget here. */
+void multiplex_io_budget (unsigned long bytes)
+{
+}
+
 void multiplex_add_io (struct io *io, void (*on_read)(struct io *, void *), void (*on_close)(struct io *, void *), void *data) {
     static struct memory_pool pool
             = MEMORY_POOL_INITIALISER(sizeof (struct io_list));
@@ -101,3 +101,17 @@ sexpr ewhich (char **environment, sexpr programme)
 
     return sx_false;
 }
+
+sexpr ewhich_batch (char **environment, sexpr programmes)
+{
+    struct sexpr_list_builder rv;
+
+    sx_list_builder_initialise (&rv);
+
+    for (; consp (programmes); programmes = cdr (programmes))
+    {
+        sx_list_builder_append (&rv, ewhich (environment, car (programmes)));
+    }
+
+    return sx_list_builder_finish (&rv, sx_end_of_list);
+}
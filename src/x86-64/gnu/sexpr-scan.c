@@ -0,0 +1,157 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/sexpr.h>
+#include <curie/sexpr-internal.h>
+
+#include <immintrin.h>
+
+/* SSE2 is part of the x86-64 baseline, so that's what we use by default; if
+   the library is built for a CPU with AVX2, we classify 32 bytes at a time
+   instead of 16. */
+
+#if defined(__AVX2__)
+
+#define SCAN_BLOCK 32
+
+typedef __m256i scan_vector;
+
+#define scan_load(p)     _mm256_loadu_si256 ((const __m256i *)(p))
+#define scan_zero()      _mm256_setzero_si256 ()
+#define scan_or(a,b)     _mm256_or_si256 ((a), (b))
+#define scan_eq(v,c)     _mm256_cmpeq_epi8 ((v), _mm256_set1_epi8 (c))
+#define scan_bitmap(v)   ((unsigned int)_mm256_movemask_epi8 (v))
+#define SCAN_ALL         0xffffffffU
+
+#else
+
+#define SCAN_BLOCK 16
+
+typedef __m128i scan_vector;
+
+#define scan_load(p)     _mm_loadu_si128 ((const __m128i *)(p))
+#define scan_zero()      _mm_setzero_si128 ()
+#define scan_or(a,b)     _mm_or_si128 ((a), (b))
+#define scan_eq(v,c)     _mm_cmpeq_epi8 ((v), _mm_set1_epi8 (c))
+#define scan_bitmap(v)   ((unsigned int)_mm_movemask_epi8 (v))
+#define SCAN_ALL         0xffffU
+
+#endif
+
+/* one bit per byte in the block, set for the bytes in any of the classes */
+static inline unsigned int scan_classify
+    (const char *p, unsigned char classes)
+{
+    scan_vector v = scan_load (p), m = scan_zero ();
+
+    if (classes & SX_CLASS_SPACE)
+    {
+        m = scan_or (scan_eq (v, ' '), scan_eq (v, '\n'));
+        m = scan_or (m, scan_or (scan_eq (v, '\t'), scan_eq (v, '\r')));
+        m = scan_or (m, scan_or (scan_eq (v, '\v'), scan_eq (v, 0)));
+    }
+    else if (classes & SX_CLASS_NEWLINE)
+    {
+        m = scan_or (m, scan_eq (v, '\n'));
+    }
+
+    if (classes & SX_CLASS_COMMENT)
+    {
+        m = scan_or (m, scan_eq (v, ';'));
+    }
+
+    if (classes & SX_CLASS_PAREN)
+    {
+        m = scan_or (m, scan_or (scan_eq (v, '('), scan_eq (v, ')')));
+    }
+
+    if (classes & SX_CLASS_STRING)
+    {
+        m = scan_or (m, scan_or (scan_eq (v, '"'), scan_eq (v, '\\')));
+    }
+
+    return scan_bitmap (m);
+}
+
+unsigned int sx_scan
+    (const char *buf, unsigned int i, unsigned int length,
+     unsigned char classes)
+{
+    const unsigned char *b = (const unsigned char *)buf;
+
+    while ((i + SCAN_BLOCK) <= length)
+    {
+        unsigned int bitmap = scan_classify (buf + i, classes);
+
+        if (bitmap != 0)
+        {
+            return i + (unsigned int)__builtin_ctz (bitmap);
+        }
+
+        i += SCAN_BLOCK;
+    }
+
+    while ((i < length) && ((sx_character_classes[b[i]] & classes) == 0))
+    {
+        i++;
+    }
+
+    return i;
+}
+
+unsigned int sx_skip
+    (const char *buf, unsigned int i, unsigned int length,
+     unsigned char classes)
+{
+    const unsigned char *b = (const unsigned char *)buf;
+
+    /* runs of blanks between tokens tend to be short, so check the next byte
+       before bothering with a whole block */
+    if ((i < length) && ((sx_character_classes[b[i]] & classes) == 0))
+    {
+        return i;
+    }
+
+    while ((i + SCAN_BLOCK) <= length)
+    {
+        unsigned int bitmap = scan_classify (buf + i, classes) ^ SCAN_ALL;
+
+        if (bitmap != 0)
+        {
+            return i + (unsigned int)__builtin_ctz (bitmap);
+        }
+
+        i += SCAN_BLOCK;
+    }
+
+    while ((i < length) && ((sx_character_classes[b[i]] & classes) != 0))
+    {
+        i++;
+    }
+
+    return i;
+}
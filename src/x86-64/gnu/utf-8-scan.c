@@ -0,0 +1,95 @@
+/**\file
+ *
+ * \copyright
+ * Copyright (c) 2008-2014, Kyuba Project Members
+ * \copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * \copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * \copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \see Project Documentation: http://ef.gy/documentation/curie
+ * \see Project Source Code: http://git.becquerel.org/kyuba/curie.git
+*/
+
+#include <curie/utf-8.h>
+
+#include <immintrin.h>
+
+/* the high bit of each byte is all we need to know, and that's exactly what
+   movemask collects; SSE2 is part of the x86-64 baseline, and with AVX2 we
+   can look at 32 bytes at a time instead of 16. Two blocks are or'ed together
+   per step, as long ASCII runs are the common case. */
+
+#if defined(__AVX2__)
+
+#define ASCII_BLOCK 32
+
+typedef __m256i ascii_vector;
+
+#define ascii_load(p)    _mm256_loadu_si256 ((const __m256i *)(p))
+#define ascii_or(a,b)    _mm256_or_si256 ((a), (b))
+#define ascii_bitmap(v)  ((unsigned int)_mm256_movemask_epi8 (v))
+
+#else
+
+#define ASCII_BLOCK 16
+
+typedef __m128i ascii_vector;
+
+#define ascii_load(p)    _mm_loadu_si128 ((const __m128i *)(p))
+#define ascii_or(a,b)    _mm_or_si128 ((a), (b))
+#define ascii_bitmap(v)  ((unsigned int)_mm_movemask_epi8 (v))
+
+#endif
+
+unsigned long utf8_skip_ascii
+        (const int_8 *b, unsigned long p, unsigned long length)
+{
+    unsigned int bitmap;
+
+    while ((p + (2 * ASCII_BLOCK)) <= length)
+    {
+        ascii_vector v = ascii_load (b + p),
+                     w = ascii_load (b + p + ASCII_BLOCK);
+
+        if (ascii_bitmap (ascii_or (v, w)) != 0)
+        {
+            break;
+        }
+
+        p += 2 * ASCII_BLOCK;
+    }
+
+    while ((p + ASCII_BLOCK) <= length)
+    {
+        bitmap = ascii_bitmap (ascii_load (b + p));
+
+        if (bitmap != 0)
+        {
+            return p + (unsigned long)__builtin_ctz (bitmap);
+        }
+
+        p += ASCII_BLOCK;
+    }
+
+    while ((p < length) && !utf8_mbcp (b[p]))
+    {
+        p++;
+    }
+
+    return p;
+}